@@ -0,0 +1,337 @@
+// 压缩算法基准测试
+// 用法: BackupBenchmarks [--size MiB] [--iterations N] [--codec huffman|lz] [--output 文件]
+// 生成固定种子的语料（文本、日志、二进制、随机数据、大量小文件），
+// 对每种压缩算法测量压缩/解压吞吐量、压缩率和峰值内存，结果以JSON输出，
+// 便于在不同版本之间比较回归
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "utils/Codec.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace {
+    // 一份语料：一个或多个文件，每个文件单独压缩
+    struct Corpus {
+        std::string name;
+        std::vector<std::string> files;
+
+        size_t totalBytes() const {
+            size_t total = 0;
+            for (const auto& file : files) {
+                total += file.size();
+            }
+            return total;
+        }
+    };
+
+    // 一次测量结果
+    struct Result {
+        std::string codec;
+        std::string corpus;
+        size_t fileCount = 0;
+        size_t inputBytes = 0;
+        size_t outputBytes = 0;
+        double compressMBps = 0.0;
+        double decompressMBps = 0.0;
+        long peakRssKiB = 0;
+    };
+
+    const char* WORDS[] = {
+        "the", "backup", "file", "of", "and", "to", "restore", "a", "directory", "in",
+        "is", "compression", "data", "for", "with", "that", "package", "time", "on", "be",
+        "encryption", "as", "system", "this", "user", "filter", "by", "path", "it", "from",
+    };
+    const char* LEVELS[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+    const char* MODULES[] = {"BackupTask", "RestoreTask", "FileSystem", "FilePackager", "Encryption"};
+
+    // 语料只用随机引擎的原始输出，保证各平台生成的数据一致
+    std::string makeText(size_t size, std::mt19937& rng) {
+        std::string data;
+        data.reserve(size + 64);
+        size_t wordsInSentence = 0;
+        while (data.size() < size) {
+            std::string word = WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+            if (wordsInSentence == 0) {
+                word[0] = static_cast<char>(word[0] - 'a' + 'A');
+            }
+            data += word;
+            if (++wordsInSentence > 6 + rng() % 12) {
+                data += rng() % 4 == 0 ? ".\n" : ". ";
+                wordsInSentence = 0;
+            } else {
+                data += ' ';
+            }
+        }
+        data.resize(size);
+        return data;
+    }
+
+    std::string makeLogs(size_t size, std::mt19937& rng) {
+        std::string data;
+        data.reserve(size + 256);
+        uint64_t millis = 1700000000000ull;
+        while (data.size() < size) {
+            millis += rng() % 2000;
+            std::ostringstream line;
+            line << "2024-05-" << std::setw(2) << std::setfill('0') << (1 + millis / 86400000 % 28)
+                 << ' ' << std::setw(2) << millis / 3600000 % 24
+                 << ':' << std::setw(2) << millis / 60000 % 60
+                 << ':' << std::setw(2) << millis / 1000 % 60
+                 << '.' << std::setw(3) << millis % 1000
+                 << " [" << LEVELS[rng() % 6] << "] " << MODULES[rng() % 5]
+                 << ": processed /home/user/documents/project_" << rng() % 50
+                 << "/file_" << rng() % 1000 << ".txt size=" << rng() % 100000
+                 << " elapsed=" << rng() % 500 << "ms\n";
+            data += line.str();
+        }
+        data.resize(size);
+        return data;
+    }
+
+    // 接近可执行文件的数据：小整数字段、少量常见指令模式和零填充
+    std::string makeBinary(size_t size, std::mt19937& rng) {
+        static const unsigned char OPCODES[][4] = {
+            {0x48, 0x89, 0xE5, 0x90}, {0x48, 0x83, 0xEC, 0x20}, {0xE8, 0x00, 0x00, 0x00},
+            {0x8B, 0x45, 0xFC, 0x90}, {0xC3, 0x90, 0x90, 0x90}, {0x0F, 0x1F, 0x40, 0x00},
+        };
+        std::string data;
+        data.reserve(size + 64);
+        while (data.size() < size) {
+            unsigned kind = rng() % 10;
+            if (kind < 5) {
+                const unsigned char* op = OPCODES[rng() % 6];
+                data.append(reinterpret_cast<const char*>(op), 4);
+            } else if (kind < 8) {
+                uint32_t value = rng() % 4096;
+                for (int i = 0; i < 4; ++i) {
+                    data.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+                }
+            } else if (kind < 9) {
+                data.append(16 + rng() % 48, '\0');
+            } else {
+                for (int i = 0; i < 8; ++i) {
+                    data.push_back(static_cast<char>(rng() & 0xFF));
+                }
+            }
+        }
+        data.resize(size);
+        return data;
+    }
+
+    std::string makeRandom(size_t size, std::mt19937& rng) {
+        std::string data(size, '\0');
+        for (auto& c : data) {
+            c = static_cast<char>(rng() & 0xFF);
+        }
+        return data;
+    }
+
+    // 大量小文件（64字节到4 KiB的配置和源代码片段）
+    std::vector<std::string> makeTinyFiles(size_t totalSize, std::mt19937& rng) {
+        std::vector<std::string> files;
+        size_t total = 0;
+        while (total < totalSize) {
+            size_t size = 64 + rng() % 4033;
+            std::string file = rng() % 2 == 0 ? makeText(size, rng) : makeLogs(size, rng);
+            total += file.size();
+            files.push_back(std::move(file));
+        }
+        return files;
+    }
+
+    std::vector<Corpus> makeCorpora(size_t sizeBytes) {
+        std::mt19937 rng(20240501u);
+        std::vector<Corpus> corpora;
+        corpora.push_back({"text", {makeText(sizeBytes, rng)}});
+        corpora.push_back({"logs", {makeLogs(sizeBytes, rng)}});
+        corpora.push_back({"binary", {makeBinary(sizeBytes, rng)}});
+        corpora.push_back({"random", {makeRandom(sizeBytes, rng)}});
+        corpora.push_back({"tiny_files", makeTinyFiles(std::min<size_t>(sizeBytes, 8 << 20), rng)});
+        return corpora;
+    }
+
+    // 清除进程的内存峰值记录，使每次测量只反映当前阶段（仅Linux支持）
+    void resetPeakRss() {
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        if (clearRefs.is_open()) {
+            clearRefs << "5";
+        }
+    }
+
+    // 进程的内存峰值（KiB），包括已加载的语料本身
+    long peakRssKiB() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmHWM:") == 0) {
+                return std::stol(line.substr(6));
+            }
+        }
+#ifndef _WIN32
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            return usage.ru_maxrss;
+        }
+#endif
+        return 0;
+    }
+
+    double elapsedSeconds(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 对一份语料测量一种算法，吞吐量取多次运行中最好的一次
+    bool runBenchmark(CodecId id, const Corpus& corpus, size_t iterations, Result& result) {
+        result.codec = Codec::nameOf(id);
+        result.corpus = corpus.name;
+        result.fileCount = corpus.files.size();
+        result.inputBytes = corpus.totalBytes();
+        double inputMB = static_cast<double>(result.inputBytes) / (1024.0 * 1024.0);
+
+        double bestCompress = 0.0;
+        double bestDecompress = 0.0;
+        resetPeakRss();
+        for (size_t iteration = 0; iteration < iterations; ++iteration) {
+            std::vector<std::string> compressed;
+            compressed.reserve(corpus.files.size());
+
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& file : corpus.files) {
+                std::unique_ptr<Codec> codec = Codec::create(id);
+                std::istringstream in(file);
+                std::ostringstream out;
+                if (!codec->compress(in, out)) {
+                    std::cerr << result.codec << "/" << result.corpus << ": compression failed" << std::endl;
+                    return false;
+                }
+                compressed.push_back(out.str());
+            }
+            double compressSeconds = elapsedSeconds(start);
+
+            size_t outputBytes = 0;
+            std::vector<std::string> restored;
+            restored.reserve(corpus.files.size());
+            start = std::chrono::steady_clock::now();
+            for (const auto& data : compressed) {
+                std::unique_ptr<Codec> codec = Codec::create(id);
+                std::istringstream in(data);
+                std::ostringstream out;
+                if (!codec->decompress(in, out)) {
+                    std::cerr << result.codec << "/" << result.corpus << ": decompression failed" << std::endl;
+                    return false;
+                }
+                outputBytes += data.size();
+                restored.push_back(out.str());
+            }
+            double decompressSeconds = elapsedSeconds(start);
+
+            if (restored != corpus.files) {
+                std::cerr << result.codec << "/" << result.corpus << ": round trip mismatch" << std::endl;
+                return false;
+            }
+
+            result.outputBytes = outputBytes;
+            bestCompress = std::max(bestCompress, inputMB / std::max(compressSeconds, 1e-9));
+            bestDecompress = std::max(bestDecompress, inputMB / std::max(decompressSeconds, 1e-9));
+        }
+        result.compressMBps = bestCompress;
+        result.decompressMBps = bestDecompress;
+        result.peakRssKiB = peakRssKiB();
+        return true;
+    }
+
+    void writeJson(std::ostream& out, size_t sizeMiB, size_t iterations, const std::vector<Result>& results) {
+        out << "{\n"
+            << "  \"version\": 1,\n"
+            << "  \"sizeMiB\": " << sizeMiB << ",\n"
+            << "  \"iterations\": " << iterations << ",\n"
+            << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            double ratio = r.inputBytes ? static_cast<double>(r.outputBytes) / r.inputBytes : 0.0;
+            out << "    {\"codec\": \"" << r.codec << "\", \"corpus\": \"" << r.corpus << "\""
+                << ", \"files\": " << r.fileCount
+                << ", \"inputBytes\": " << r.inputBytes
+                << ", \"outputBytes\": " << r.outputBytes
+                << std::fixed << std::setprecision(4) << ", \"ratio\": " << ratio
+                << std::setprecision(2)
+                << ", \"compressMBps\": " << r.compressMBps
+                << ", \"decompressMBps\": " << r.decompressMBps
+                << ", \"peakRssKiB\": " << r.peakRssKiB << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: BackupBenchmarks [--size MiB] [--iterations N] [--codec huffman|lz] [--output file]" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t sizeMiB = 32;
+    size_t iterations = 3;
+    std::vector<CodecId> codecs = {CodecId::Huffman, CodecId::LZ};
+    std::string outputPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            sizeMiB = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--codec" && i + 1 < argc) {
+            CodecId id;
+            if (!Codec::fromName(argv[++i], id)) {
+                std::cerr << "Unknown codec: " << argv[i] << std::endl;
+                return 1;
+            }
+            codecs = {id};
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::vector<Corpus> corpora = makeCorpora(sizeMiB << 20);
+    std::vector<Result> results;
+    for (CodecId id : codecs) {
+        for (const auto& corpus : corpora) {
+            Result result;
+            if (!runBenchmark(id, corpus, iterations, result)) {
+                return 1;
+            }
+            // 进度输出到stderr，stdout只留给JSON
+            std::cerr << std::left << std::setw(8) << result.codec << std::setw(12) << result.corpus
+                      << std::fixed << std::setprecision(1)
+                      << " compress " << result.compressMBps << " MB/s, decompress "
+                      << result.decompressMBps << " MB/s, ratio "
+                      << std::setprecision(3) << static_cast<double>(result.outputBytes) / result.inputBytes
+                      << ", peak RSS " << result.peakRssKiB << " KiB" << std::endl;
+            results.push_back(result);
+        }
+    }
+
+    if (outputPath.empty()) {
+        writeJson(std::cout, sizeMiB, iterations, results);
+    } else {
+        std::ofstream out(outputPath);
+        if (!out.is_open()) {
+            std::cerr << "Cannot open " << outputPath << std::endl;
+            return 1;
+        }
+        writeJson(out, sizeMiB, iterations, results);
+    }
+    return 0;
+}
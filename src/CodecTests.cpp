@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include "utils/Codec.hpp"
+#include "utils/LzCompressor.hpp"
+#include "utils/HuffmanCompressor.hpp"
+
+namespace fs = std::filesystem;
+
+// Codec和LzCompressor测试用例
+class CodecTest : public ::testing::Test {
+protected:
+    fs::path testDir = fs::temp_directory_path() / "codec_test";
+
+    void SetUp() override {
+        fs::create_directories(testDir);
+    }
+
+    void TearDown() override {
+        fs::remove_all(testDir);
+    }
+
+    static void writeFile(const fs::path& path, const std::string& content) {
+        std::ofstream out(path, std::ios::binary);
+        out.write(content.data(), content.size());
+    }
+
+    static std::string readFile(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    // 类似日志的重复文本
+    static std::string makeLogText(size_t lines) {
+        std::string text;
+        for (size_t i = 0; i < lines; ++i) {
+            text += "2024-01-01 12:00:" + std::to_string(i % 60) + " INFO backup task finished file_" +
+                    std::to_string(i % 97) + ".txt\n";
+        }
+        return text;
+    }
+
+    static std::string makeRandom(size_t size, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::string data(size, '\0');
+        for (auto& c : data) {
+            c = static_cast<char>(rng() & 0xFF);
+        }
+        return data;
+    }
+};
+
+// 测试LZ块压缩往返，包括重叠匹配（偏移小于匹配长度）
+TEST_F(CodecTest, LzBlockRoundTrip) {
+    std::vector<std::string> inputs = {
+        "",
+        "abc",
+        std::string(1000, 'a'),
+        "abababababababababababababababababababab",
+        makeLogText(200),
+    };
+
+    for (const auto& input : inputs) {
+        std::vector<unsigned char> body;
+        const auto* data = reinterpret_cast<const unsigned char*>(input.data());
+        LzCompressor::compressBlock(data, input.size(), body);
+
+        std::vector<unsigned char> output(input.size());
+        ASSERT_TRUE(LzCompressor::decompressBlock(body.data(), body.size(), output.data(), output.size()));
+        EXPECT_EQ(input, std::string(output.begin(), output.end()));
+    }
+
+    // 重复内容应明显变小
+    std::string text = makeLogText(200);
+    std::vector<unsigned char> body;
+    LzCompressor::compressBlock(reinterpret_cast<const unsigned char*>(text.data()), text.size(), body);
+    EXPECT_LT(body.size(), text.size() / 3);
+}
+
+// 测试多块流式压缩往返，随机数据按原样存储
+TEST_F(CodecTest, LzStreamRoundTrip) {
+    LzCompressor compressor;
+    compressor.setBlockSize(4096);
+
+    std::string input = makeLogText(500) + makeRandom(10000, 1) + makeLogText(100);
+    std::istringstream in(input);
+    std::ostringstream compressed;
+    ASSERT_TRUE(compressor.compressStream(in, compressed));
+
+    std::istringstream compressedIn(compressed.str());
+    std::ostringstream output;
+    ASSERT_TRUE(compressor.decompressStream(compressedIn, output));
+    EXPECT_EQ(input, output.str());
+
+    // 随机数据不会膨胀太多（存储块只多出块头）
+    std::string random = makeRandom(50000, 2);
+    std::istringstream randomIn(random);
+    std::ostringstream randomOut;
+    ASSERT_TRUE(compressor.compressStream(randomIn, randomOut));
+    EXPECT_LT(randomOut.str().size(), random.size() + 256);
+}
+
+// 测试空文件
+TEST_F(CodecTest, LzEmptyFile) {
+    fs::path input = testDir / "empty.txt";
+    fs::path compressed = testDir / "empty.txt.lz";
+    fs::path output = testDir / "empty_out.txt";
+    writeFile(input, "");
+
+    LzCompressor compressor;
+    ASSERT_TRUE(compressor.compressFile(input.string(), compressed.string()));
+    ASSERT_TRUE(compressor.decompressFile(compressed.string(), output.string()));
+    EXPECT_EQ("", readFile(output));
+}
+
+// 测试损坏或截断的数据解压失败
+TEST_F(CodecTest, LzRejectsTruncatedInput) {
+    std::string input = makeLogText(300);
+    std::istringstream in(input);
+    std::ostringstream compressed;
+    LzCompressor compressor;
+    ASSERT_TRUE(compressor.compressStream(in, compressed));
+
+    std::string data = compressed.str();
+    std::istringstream truncated(data.substr(0, data.size() / 2));
+    std::ostringstream output;
+    EXPECT_FALSE(compressor.decompressStream(truncated, output));
+
+    // 偏移越界的序列：一个字面量后引用距离为2的位置
+    const unsigned char badBody[] = {0x10, 'x', 0x02, 0x00};
+    unsigned char out[5];
+    EXPECT_FALSE(LzCompressor::decompressBlock(badBody, sizeof(badBody), out, sizeof(out)));
+}
+
+// 测试按算法文件头分派压缩与解压
+TEST_F(CodecTest, CodecFileRoundTrip) {
+    fs::path input = testDir / "log.txt";
+    std::string content = makeLogText(1000);
+    writeFile(input, content);
+
+    for (CodecId id : {CodecId::Huffman, CodecId::LZ}) {
+        fs::path compressed = testDir / (std::string("log.txt") + Codec::extensionOf(id));
+        fs::path output = testDir / "log_out.txt";
+        ASSERT_TRUE(Codec::compressFile(id, input.string(), compressed.string()));
+
+        std::string header = readFile(compressed).substr(0, 6);
+        EXPECT_EQ("BKCD", header.substr(0, 4));
+        EXPECT_EQ(static_cast<char>(id), header[5]);
+
+        ASSERT_TRUE(Codec::decompressFile(compressed.string(), output.string()));
+        EXPECT_EQ(content, readFile(output));
+    }
+}
+
+// 测试没有算法文件头的旧.huff文件仍按Huffman格式解压
+TEST_F(CodecTest, DecompressLegacyHuffmanFile) {
+    fs::path input = testDir / "legacy.txt";
+    fs::path compressed = testDir / "legacy.txt.huff";
+    fs::path output = testDir / "legacy_out.txt";
+    std::string content = makeLogText(100);
+    writeFile(input, content);
+
+    HuffmanCompressor compressor;
+    ASSERT_TRUE(compressor.compressFile(input.string(), compressed.string()));
+    ASSERT_TRUE(Codec::decompressFile(compressed.string(), output.string()));
+    EXPECT_EQ(content, readFile(output));
+}
+
+// 测试算法名称与扩展名
+TEST_F(CodecTest, NamesAndExtensions) {
+    CodecId id = CodecId::Huffman;
+    EXPECT_TRUE(Codec::fromName("lz", id));
+    EXPECT_EQ(CodecId::LZ, id);
+    EXPECT_TRUE(Codec::fromName("huffman", id));
+    EXPECT_EQ(CodecId::Huffman, id);
+    EXPECT_FALSE(Codec::fromName("zstd", id));
+    EXPECT_STREQ("lz", Codec::nameOf(CodecId::LZ));
+
+    EXPECT_TRUE(Codec::hasCompressedExtension("a/b.txt.huff"));
+    EXPECT_TRUE(Codec::hasCompressedExtension("a/b.txt.lz"));
+    EXPECT_FALSE(Codec::hasCompressedExtension("a/b.txt"));
+    EXPECT_EQ("a/b.txt", Codec::stripCompressedExtension("a/b.txt.lz"));
+    EXPECT_EQ("a/b.txt", Codec::stripCompressedExtension("a/b.txt"));
+}
+
+// 测试按文件头判断压缩输出：带压缩扩展名但未压缩的文件不算
+TEST_F(CodecTest, IsCompressedFileChecksHeader) {
+    fs::path input = testDir / "input.log";
+    fs::path compressed = testDir / "input.log.lz";
+    fs::path raw = testDir / "notes.lz";
+    writeFile(input, makeLogText(500));
+    writeFile(raw, "plain notes, stored as is");
+    ASSERT_TRUE(Codec::compressFile(CodecId::LZ, input.string(), compressed.string()));
+
+    EXPECT_TRUE(Codec::isCompressedFile(compressed.string()));
+    EXPECT_FALSE(Codec::isCompressedFile(raw.string()));
+    EXPECT_FALSE(Codec::isCompressedFile(input.string()));
+    // 加密文件解密后的临时文件按还原目标的名称判断
+    EXPECT_TRUE(Codec::isCompressedFile(compressed.string(), "restore/input.log.lz"));
+    EXPECT_FALSE(Codec::isCompressedFile(compressed.string(), "restore/input.log"));
+}
+
+// 测试LZ的压缩率预估：随机数据跳过，日志文本压缩
+TEST_F(CodecTest, LzWorthCompressing) {
+    fs::path text = testDir / "text.log";
+    fs::path random = testDir / "random.bin";
+    writeFile(text, makeLogText(5000));
+    writeFile(random, makeRandom(300000, 3));
+
+    LzCompressor compressor;
+    EXPECT_TRUE(compressor.isWorthCompressing(text.string()));
+    EXPECT_FALSE(compressor.isWorthCompressing(random.string()));
+}
@@ -2,7 +2,13 @@
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
 #include "utils/Encryption.hpp"
+#include "utils/EncryptedStream.hpp"
 
 namespace fs = std::filesystem;
 
@@ -28,6 +34,8 @@ protected:
     }
     
     void TearDown() override {
+        // 恢复进程级的线程数设置，断言提前返回时也不影响后续用例
+        Encryption::setThreadCount(0);
         // 清理测试目录
         fs::remove_all(testDir);
     }
@@ -165,6 +173,345 @@ TEST_F(EncryptionTest, DifferentPasswordsDifferentResults) {
     EXPECT_FALSE(compareFiles(encryptedFile1, encryptedFile2));
 }
 
+// 测试跨越多个分段的文件
+TEST_F(EncryptionTest, EncryptDecryptMultiChunkFile) {
+    fs::path largeFile = testDir / "large.bin";
+    size_t size = Encryption::CHUNK_SIZE * 3 + 37;
+    {
+        std::ofstream out(largeFile, std::ios::binary);
+        for (size_t i = 0; i < size; ++i) {
+            out.put(static_cast<char>((i * 131 + i / 7) & 0xFF));
+        }
+    }
+
+    EXPECT_TRUE(Encryption::encryptFile(largeFile.string(), encryptedFile.string(), testPassword));
+    // 文件头 + 明文 + 每段一个标签
+    size_t segments = size / Encryption::SEGMENT_SIZE + 1;
+    EXPECT_EQ(Encryption::HEADER_SIZE + size + segments * Encryption::TAG_SIZE, fs::file_size(encryptedFile));
+    EXPECT_TRUE(Encryption::isSegmentedFile(encryptedFile.string()));
+
+    EXPECT_TRUE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+    EXPECT_TRUE(compareFiles(largeFile, decryptedFile));
+}
+
+// 测试截断的密文解密失败且不留下部分明文
+TEST_F(EncryptionTest, DecryptTruncatedFile) {
+    EXPECT_TRUE(Encryption::encryptFile(plaintextFile.string(), encryptedFile.string(), testPassword));
+    fs::resize_file(encryptedFile, fs::file_size(encryptedFile) - 5);
+
+    EXPECT_FALSE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+    EXPECT_FALSE(fs::exists(decryptedFile));
+
+    // 不足盐值和IV长度的文件
+    fs::resize_file(encryptedFile, 20);
+    EXPECT_FALSE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+}
+
+// 生成跨越多个分段的测试数据
+static std::string makeSegmentedContent(size_t size) {
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        content[i] = static_cast<char>((i * 131 + i / 7) & 0xFF);
+    }
+    return content;
+}
+
+// 测试篡改任意一段都会被认证检测到
+TEST_F(EncryptionTest, DetectTamperedSegment) {
+    fs::path largeFile = testDir / "large.bin";
+    std::ofstream(largeFile, std::ios::binary) << makeSegmentedContent(Encryption::SEGMENT_SIZE * 2 + 100);
+    ASSERT_TRUE(Encryption::encryptFile(largeFile.string(), encryptedFile.string(), testPassword));
+
+    // 修改第二段中的一个字节
+    {
+        std::fstream file(encryptedFile, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(Encryption::segmentOffset(1, Encryption::SEGMENT_SIZE) + 10);
+        char byte = 0;
+        file.read(&byte, 1);
+        file.seekp(Encryption::segmentOffset(1, Encryption::SEGMENT_SIZE) + 10);
+        byte = static_cast<char>(byte ^ 0x01);
+        file.write(&byte, 1);
+    }
+
+    EXPECT_FALSE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+    EXPECT_FALSE(fs::exists(decryptedFile));
+}
+
+// 测试在分段边界截断（去掉完整的末段）也会被检测到
+TEST_F(EncryptionTest, DetectTruncationAtSegmentBoundary) {
+    fs::path largeFile = testDir / "large.bin";
+    std::ofstream(largeFile, std::ios::binary) << makeSegmentedContent(Encryption::SEGMENT_SIZE * 2 + 100);
+    ASSERT_TRUE(Encryption::encryptFile(largeFile.string(), encryptedFile.string(), testPassword));
+
+    fs::resize_file(encryptedFile, Encryption::segmentOffset(2, Encryption::SEGMENT_SIZE));
+    EXPECT_FALSE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+}
+
+// 测试解密流的随机读取只依赖所读的分段
+TEST_F(EncryptionTest, DecryptingStreamRandomAccess) {
+    fs::path largeFile = testDir / "large.bin";
+    std::string content = makeSegmentedContent(Encryption::SEGMENT_SIZE * 3 + 1234);
+    std::ofstream(largeFile, std::ios::binary) << content;
+    ASSERT_TRUE(Encryption::encryptFile(largeFile.string(), encryptedFile.string(), testPassword));
+
+    DecryptingStreamBuf buf;
+    ASSERT_TRUE(buf.open(encryptedFile.string(), testPassword));
+    EXPECT_EQ(content.size(), buf.size());
+    std::istream in(&buf);
+
+    // 跨越分段边界读取
+    size_t offsets[] = {0, Encryption::SEGMENT_SIZE - 10, Encryption::SEGMENT_SIZE * 2 + 5, content.size() - 100, 17};
+    for (size_t offset : offsets) {
+        in.clear();
+        in.seekg(offset);
+        ASSERT_TRUE(in);
+        EXPECT_EQ(static_cast<std::streamoff>(offset), static_cast<std::streamoff>(in.tellg()));
+        std::string chunk(100, '\0');
+        in.read(&chunk[0], chunk.size());
+        EXPECT_EQ(content.substr(offset, 100), chunk.substr(0, static_cast<size_t>(in.gcount())));
+        EXPECT_EQ(100, in.gcount());
+    }
+
+    // 读到末尾
+    in.seekg(-10, std::ios::end);
+    std::string tail((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content.substr(content.size() - 10), tail);
+
+    // 篡改最后一段后，前面的分段仍可读取，读到最后一段时失败
+    {
+        std::fstream file(encryptedFile, std::ios::in | std::ios::out | std::ios::binary);
+        char byte = 0;
+        file.seekg(Encryption::segmentOffset(3, Encryption::SEGMENT_SIZE));
+        file.read(&byte, 1);
+        file.seekp(Encryption::segmentOffset(3, Encryption::SEGMENT_SIZE));
+        file.put(static_cast<char>(byte ^ 0x01));
+    }
+    DecryptingStreamBuf tampered;
+    ASSERT_TRUE(tampered.open(encryptedFile.string(), testPassword));
+    std::istream tamperedIn(&tampered);
+    std::string chunk(100, '\0');
+    tamperedIn.seekg(Encryption::SEGMENT_SIZE);
+    tamperedIn.read(&chunk[0], chunk.size());
+    EXPECT_EQ(content.substr(Encryption::SEGMENT_SIZE, 100), chunk);
+    tamperedIn.seekg(Encryption::SEGMENT_SIZE * 3);
+    EXPECT_FALSE(tamperedIn);
+    EXPECT_TRUE(tampered.failed());
+
+    // 错误密码无法打开
+    DecryptingStreamBuf wrong;
+    EXPECT_FALSE(wrong.open(encryptedFile.string(), wrongPassword));
+}
+
+// 测试多线程加解密：跨越多批槽位，且与单线程的结果互相兼容
+TEST_F(EncryptionTest, ParallelEncryptDecrypt) {
+    fs::path largeFile = testDir / "large.bin";
+    std::string content = makeSegmentedContent(Encryption::SEGMENT_SIZE * 70 + 321);
+    std::ofstream(largeFile, std::ios::binary) << content;
+
+    fs::path singleEncrypted = testDir / "single.enc";
+    fs::path singleDecrypted = testDir / "single.txt";
+
+    Encryption::setThreadCount(4);
+    EXPECT_EQ(4u, Encryption::getThreadCount());
+    ASSERT_TRUE(Encryption::encryptFile(largeFile.string(), encryptedFile.string(), testPassword));
+    ASSERT_TRUE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+    EXPECT_EQ(content, readFileContent(decryptedFile));
+
+    // 多线程加密的文件单线程解密，反之亦然
+    Encryption::setThreadCount(1);
+    ASSERT_TRUE(Encryption::decryptFile(encryptedFile.string(), singleDecrypted.string(), testPassword));
+    EXPECT_EQ(content, readFileContent(singleDecrypted));
+    ASSERT_TRUE(Encryption::encryptFile(largeFile.string(), singleEncrypted.string(), testPassword));
+    EXPECT_EQ(fs::file_size(encryptedFile), fs::file_size(singleEncrypted));
+
+    Encryption::setThreadCount(4);
+    ASSERT_TRUE(Encryption::decryptFile(singleEncrypted.string(), decryptedFile.string(), testPassword));
+    EXPECT_EQ(content, readFileContent(decryptedFile));
+
+    // 并行解密时同样能发现被篡改的分段
+    {
+        std::fstream file(encryptedFile, std::ios::in | std::ios::out | std::ios::binary);
+        char byte = 0;
+        file.seekg(Encryption::segmentOffset(37, Encryption::SEGMENT_SIZE) + 3);
+        file.read(&byte, 1);
+        file.seekp(Encryption::segmentOffset(37, Encryption::SEGMENT_SIZE) + 3);
+        file.put(static_cast<char>(byte ^ 0x01));
+    }
+    EXPECT_FALSE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+}
+
+// 测试作业级密钥缓存：整个作业只运行一次PBKDF2，文件共用盐值和密钥ID但密钥各不相同
+TEST_F(EncryptionTest, KeyCacheDerivesOncePerJob) {
+    const int fileCount = 5;
+    KeyCache backupKeys(testPassword);
+    for (int i = 0; i < fileCount; ++i) {
+        fs::path source = testDir / ("file" + std::to_string(i) + ".txt");
+        std::ofstream(source) << "file " << i << " " << readFileContent(plaintextFile);
+        ASSERT_TRUE(Encryption::encryptFile(source.string(), source.string() + ".enc", backupKeys));
+    }
+    EXPECT_EQ(1u, backupKeys.getDerivationCount());
+
+    // 各文件头的盐值和密钥ID相同，nonce不同
+    std::vector<EncryptionHeader> headers(fileCount);
+    for (int i = 0; i < fileCount; ++i) {
+        uint8_t bytes[Encryption::HEADER_SIZE];
+        std::ifstream in(testDir / ("file" + std::to_string(i) + ".txt.enc"), std::ios::binary);
+        in.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+        ASSERT_TRUE(headers[i].parse(bytes));
+    }
+    for (int i = 1; i < fileCount; ++i) {
+        EXPECT_EQ(0, std::memcmp(headers[0].salt, headers[i].salt, sizeof(headers[0].salt)));
+        EXPECT_EQ(headers[0].keyId, headers[i].keyId);
+        EXPECT_NE(0, std::memcmp(headers[0].nonce, headers[i].nonce, sizeof(headers[0].nonce)));
+    }
+
+    // 还原时同样只派生一次
+    KeyCache restoreKeys(testPassword);
+    for (int i = 0; i < fileCount; ++i) {
+        fs::path source = testDir / ("file" + std::to_string(i) + ".txt");
+        fs::path restored = testDir / ("restored" + std::to_string(i) + ".txt");
+        ASSERT_TRUE(Encryption::decryptFile(source.string() + ".enc", restored.string(), restoreKeys));
+        EXPECT_TRUE(compareFiles(source, restored));
+    }
+    EXPECT_EQ(1u, restoreKeys.getDerivationCount());
+
+    // 错误的密码在密钥ID处即被拒绝
+    KeyCache wrongKeys(wrongPassword);
+    std::vector<uint8_t> key;
+    EXPECT_FALSE(wrongKeys.fileKey(headers[0], key));
+    EXPECT_FALSE(Encryption::decryptFile((testDir / "file0.txt.enc").string(), decryptedFile.string(), wrongKeys));
+}
+
+// 测试加密流：分多次写入任意长度的数据，结果与encryptFile格式相同
+TEST_F(EncryptionTest, EncryptingStreamRoundTrip) {
+    // 空数据、不足一段、恰好整段、跨多段
+    const size_t sizes[] = {0, 1000, Encryption::SEGMENT_SIZE * 2, Encryption::SEGMENT_SIZE * 3 + 77};
+    KeyCache keys(testPassword);
+    for (size_t size : sizes) {
+        std::string content = makeSegmentedContent(size);
+        {
+            EncryptingStreamBuf buf;
+            ASSERT_TRUE(buf.open(encryptedFile.string(), keys));
+            std::ostream out(&buf);
+            for (size_t pos = 0; pos < content.size();) {
+                size_t piece = std::min<size_t>(content.size() - pos, 1 + (pos * 7) % 50000);
+                out.write(content.data() + pos, piece);
+                pos += piece;
+            }
+            ASSERT_TRUE(out.good());
+            EXPECT_EQ(size, buf.size());
+            ASSERT_TRUE(buf.close());
+        }
+
+        uint64_t segments = size == 0 ? 1 : (size + Encryption::SEGMENT_SIZE - 1) / Encryption::SEGMENT_SIZE;
+        EXPECT_EQ(Encryption::HEADER_SIZE + size + segments * Encryption::TAG_SIZE, fs::file_size(encryptedFile));
+        ASSERT_TRUE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword)) << size;
+        EXPECT_EQ(content, readFileContent(decryptedFile));
+    }
+}
+
+// 测试多线程加解密流：数据跨越多轮槽位环，顺序读取时预读并行解密，随机定位和篡改检测不受影响
+TEST_F(EncryptionTest, ParallelEncryptingAndDecryptingStreams) {
+    Encryption::setThreadCount(4);
+    // 4个线程时环中有8个槽位，每个槽位4段
+    size_t ringBytes = 8 * Encryption::SEGMENTS_PER_SLOT * Encryption::SEGMENT_SIZE;
+    std::string content = makeSegmentedContent(ringBytes * 2 + Encryption::SEGMENT_SIZE * 5 + 77);
+    KeyCache keys(testPassword);
+    {
+        EncryptingStreamBuf buf;
+        ASSERT_TRUE(buf.open(encryptedFile.string(), keys));
+        std::ostream out(&buf);
+        for (size_t pos = 0; pos < content.size();) {
+            size_t piece = std::min<size_t>(content.size() - pos, 1 + (pos * 13) % 300000);
+            out.write(content.data() + pos, piece);
+            pos += piece;
+        }
+        ASSERT_TRUE(out.good());
+        EXPECT_EQ(content.size(), buf.size());
+        ASSERT_TRUE(buf.close());
+    }
+
+    // 与单线程解密的结果相同
+    Encryption::setThreadCount(1);
+    ASSERT_TRUE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+    EXPECT_EQ(content, readFileContent(decryptedFile));
+    Encryption::setThreadCount(4);
+
+    {
+        DecryptingStreamBuf buf;
+        ASSERT_TRUE(buf.open(encryptedFile.string(), keys));
+        std::istream in(&buf);
+        std::string all((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        EXPECT_EQ(content, all);
+
+        in.clear();
+        size_t offsets[] = {ringBytes + 3, 5, ringBytes * 2 - 50};
+        for (size_t offset : offsets) {
+            in.seekg(offset);
+            std::string chunk(1000, '\0');
+            in.read(&chunk[0], chunk.size());
+            EXPECT_EQ(content.substr(offset, chunk.size()), chunk);
+        }
+    }
+
+    // 篡改较后的一段：顺序读取在到达该段之前的数据都正确，之后失败
+    size_t tamperedSegment = 40;
+    {
+        std::fstream file(encryptedFile, std::ios::in | std::ios::out | std::ios::binary);
+        char byte = 0;
+        file.seekg(Encryption::segmentOffset(tamperedSegment, Encryption::SEGMENT_SIZE));
+        file.read(&byte, 1);
+        file.seekp(Encryption::segmentOffset(tamperedSegment, Encryption::SEGMENT_SIZE));
+        file.put(static_cast<char>(byte ^ 0x01));
+    }
+    {
+        DecryptingStreamBuf buf;
+        ASSERT_TRUE(buf.open(encryptedFile.string(), keys));
+        std::istream in(&buf);
+        std::string all((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        EXPECT_TRUE(buf.failed());
+        ASSERT_LE(all.size(), tamperedSegment * Encryption::SEGMENT_SIZE);
+        EXPECT_GE(all.size(), (tamperedSegment - Encryption::SEGMENTS_PER_SLOT) * Encryption::SEGMENT_SIZE);
+        EXPECT_EQ(content.substr(0, all.size()), all);
+    }
+}
+
+// 测试旧格式（盐值 + IV + 整体CBC密文）仍可解密
+TEST_F(EncryptionTest, DecryptLegacyCbcFile) {
+    std::string content = readFileContent(plaintextFile);
+
+    unsigned char salt[16];
+    unsigned char iv[16];
+    unsigned char key[32];
+    ASSERT_EQ(1, RAND_bytes(salt, sizeof(salt)));
+    ASSERT_EQ(1, RAND_bytes(iv, sizeof(iv)));
+    ASSERT_EQ(1, PKCS5_PBKDF2_HMAC(testPassword.c_str(), testPassword.size(), salt, sizeof(salt),
+                                   10000, EVP_sha256(), sizeof(key), key));
+
+    std::vector<unsigned char> ciphertext(content.size() + 16);
+    int len = 0;
+    int total = 0;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key, iv);
+    EVP_EncryptUpdate(ctx, ciphertext.data(), &len,
+                      reinterpret_cast<const unsigned char*>(content.data()), content.size());
+    total = len;
+    EVP_EncryptFinal_ex(ctx, ciphertext.data() + total, &len);
+    total += len;
+    EVP_CIPHER_CTX_free(ctx);
+
+    {
+        std::ofstream out(encryptedFile, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(salt), sizeof(salt));
+        out.write(reinterpret_cast<const char*>(iv), sizeof(iv));
+        out.write(reinterpret_cast<const char*>(ciphertext.data()), total);
+    }
+
+    EXPECT_FALSE(Encryption::isSegmentedFile(encryptedFile.string()));
+    EXPECT_TRUE(Encryption::decryptFile(encryptedFile.string(), decryptedFile.string(), testPassword));
+    EXPECT_EQ(content, readFileContent(decryptedFile));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -3,8 +3,11 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <cstdio>
+#include <cstring>
 #include "utils/FilePackager.hpp"
 #include "core/models/File.hpp"
+#include "core/Filter.hpp"
 
 namespace fs = std::filesystem;
 
@@ -299,6 +302,344 @@ TEST_F(FilePackagerTest, UnpackNonExistentPackage) {
     EXPECT_FALSE(fs::exists(unpackDir));
 }
 
+// 测试打包超过写入缓冲区大小的文件：内容分块流式写入，解包后与源文件相同
+TEST_F(FilePackagerTest, PackageLargeFileInChunks) {
+    {
+        std::ofstream large(sourceDir / "large.bin", std::ios::binary);
+        for (int i = 0; i < 300000; ++i) {
+            large.put(static_cast<char>((i * 131) ^ (i >> 7)));
+        }
+    }
+    
+    FilePackager packager;
+    EXPECT_TRUE(packager.packageFiles(getFilesFromDirectory(sourceDir), packageFile.string(), sourceDir.string()));
+    EXPECT_TRUE(packager.unpackFiles(packageFile.string(), unpackDir.string()));
+    EXPECT_EQ(fs::file_size(sourceDir / "large.bin"), fs::file_size(unpackDir / "large.bin"));
+    EXPECT_TRUE(compareDirectories(sourceDir, unpackDir));
+    
+    // 从输入流解包时不能在内核中复制，走缓冲区复制，结果相同
+    fs::path streamUnpackDir = testDir / "stream_unpacked";
+    std::ifstream packageStream(packageFile, std::ios::binary);
+    EXPECT_TRUE(packager.unpackFiles(packageStream, streamUnpackDir.string()));
+    EXPECT_TRUE(compareDirectories(sourceDir, streamUnpackDir));
+}
+
+// 测试流式写入：写出v2格式（条目表在包尾），解包结果与源目录相同
+TEST_F(FilePackagerTest, PackageWriterStreamsIntoPackage) {
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        PackageWriter writer(out);
+        for (const auto& file : getFilesFromDirectory(sourceDir)) {
+            EXPECT_TRUE(writer.addFile(file, file.getRelativePath(sourceDir).string()));
+        }
+        EXPECT_TRUE(writer.finish());
+        EXPECT_FALSE(writer.addFile(File(sourceDir / "file1.txt"), "late.txt"));
+    }
+    
+    char head[sizeof(PACKAGE_V2_MAGIC)] = {};
+    std::ifstream(packageFile, std::ios::binary).read(head, sizeof(head));
+    EXPECT_EQ(0, std::memcmp(head, PACKAGE_V2_MAGIC, sizeof(head)));
+    
+    FilePackager packager;
+    EXPECT_TRUE(packager.unpackFiles(packageFile.string(), unpackDir.string()));
+    EXPECT_TRUE(compareDirectories(sourceDir, unpackDir));
+}
+
+// 测试流式写入压缩条目：条目名带压缩扩展名，内容可按文件头解压
+TEST_F(FilePackagerTest, PackageWriterCompressedEntry) {
+    {
+        std::ofstream log(sourceDir / "app.log");
+        for (int i = 0; i < 2000; ++i) {
+            log << "INFO request " << i << " handled\n";
+        }
+    }
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        PackageWriter writer(out);
+        uint64_t compressedSize = 0;
+        EXPECT_TRUE(writer.addCompressedFile(File(sourceDir / "app.log"), "app.log", CodecId::LZ, compressedSize));
+        EXPECT_GT(compressedSize, 0u);
+        EXPECT_LT(compressedSize, fs::file_size(sourceDir / "app.log"));
+        EXPECT_TRUE(writer.finish());
+    }
+    
+    FilePackager packager;
+    EXPECT_TRUE(packager.unpackFiles(packageFile.string(), unpackDir.string()));
+    fs::path entry = unpackDir / ("app.log" + std::string(Codec::extensionOf(CodecId::LZ)));
+    ASSERT_TRUE(fs::exists(entry));
+    EXPECT_TRUE(Codec::decompressFile(entry.string(), (testDir / "app.log").string()));
+    
+    std::ifstream original(sourceDir / "app.log");
+    std::ifstream restored(testDir / "app.log");
+    EXPECT_EQ(std::string((std::istreambuf_iterator<char>(original)), std::istreambuf_iterator<char>()),
+              std::string((std::istreambuf_iterator<char>(restored)), std::istreambuf_iterator<char>()));
+}
+
+// 测试包索引：按条目名查找并只解出一个文件
+TEST_F(FilePackagerTest, IndexLookupAndExtractOne) {
+    FilePackager packager;
+    ASSERT_TRUE(packager.packageFiles(getFilesFromDirectory(sourceDir), packageFile.string(), sourceDir.string()));
+    
+    ASSERT_TRUE(packager.loadIndex(packageFile.string()));
+    EXPECT_EQ(getFilesFromDirectory(sourceDir).size(), packager.getEntryCount());
+    
+    std::string entryName = (fs::path("subdir1") / "file3.txt").string();
+    FileMetadata entry;
+    ASSERT_TRUE(packager.findEntry(entryName, entry));
+    EXPECT_EQ(fs::file_size(sourceDir / "subdir1" / "file3.txt"), entry.fileSize);
+    EXPECT_FALSE(packager.findEntry("missing.txt", entry));
+    
+    EXPECT_TRUE(packager.extractOne(entryName, unpackDir.string()));
+    EXPECT_FALSE(packager.extractOne("missing.txt", unpackDir.string()));
+    
+    std::ifstream restored(unpackDir / "subdir1" / "file3.txt");
+    EXPECT_EQ("Content of file 3 in subdir1",
+              std::string((std::istreambuf_iterator<char>(restored)), std::istreambuf_iterator<char>()));
+    EXPECT_FALSE(fs::exists(unpackDir / "file1.txt"));
+    EXPECT_FALSE(fs::exists(unpackDir / "subdir2" / "file4.txt"));
+}
+
+// 测试按过滤器解出条目：条目按去掉压缩扩展名后的名称匹配
+TEST_F(FilePackagerTest, ExtractMatchingFilters) {
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        PackageWriter writer(out);
+        uint64_t compressedSize = 0;
+        EXPECT_TRUE(writer.addFile(File(sourceDir / "file1.txt"), "file1.txt"));
+        EXPECT_TRUE(writer.addCompressedFile(File(sourceDir / "file2.txt"), "file2.txt", CodecId::LZ, compressedSize));
+        EXPECT_TRUE(writer.addFile(File(sourceDir / "subdir2" / "file4.txt"), "subdir2/file4.txt"));
+        EXPECT_TRUE(writer.finish());
+    }
+    
+    auto nameFilter = std::make_shared<NameFilter>();
+    nameFilter->addIncludePattern("^file[24]\\.txt$");
+    std::vector<std::shared_ptr<Filter>> filters = {nameFilter};
+    
+    FilePackager packager;
+    ASSERT_TRUE(packager.loadIndex(packageFile.string()));
+    std::vector<std::string> extracted;
+    EXPECT_TRUE(packager.extractMatching(filters, unpackDir.string(), extracted));
+    
+    std::string compressedEntry = "file2.txt" + std::string(Codec::extensionOf(CodecId::LZ));
+    EXPECT_EQ((std::vector<std::string>{compressedEntry, "subdir2/file4.txt"}), extracted);
+    EXPECT_TRUE(fs::exists(unpackDir / compressedEntry));
+    EXPECT_TRUE(fs::exists(unpackDir / "subdir2" / "file4.txt"));
+    EXPECT_FALSE(fs::exists(unpackDir / "file1.txt"));
+}
+
+// 测试解出时直接从包中解压：映射和按流加载的索引都写出去掉压缩扩展名的原始内容
+TEST_F(FilePackagerTest, ExtractMatchingDecompresses) {
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        PackageWriter writer(out);
+        uint64_t compressedSize = 0;
+        EXPECT_TRUE(writer.addCompressedFile(File(sourceDir / "file2.txt"), "file2.txt", CodecId::LZ, compressedSize));
+        EXPECT_TRUE(writer.addCompressedFile(File(sourceDir / "subdir1" / "file3.txt"), "subdir1/file3.txt",
+                                             CodecId::Huffman, compressedSize));
+        EXPECT_TRUE(writer.finish());
+    }
+    std::vector<std::shared_ptr<Filter>> noFilters;
+    
+    FilePackager packager;
+    ASSERT_TRUE(packager.loadIndex(packageFile.string()));
+    std::vector<std::string> extracted;
+    ASSERT_TRUE(packager.extractMatching(noFilters, (unpackDir / "mapped").string(), extracted, true));
+    
+    std::ifstream packageStream(packageFile, std::ios::binary);
+    FilePackager streamPackager;
+    ASSERT_TRUE(streamPackager.loadIndex(packageStream));
+    ASSERT_TRUE(streamPackager.extractMatching(noFilters, (unpackDir / "stream").string(), extracted, true));
+    EXPECT_EQ(2u, extracted.size());
+    
+    for (const char* dir : {"mapped", "stream"}) {
+        std::ifstream file2(unpackDir / dir / "file2.txt");
+        EXPECT_EQ("Content of file 2",
+                  std::string((std::istreambuf_iterator<char>(file2)), std::istreambuf_iterator<char>()));
+        std::ifstream file3(unpackDir / dir / "subdir1" / "file3.txt");
+        EXPECT_EQ("Content of file 3 in subdir1",
+                  std::string((std::istreambuf_iterator<char>(file3)), std::istreambuf_iterator<char>()));
+        EXPECT_FALSE(fs::exists(unpackDir / dir / ("file2.txt" + std::string(Codec::extensionOf(CodecId::LZ)))));
+    }
+}
+
+// 测试按原样写入、文件名恰好带压缩扩展名的条目：按压缩标志而不是文件名判断，原样解出
+TEST_F(FilePackagerTest, ExtractMatchingKeepsRawEntryWithCompressedExtension) {
+    std::string rawName = "notes" + std::string(Codec::extensionOf(CodecId::LZ));
+    std::ofstream(sourceDir / rawName) << "plain notes";
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        PackageWriter writer(out);
+        uint64_t compressedSize = 0;
+        EXPECT_TRUE(writer.addFile(File(sourceDir / rawName), rawName));
+        EXPECT_TRUE(writer.addCompressedFile(File(sourceDir / "file2.txt"), "file2.txt", CodecId::LZ, compressedSize));
+        EXPECT_TRUE(writer.finish());
+    }
+    
+    FilePackager packager;
+    ASSERT_TRUE(packager.loadIndex(packageFile.string()));
+    FileMetadata entry;
+    ASSERT_TRUE(packager.findEntry(rawName, entry));
+    EXPECT_FALSE(entry.isCompressed);
+    EXPECT_EQ(rawName, FilePackager::entryToFile(entry).getFilePath().string());
+    
+    std::vector<std::string> extracted;
+    ASSERT_TRUE(packager.extractMatching({}, unpackDir.string(), extracted, true));
+    std::ifstream notes(unpackDir / rawName);
+    EXPECT_EQ("plain notes", std::string((std::istreambuf_iterator<char>(notes)), std::istreambuf_iterator<char>()));
+    EXPECT_FALSE(fs::exists(unpackDir / "notes"));
+    EXPECT_TRUE(fs::exists(unpackDir / "file2.txt"));
+}
+
+// 测试目录的时间戳在其中的文件解出后恢复：条目表中目录排在其中的文件之前，写入文件不能覆盖目录的修改时间
+TEST_F(FilePackagerTest, UnpackRestoresDirectoryTimes) {
+    fs::file_time_type oldTime = fs::last_write_time(sourceDir / "subdir1") - std::chrono::hours(24 * 365 * 20);
+    fs::last_write_time(sourceDir / "subdir1", oldTime);
+    
+    FilePackager packager;
+    ASSERT_TRUE(packager.packageFiles(getFilesFromDirectory(sourceDir), packageFile.string(), sourceDir.string()));
+    
+    ASSERT_TRUE(packager.unpackFiles(packageFile.string(), (unpackDir / "all").string()));
+    ASSERT_TRUE(packager.loadIndex(packageFile.string()));
+    std::vector<std::string> extracted;
+    ASSERT_TRUE(packager.extractMatching({}, (unpackDir / "matching").string(), extracted));
+    
+    // 包中的时间戳精确到秒
+    for (const char* dir : {"all", "matching"}) {
+        EXPECT_TRUE(fs::exists(unpackDir / dir / "subdir1" / "file3.txt"));
+        auto restoredTime = fs::last_write_time(unpackDir / dir / "subdir1");
+        EXPECT_LT(std::chrono::abs(restoredTime - oldTime), std::chrono::seconds(1)) << dir;
+    }
+}
+
+// 测试映射读取v2包：条目表按名称排序，二分查找，内容直接指向映射内存
+TEST_F(FilePackagerTest, MappedPackageLookup) {
+    const int entryCount = 5000;
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        PackageWriter writer(out);
+        // 倒序写入，验证条目表按名称排序
+        for (int i = entryCount - 1; i >= 0; --i) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "dir%d/entry%05d.txt", i % 7, i);
+            fs::path source = sourceDir / (i % 2 == 0 ? "file1.txt" : "subdir1/file3.txt");
+            ASSERT_TRUE(writer.addFile(File(source), name));
+        }
+        ASSERT_TRUE(writer.addFile(File(sourceDir / "subdir1"), "dir0"));
+        ASSERT_TRUE(writer.finish());
+    }
+    
+    MappedPackage package;
+    ASSERT_TRUE(package.open(packageFile.string()));
+    ASSERT_EQ(static_cast<size_t>(entryCount + 1), package.getEntryCount());
+    for (size_t i = 1; i < package.getEntryCount(); ++i) {
+        EXPECT_LT(package.name(package.entry(i - 1)), package.name(package.entry(i)));
+    }
+    
+    const PackageEntry* entry = package.find("dir2/entry01234.txt");
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(0, entry->fileType);
+    EXPECT_EQ("Content of file 1", std::string(package.content(*entry), entry->size));
+    entry = package.find("dir3/entry01235.txt");
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ("Content of file 3 in subdir1", std::string(package.content(*entry), entry->size));
+    
+    entry = package.find("dir0");
+    ASSERT_NE(nullptr, entry);
+    EXPECT_EQ(1, entry->fileType);
+    EXPECT_EQ(nullptr, package.find("dir3/entry01234.txt"));
+    EXPECT_EQ(nullptr, package.find("missing"));
+    
+    // 按路径和按流加载的索引一致
+    FilePackager packager;
+    ASSERT_TRUE(packager.loadIndex(packageFile.string()));
+    ASSERT_EQ(package.getEntryCount(), packager.getEntryCount());
+    FileMetadata fileMeta;
+    ASSERT_TRUE(packager.findEntry("dir2/entry01234.txt", fileMeta));
+    EXPECT_EQ(package.find("dir2/entry01234.txt")->offset, fileMeta.offset);
+    
+    std::ifstream packageStream(packageFile, std::ios::binary);
+    FilePackager streamPackager;
+    ASSERT_TRUE(streamPackager.loadIndex(packageStream));
+    ASSERT_EQ(package.getEntryCount(), streamPackager.getEntryCount());
+    FileMetadata streamMeta;
+    ASSERT_TRUE(streamPackager.findEntry("dir2/entry01234.txt", streamMeta));
+    EXPECT_EQ(fileMeta.offset, streamMeta.offset);
+    EXPECT_EQ(fileMeta.fileSize, streamMeta.fileSize);
+    EXPECT_FALSE(streamPackager.findEntry("missing", streamMeta));
+    
+    // 两种方式解出的内容相同
+    ASSERT_TRUE(packager.extractOne("dir3/entry01235.txt", unpackDir.string()));
+    ASSERT_TRUE(streamPackager.extractOne("dir2/entry01234.txt", unpackDir.string()));
+    std::ifstream mappedOut(unpackDir / "dir3" / "entry01235.txt");
+    EXPECT_EQ("Content of file 3 in subdir1",
+              std::string((std::istreambuf_iterator<char>(mappedOut)), std::istreambuf_iterator<char>()));
+    std::ifstream streamOut(unpackDir / "dir2" / "entry01234.txt");
+    EXPECT_EQ("Content of file 1",
+              std::string((std::istreambuf_iterator<char>(streamOut)), std::istreambuf_iterator<char>()));
+}
+
+// 测试映射读取拒绝v1包和损坏的包尾
+TEST_F(FilePackagerTest, MappedPackageRejectsInvalidPackage) {
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        PackageWriter writer(out);
+        ASSERT_TRUE(writer.addFile(File(sourceDir / "file1.txt"), "file1.txt"));
+        ASSERT_TRUE(writer.finish());
+    }
+    // 破坏包尾中的条目数
+    {
+        std::fstream file(packageFile, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-static_cast<std::streamoff>(sizeof(PackageTrailer)) + 8, std::ios::end);
+        uint64_t bogusCount = 1000000;
+        file.write(reinterpret_cast<const char*>(&bogusCount), sizeof(bogusCount));
+    }
+    MappedPackage package;
+    EXPECT_FALSE(package.open(packageFile.string()));
+    FilePackager packager;
+    EXPECT_FALSE(packager.loadIndex(packageFile.string()));
+    
+    EXPECT_FALSE(package.open((sourceDir / "file1.txt").string()));
+}
+
+// 测试仍可解包旧的v1格式（文件头为元数据偏移）
+TEST_F(FilePackagerTest, UnpackLegacyV1Package) {
+    std::string content = "Content of file 1";
+    {
+        std::ofstream out(packageFile, std::ios::binary);
+        uint64_t metadataOffset = sizeof(uint64_t) + content.size();
+        out.write(reinterpret_cast<const char*>(&metadataOffset), sizeof(metadataOffset));
+        out.write(content.data(), content.size());
+        
+        uint32_t count = 1;
+        std::string name = "legacy.txt";
+        uint32_t nameLength = name.size();
+        uint64_t size = content.size();
+        uint64_t offset = sizeof(uint64_t);
+        bool compressed = false;
+        uint32_t permissions = 0644;
+        uint64_t timestamp = 1700000000;
+        uint16_t fileType = 0;
+        uint32_t targetLength = 0;
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(&nameLength), sizeof(nameLength));
+        out.write(name.data(), name.size());
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        out.write(reinterpret_cast<const char*>(&compressed), sizeof(compressed));
+        out.write(reinterpret_cast<const char*>(&permissions), sizeof(permissions));
+        for (int i = 0; i < 3; ++i) {
+            out.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+        }
+        out.write(reinterpret_cast<const char*>(&fileType), sizeof(fileType));
+        out.write(reinterpret_cast<const char*>(&targetLength), sizeof(targetLength));
+    }
+    
+    FilePackager packager;
+    EXPECT_TRUE(packager.unpackFiles(packageFile.string(), unpackDir.string()));
+    std::ifstream restored(unpackDir / "legacy.txt");
+    EXPECT_EQ(content, std::string((std::istreambuf_iterator<char>(restored)), std::istreambuf_iterator<char>()));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
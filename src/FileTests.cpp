@@ -5,7 +5,19 @@
 #include <string>
 #include <vector>
 #include <thread>
+#include <set>
+#include <mutex>
+#include <stdexcept>
 #include "core/models/File.hpp"
+#include "core/models/FileCatalog.hpp"
+#include "utils/DirectoryWalker.hpp"
+#include "utils/FileSystem.hpp"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 using namespace std::chrono;
@@ -254,6 +266,271 @@ TEST_F(FileTest, SpecialFileTypes) {
     EXPECT_FALSE(regularFile.isSocket());
 }
 
+// 测试访问时间和修改时间分别读取，而不是都用修改时间代替
+TEST_F(FileTest, SeparateAccessAndModifiedTimes) {
+#ifndef _WIN32
+    struct timespec times[2];
+    times[0].tv_sec = 1600000000;   // 访问时间
+    times[0].tv_nsec = 250000000;
+    times[1].tv_sec = 1500000000;   // 修改时间
+    times[1].tv_nsec = 0;
+    ASSERT_EQ(0, utimensat(AT_FDCWD, testFile.c_str(), times, 0));
+    
+    File file(testFile);
+    EXPECT_EQ(1600000000250LL, duration_cast<milliseconds>(file.getLastAccessTime().time_since_epoch()).count());
+    EXPECT_EQ(1500000000LL, duration_cast<seconds>(file.getLastModifiedTime().time_since_epoch()).count());
+#endif
+}
+
+// 测试按已打开目录和名称初始化与按路径初始化结果一致
+TEST_F(FileTest, InitializeAtMatchesInitialize) {
+#ifndef _WIN32
+    int dirFd = open(testDir.c_str(), O_RDONLY | O_DIRECTORY);
+    ASSERT_GE(dirFd, 0);
+    for (const char* name : {"test.txt", "subdir", "symlink.txt", "missing"}) {
+        File byPath(testDir / name);
+        File byName;
+        byName.initializeAt(dirFd, name, testDir / name);
+        EXPECT_EQ(byPath.getFileType(), byName.getFileType()) << name;
+        EXPECT_EQ(byPath.getFileSize(), byName.getFileSize()) << name;
+        EXPECT_EQ(byPath.getPermissions(), byName.getPermissions()) << name;
+        EXPECT_EQ(byPath.getSymlinkTarget(), byName.getSymlinkTarget()) << name;
+        EXPECT_EQ(testDir / name, byName.getFilePath());
+    }
+    close(dirFd);
+    
+    File link(testSymlink);
+    if (link.isSymbolicLink()) {
+        EXPECT_EQ(testFile, link.getSymlinkTarget());
+    }
+    EXPECT_EQ(fs::file_type::none, File(testDir / "missing").getFileType());
+#endif
+}
+
+// 多线程目录遍历测试用例
+class DirectoryWalkerTest : public ::testing::Test {
+protected:
+    fs::path rootDir = fs::temp_directory_path() / "backup_walker_test";
+    
+    void SetUp() override {
+        fs::remove_all(rootDir);
+        // 多层目录，每层若干文件，另有空目录
+        for (int a = 0; a < 4; ++a) {
+            for (int b = 0; b < 5; ++b) {
+                fs::path dir = rootDir / ("a" + std::to_string(a)) / ("b" + std::to_string(b));
+                fs::create_directories(dir);
+                for (int f = 0; f < 6; ++f) {
+                    std::ofstream(dir / ("file" + std::to_string(f) + ".txt")) << a << b << f;
+                }
+            }
+        }
+        fs::create_directories(rootDir / "empty" / "nested");
+        // 指向目录和文件的符号链接，以及指向祖先目录的循环链接
+        fs::create_directory_symlink(rootDir / "a1", rootDir / "a0" / "link_to_a1");
+        fs::create_symlink(rootDir / "a2" / "b0" / "file0.txt", rootDir / "link_to_file");
+        fs::create_directory_symlink(rootDir / "a3", rootDir / "a3" / "b0" / "loop");
+    }
+    
+    void TearDown() override {
+        fs::remove_all(rootDir);
+    }
+    
+    static std::set<std::string> pathsOf(const std::vector<File>& files) {
+        std::set<std::string> paths;
+        for (const auto& file : files) {
+            paths.insert(file.getFilePath().string());
+        }
+        return paths;
+    }
+};
+
+// 测试不同线程数、不同目录读取方式得到相同的条目集合
+TEST_F(DirectoryWalkerTest, SameEntriesForAnyThreadCount) {
+    DirectoryWalker reference(1);
+    reference.setUseGetdents(false);
+    std::vector<File> expected = reference.walk(rootDir);
+    std::set<std::string> expectedPaths = pathsOf(expected);
+    EXPECT_EQ(expected.size(), expectedPaths.size());
+    
+    // 4*5个子目录、120个文件、4个a目录、2个空目录、3个链接，以及经由link_to_a1看到的a1子树（5+30）
+    EXPECT_EQ(20u + 120u + 4u + 2u + 3u + 35u, expected.size());
+    EXPECT_EQ(1u, expectedPaths.count((rootDir / "a0" / "link_to_a1" / "b2" / "file3.txt").string()));
+    EXPECT_EQ(1u, expectedPaths.count((rootDir / "empty" / "nested").string()));
+    // 循环链接本身被收集，但不会深入
+    EXPECT_EQ(1u, expectedPaths.count((rootDir / "a3" / "b0" / "loop").string()));
+    EXPECT_EQ(0u, expectedPaths.count((rootDir / "a3" / "b0" / "loop" / "b1").string()));
+    
+    for (size_t threads : {1u, 2u, 3u, 8u}) {
+        for (bool getdents : {true, false}) {
+            DirectoryWalker walker(threads);
+            walker.setUseGetdents(getdents);
+            std::vector<File> files = walker.walk(rootDir);
+            EXPECT_EQ(expectedPaths, pathsOf(files)) << threads << " threads, getdents=" << getdents;
+            EXPECT_EQ(expected.size(), files.size());
+        }
+    }
+}
+
+// 测试遍历得到的File与直接构造的File元数据一致
+TEST_F(DirectoryWalkerTest, EntriesCarryMetadata) {
+    DirectoryWalker walker(4);
+    for (const auto& file : walker.walk(rootDir)) {
+        File direct(file.getFilePath());
+        EXPECT_EQ(direct.getFileType(), file.getFileType()) << file.getFilePath();
+        EXPECT_EQ(direct.getFileSize(), file.getFileSize()) << file.getFilePath();
+    }
+}
+
+// 测试根目录不存在或不是目录
+TEST_F(DirectoryWalkerTest, InvalidRoot) {
+    DirectoryWalker walker(2);
+    EXPECT_TRUE(walker.walk(rootDir / "missing").empty());
+    EXPECT_TRUE(walker.walk(rootDir / "a0" / "b0" / "file0.txt").empty());
+}
+
+// 测试目录中的相对路径与File::getRelativePath一致（包括经由符号链接到达的条目）
+TEST_F(DirectoryWalkerTest, CatalogRelativePathsMatchFile) {
+    DirectoryWalker walker(3);
+    FileCatalog catalog = walker.walkCatalog(rootDir);
+    ASSERT_EQ(184u, catalog.size());
+    for (size_t i = 0; i < catalog.size(); ++i) {
+        FileEntry entry = catalog[i];
+        File file(entry.getFilePath());
+        EXPECT_EQ(file.getRelativePath(rootDir), entry.getRelativePath(rootDir)) << entry.getFilePath();
+        EXPECT_EQ(file.getFileType(), entry.getFileType());
+        EXPECT_EQ(file.getFileSize(), entry.getFileSize());
+        EXPECT_EQ(file.getPermissions(), entry.getPermissions());
+        EXPECT_EQ(file.getSymlinkTarget(), entry.getSymlinkTarget());
+        EXPECT_EQ(file.getLastModifiedTime(), entry.getLastModifiedTime());
+    }
+}
+
+// 测试scanDirectory的排序：符号链接 -> 普通文件 -> 目录，同类按路径排序，与getAllFiles一致
+TEST_F(DirectoryWalkerTest, ScanDirectoryOrder) {
+    FileCatalog catalog = FileSystem::scanDirectory(rootDir.string(), 2);
+    std::vector<File> files = FileSystem::getAllFiles(rootDir.string(), 2);
+    ASSERT_EQ(files.size(), catalog.size());
+    auto rank = [](fs::file_type type) {
+        return type == fs::file_type::symlink ? 0 : type == fs::file_type::regular ? 1 : 2;
+    };
+    for (size_t i = 0; i < catalog.size(); ++i) {
+        EXPECT_EQ(files[i].getFilePath(), catalog[i].getFilePath());
+        if (i > 0) {
+            int previous = rank(catalog[i - 1].getFileType());
+            int current = rank(catalog[i].getFileType());
+            EXPECT_LE(previous, current);
+            if (previous == current) {
+                EXPECT_LT(catalog[i - 1].getFilePath().string(), catalog[i].getFilePath().string());
+            }
+        }
+    }
+}
+
+// 测试目录的追加、重排和内存占用
+TEST_F(DirectoryWalkerTest, CatalogReorderAndMemory) {
+    FileCatalog catalog(rootDir);
+    FileCatalog other(rootDir);
+    catalog.add(File(rootDir / "a0"), "a0");
+    other.add(File(rootDir / "link_to_file"), "link_to_file", false);
+    other.add(File(rootDir / "a1" / "b1" / "file2.txt"), "a1/b1/file2.txt");
+    catalog.append(std::move(other));
+    EXPECT_TRUE(other.empty());
+    ASSERT_EQ(3u, catalog.size());
+    EXPECT_EQ("a1/b1/file2.txt", catalog[2].getStoredPath());
+    EXPECT_EQ(rootDir / "a2" / "b0" / "file0.txt", catalog[1].getSymlinkTarget());
+    
+    // 只保留后两个并交换顺序
+    catalog.reorder({2, 1});
+    ASSERT_EQ(2u, catalog.size());
+    EXPECT_EQ(rootDir / "a1" / "b1" / "file2.txt", catalog[0].getFilePath());
+    EXPECT_TRUE(catalog[0].isRegularFile());
+    EXPECT_EQ(3u, catalog[0].getFileSize());
+    EXPECT_TRUE(catalog[1].isSymbolicLink());
+    
+    File restored = catalog[0].toFile();
+    File direct(rootDir / "a1" / "b1" / "file2.txt");
+    EXPECT_EQ(direct.getFilePath(), restored.getFilePath());
+    EXPECT_EQ(direct.getOwnerId(), restored.getOwnerId());
+    EXPECT_EQ(direct.getHardLinkCount(), restored.getHardLinkCount());
+    EXPECT_EQ(direct.getLastAccessTime(), restored.getLastAccessTime());
+    
+    // 每个条目的开销远小于File对象本身
+    FileCatalog scanned = DirectoryWalker(2).walkCatalog(rootDir);
+    EXPECT_LT(scanned.memoryUsage(), scanned.size() * sizeof(File));
+}
+
+// 测试流式遍历得到与一次性遍历相同的条目，队列很小时遍历线程等待消费者
+TEST_F(DirectoryWalkerTest, StreamDeliversAllEntries) {
+    std::set<std::string> expected = pathsOf(DirectoryWalker(1).walk(rootDir));
+    for (size_t threads : {1u, 4u}) {
+        DirectoryWalker walker(threads);
+        std::set<std::string> streamed;
+        size_t count = 0;
+        EXPECT_TRUE(walker.stream(rootDir, [&](const FileEntry& entry) {
+            streamed.insert(entry.getFilePath().string());
+            EXPECT_EQ(entry.getRelativePath(rootDir), File(entry.getFilePath()).getRelativePath(rootDir));
+            ++count;
+            return true;
+        }, 1));
+        EXPECT_EQ(expected, streamed);
+        EXPECT_EQ(expected.size(), count);
+    }
+    
+    // 根目录不存在时不调用消费者
+    DirectoryWalker walker(2);
+    EXPECT_TRUE(walker.stream(rootDir / "missing", [](const FileEntry&) {
+        ADD_FAILURE();
+        return true;
+    }));
+}
+
+// 测试消费者中止或抛出异常时遍历线程退出
+TEST_F(DirectoryWalkerTest, StreamStopsEarly) {
+    DirectoryWalker walker(4);
+    size_t count = 0;
+    EXPECT_FALSE(walker.stream(rootDir, [&](const FileEntry&) {
+        return ++count < 10;
+    }, 1));
+    EXPECT_EQ(10u, count);
+    
+    EXPECT_THROW(walker.stream(rootDir, [](const FileEntry&) -> bool {
+        throw std::runtime_error("consumer failed");
+    }, 1), std::runtime_error);
+    
+    // 中止后可以再次遍历
+    count = 0;
+    EXPECT_TRUE(walker.stream(rootDir, [&](const FileEntry&) { ++count; return true; }));
+    EXPECT_EQ(184u, count);
+}
+
+// 测试子树剪枝：被剪掉的目录不出现在结果中，其下的目录也不会再交给剪枝条件（从未被打开）
+TEST_F(DirectoryWalkerTest, DescendFilterPrunesSubtree) {
+    fs::path pruned = rootDir / "a1";
+    for (bool getdents : {true, false}) {
+        for (size_t threads : {1u, 4u}) {
+            std::mutex mutex;
+            std::set<std::string> asked;
+            DirectoryWalker walker(threads);
+            walker.setUseGetdents(getdents);
+            walker.setDescendFilter([&](const fs::path& directory) {
+                std::lock_guard<std::mutex> lock(mutex);
+                asked.insert(directory.string());
+                return directory != pruned && directory != rootDir / "a0" / "link_to_a1";
+            });
+            std::set<std::string> paths = pathsOf(walker.walk(rootDir));
+            
+            // a1子树（1+5+30）和经由link_to_a1看到的子树（35）都被跳过，链接本身仍然收集
+            EXPECT_EQ(184u - 36u - 35u, paths.size());
+            EXPECT_EQ(0u, paths.count(pruned.string()));
+            EXPECT_EQ(0u, paths.count((pruned / "b0" / "file0.txt").string()));
+            EXPECT_EQ(1u, paths.count((rootDir / "a0" / "link_to_a1").string()));
+            EXPECT_EQ(1u, paths.count((rootDir / "a2" / "b0" / "file0.txt").string()));
+            EXPECT_EQ(1u, asked.count(pruned.string()));
+            EXPECT_EQ(0u, asked.count((pruned / "b0").string()));
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
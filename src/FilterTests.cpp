@@ -77,6 +77,27 @@ TEST_F(PathFilterTest, TestMatchExcludedDirectory) {
     EXPECT_FALSE(filter.match(excludedDirFile));
 }
 
+TEST_F(PathFilterTest, TestShouldDescend) {
+    // 没有排除路径时所有目录都进入
+    EXPECT_TRUE(filter.shouldDescend(excludedDir));
+
+    filter.addExcludedPath(excludedDir.string());
+    // 排除目录本身及其子目录不再进入，名称前缀相同的目录不受影响
+    EXPECT_FALSE(filter.shouldDescend(excludedDir));
+    EXPECT_FALSE(filter.shouldDescend(excludedDir / "nested" / "deeper"));
+    EXPECT_TRUE(filter.shouldDescend(includedDir));
+    EXPECT_TRUE(filter.shouldDescend(testDir / "excluded_other"));
+    EXPECT_TRUE(filter.shouldDescend(testDir));
+
+    // 不进入的目录中的条目也都不会通过match
+    EXPECT_FALSE(filter.match(File(excludedDir / "file1.txt")));
+
+    // 其他过滤器默认总是进入
+    NameFilter nameFilter;
+    nameFilter.addExcludePattern("excluded");
+    EXPECT_TRUE(nameFilter.shouldDescend(excludedDir));
+}
+
 // TypeFilter测试用例
 class TypeFilterTest : public ::testing::Test {
 protected:
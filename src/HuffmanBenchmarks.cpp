@@ -0,0 +1,112 @@
+// Huffman分块并行压缩的扩展性基准测试
+// 用法: HuffmanBenchmarks [数据大小MiB] [最大线程数]
+// 对1到N个线程分别压缩、解压同一份内存数据，输出吞吐量和相对单线程的加速比
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "utils/HuffmanCompressor.hpp"
+#include "utils/ByteHistogram.hpp"
+
+// 生成偏斜分布的测试数据，接近文本文件的压缩率
+static std::string makeTestData(size_t size) {
+    std::string data;
+    data.reserve(size);
+    uint32_t seed = 12345;
+    while (data.size() < size) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned value = (seed >> 16) & 0xFF;
+        data.push_back(value < 200 ? static_cast<char>('a' + value % 16) : static_cast<char>(value));
+    }
+    return data;
+}
+
+// 线程数序列：1, 2, 4, ... 直到maxThreads（maxThreads本身也会包含在内）
+static std::vector<size_t> threadSteps(size_t maxThreads) {
+    std::vector<size_t> steps;
+    for (size_t count = 1; count < maxThreads; count *= 2) {
+        steps.push_back(count);
+    }
+    steps.push_back(maxThreads);
+    return steps;
+}
+
+int main(int argc, char** argv) {
+    size_t sizeMiB = argc > 1 ? std::stoul(argv[1]) : 256;
+    size_t maxThreads = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+    maxThreads = std::max<size_t>(1, maxThreads);
+
+    std::string input = makeTestData(sizeMiB << 20);
+    double inputMB = static_cast<double>(input.size()) / (1024.0 * 1024.0);
+    std::cout << "Input: " << sizeMiB << " MiB, block size: "
+              << (HuffmanCompressor::DEFAULT_BLOCK_SIZE >> 10) << " KiB" << std::endl;
+    // 频率统计单独计时
+    {
+        uint64_t counts[256] = {};
+        auto start = std::chrono::steady_clock::now();
+        ByteHistogram::count(reinterpret_cast<const unsigned char*>(input.data()), input.size(), counts);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Histogram (" << ByteHistogram::implementationName() << "): "
+                  << std::fixed << std::setprecision(1) << inputMB / seconds << " MB/s" << std::endl;
+    }
+
+    std::cout << std::left << std::setw(10) << "threads"
+              << std::setw(16) << "compress MB/s" << std::setw(12) << "speedup"
+              << std::setw(18) << "decompress MB/s" << std::setw(12) << "speedup" << std::endl;
+
+    double baseCompress = 0.0;
+    double baseDecompress = 0.0;
+    std::string reference;
+    for (size_t threads : threadSteps(maxThreads)) {
+        HuffmanCompressor compressor;
+        compressor.setThreadCount(threads);
+
+        std::istringstream compressIn(input);
+        std::ostringstream compressOut;
+        auto start = std::chrono::steady_clock::now();
+        if (!compressor.compressStream(compressIn, compressOut)) {
+            std::cerr << "Compression failed with " << threads << " threads" << std::endl;
+            return 1;
+        }
+        double compressSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::string compressed = compressOut.str();
+
+        // 输出必须与线程数无关
+        if (reference.empty()) {
+            reference = compressed;
+        } else if (compressed != reference) {
+            std::cerr << "Output differs with " << threads << " threads" << std::endl;
+            return 1;
+        }
+
+        std::istringstream decompressIn(compressed);
+        std::ostringstream decompressOut;
+        start = std::chrono::steady_clock::now();
+        if (!compressor.decompressStream(decompressIn, decompressOut)) {
+            std::cerr << "Decompression failed with " << threads << " threads" << std::endl;
+            return 1;
+        }
+        double decompressSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (decompressOut.str() != input) {
+            std::cerr << "Round trip mismatch with " << threads << " threads" << std::endl;
+            return 1;
+        }
+
+        double compressRate = inputMB / compressSeconds;
+        double decompressRate = inputMB / decompressSeconds;
+        if (threads == 1) {
+            baseCompress = compressRate;
+            baseDecompress = decompressRate;
+        }
+        std::cout << std::left << std::fixed << std::setprecision(1)
+                  << std::setw(10) << threads
+                  << std::setw(16) << compressRate << std::setw(12) << compressRate / baseCompress
+                  << std::setw(18) << decompressRate << std::setw(12) << decompressRate / baseDecompress
+                  << std::endl;
+    }
+    return 0;
+}
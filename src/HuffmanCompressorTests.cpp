@@ -3,7 +3,14 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <thread>
+#include <sstream>
+#include <atomic>
+#include <stdexcept>
 #include "utils/HuffmanCompressor.hpp"
+#include "utils/ThreadPool.hpp"
+#include "utils/ByteHistogram.hpp"
+#include "utils/FileSystem.hpp"
 
 namespace fs = std::filesystem;
 
@@ -145,6 +152,435 @@ TEST_F(HuffmanCompressorTest, CompressBinaryFile) {
 //     EXPECT_EQ(originalContent, decompressedContent);
 // }
 
+// 辅助函数：读取整个文件
+static std::vector<char> readAll(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// 测试较大的混合内容：覆盖查表一次解出两个符号和分块输出
+TEST_F(HuffmanCompressorTest, LargeMixedContentRoundTrip) {
+    HuffmanCompressor compressor;
+    
+    fs::path largeFile = testDir / "large.txt";
+    std::vector<char> content;
+    content.reserve(3 * 1024 * 1024);
+    uint32_t seed = 12345;
+    while (content.size() < 3 * 1024 * 1024) {
+        seed = seed * 1103515245u + 12345u;
+        // 偏斜分布：大部分是常见字母，少量是任意字节
+        unsigned value = (seed >> 16) & 0xFF;
+        content.push_back(value < 200 ? static_cast<char>('a' + value % 8) : static_cast<char>(value));
+    }
+    std::ofstream(largeFile, std::ios::binary).write(content.data(), content.size());
+    
+    fs::path compressed = testDir / "large.txt.huff";
+    fs::path restored = testDir / "large_restored.txt";
+    EXPECT_TRUE(compressor.compressFile(largeFile.string(), compressed.string()));
+    EXPECT_TRUE(compressor.decompressFile(compressed.string(), restored.string()));
+    EXPECT_EQ(compressor.getLastStats().outputBytes, content.size());
+    EXPECT_EQ(readAll(restored), content);
+}
+
+// 测试码长超过查表位数的符号（斐波那契频率构造出很深的树）
+TEST_F(HuffmanCompressorTest, LongCodesRoundTrip) {
+    HuffmanCompressor compressor;
+    
+    fs::path skewedFile = testDir / "skewed.dat";
+    std::vector<char> content;
+    uint64_t a = 1, b = 1;
+    for (int symbol = 0; symbol < 24; ++symbol) {
+        content.insert(content.end(), a, static_cast<char>(symbol));
+        uint64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    // 打乱顺序，避免相同符号连续出现
+    uint32_t seed = 7;
+    for (size_t i = content.size() - 1; i > 0; --i) {
+        seed = seed * 1103515245u + 12345u;
+        std::swap(content[i], content[seed % (i + 1)]);
+    }
+    std::ofstream(skewedFile, std::ios::binary).write(content.data(), content.size());
+    
+    fs::path compressed = testDir / "skewed.dat.huff";
+    fs::path restored = testDir / "skewed_restored.dat";
+    EXPECT_TRUE(compressor.compressFile(skewedFile.string(), compressed.string()));
+    EXPECT_TRUE(compressor.decompressFile(compressed.string(), restored.string()));
+    EXPECT_EQ(readAll(restored), content);
+}
+
+// 测试压缩统计：输出字节数与压缩文件大小一致
+TEST_F(HuffmanCompressorTest, CompressStatsMatchOutput) {
+    HuffmanCompressor compressor;
+    
+    EXPECT_TRUE(compressor.compressFile(testFile.string(), compressedFile.string()));
+    const HuffmanStats& stats = compressor.getLastStats();
+    EXPECT_EQ(stats.inputBytes, fs::file_size(testFile));
+    EXPECT_EQ(stats.outputBytes, fs::file_size(compressedFile));
+}
+
+// 测试截断的压缩文件解压失败
+TEST_F(HuffmanCompressorTest, TruncatedFileFails) {
+    HuffmanCompressor compressor;
+    
+    EXPECT_TRUE(compressor.compressFile(testFile.string(), compressedFile.string()));
+    fs::resize_file(compressedFile, fs::file_size(compressedFile) - 8);
+    EXPECT_FALSE(compressor.decompressFile(compressedFile.string(), decompressedFile.string()));
+}
+
+// 测试多个数据块：可压缩块、随机数据（原样存储）和单一符号块混合
+TEST_F(HuffmanCompressorTest, MultiBlockRoundTrip) {
+    HuffmanCompressor compressor;
+    compressor.setBlockSize(4096);
+    
+    fs::path mixedFile = testDir / "mixed.dat";
+    std::vector<char> content;
+    uint32_t seed = 99;
+    for (int block = 0; block < 11; ++block) {
+        for (int i = 0; i < 4096; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            unsigned value = (seed >> 16) & 0xFF;
+            switch (block % 3) {
+                case 0: content.push_back(static_cast<char>('a' + value % 4)); break;
+                case 1: content.push_back(static_cast<char>(value)); break;
+                default: content.push_back('z'); break;
+            }
+        }
+    }
+    // 最后一个不满的块
+    content.insert(content.end(), 100, 'q');
+    std::ofstream(mixedFile, std::ios::binary).write(content.data(), content.size());
+    
+    fs::path compressed = testDir / "mixed.dat.huff";
+    fs::path restored = testDir / "mixed_restored.dat";
+    EXPECT_TRUE(compressor.compressFile(mixedFile.string(), compressed.string()));
+    EXPECT_LT(fs::file_size(compressed), content.size());
+    EXPECT_TRUE(compressor.decompressFile(compressed.string(), restored.string()));
+    EXPECT_EQ(readAll(restored), content);
+}
+
+// 测试第一次读取的边界：小于、恰好等于、略大于第一次读取的大小，以及跨越默认块大小
+TEST_F(HuffmanCompressorTest, FirstReadBoundaries) {
+    const size_t sizes[] = {10, HuffmanCompressor::FIRST_READ_SIZE, HuffmanCompressor::FIRST_READ_SIZE + 1,
+                            HuffmanCompressor::DEFAULT_BLOCK_SIZE + 5};
+    for (size_t size : sizes) {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            content[i] = static_cast<char>('a' + (i * 7 + i / 13) % 5);
+        }
+        HuffmanCompressor compressor;
+        std::istringstream in(content);
+        std::ostringstream compressed;
+        ASSERT_TRUE(compressor.compressStream(in, compressed)) << size;
+        EXPECT_EQ(size, compressor.getLastStats().inputBytes);
+        std::istringstream packed(compressed.str());
+        std::ostringstream restored;
+        ASSERT_TRUE(compressor.decompressStream(packed, restored)) << size;
+        EXPECT_EQ(content, restored.str());
+    }
+}
+
+// 测试多线程压缩：输出与单线程完全一致，且能用多线程解压
+TEST_F(HuffmanCompressorTest, ParallelOutputMatchesSingleThread) {
+    fs::path dataFile = testDir / "parallel.dat";
+    std::vector<char> content;
+    uint32_t seed = 2024;
+    while (content.size() < 40 * 4096 + 123) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned value = (seed >> 16) & 0xFF;
+        content.push_back(value < 220 ? static_cast<char>('A' + value % 10) : static_cast<char>(value));
+    }
+    std::ofstream(dataFile, std::ios::binary).write(content.data(), content.size());
+    
+    HuffmanCompressor single;
+    single.setBlockSize(4096);
+    single.setThreadCount(1);
+    fs::path singleFile = testDir / "single.huff";
+    EXPECT_TRUE(single.compressFile(dataFile.string(), singleFile.string()));
+    
+    HuffmanCompressor parallel;
+    parallel.setBlockSize(4096);
+    parallel.setThreadCount(4);
+    EXPECT_EQ(parallel.getThreadCount(), 4u);
+    fs::path parallelFile = testDir / "parallel.huff";
+    EXPECT_TRUE(parallel.compressFile(dataFile.string(), parallelFile.string()));
+    EXPECT_EQ(readAll(singleFile), readAll(parallelFile));
+    
+    fs::path restored = testDir / "parallel_restored.dat";
+    EXPECT_TRUE(parallel.decompressFile(parallelFile.string(), restored.string()));
+    EXPECT_EQ(readAll(restored), content);
+}
+
+// 测试共享线程池：并发的多个压缩器共用同一个池，输出不受影响；池中的任务里嵌套调用parallelFor不会死锁
+TEST_F(HuffmanCompressorTest, SharedThreadPool) {
+    std::string content;
+    for (int i = 0; content.size() < 20 * 4096; ++i) {
+        content += "block " + std::to_string(i % 97) + " ";
+    }
+    HuffmanCompressor reference;
+    reference.setBlockSize(4096);
+    reference.setThreadCount(1);
+    std::istringstream referenceIn(content);
+    std::ostringstream referenceOut;
+    ASSERT_TRUE(reference.compressStream(referenceIn, referenceOut));
+    
+    std::vector<std::string> outputs(4);
+    std::vector<std::thread> callers;
+    for (size_t t = 0; t < outputs.size(); ++t) {
+        callers.emplace_back([&content, &outputs, t] {
+            HuffmanCompressor compressor;
+            compressor.setBlockSize(4096);
+            compressor.setThreadCount(4);
+            std::istringstream in(content);
+            std::ostringstream out;
+            if (compressor.compressStream(in, out)) {
+                outputs[t] = out.str();
+            }
+        });
+    }
+    for (auto& caller : callers) {
+        caller.join();
+    }
+    for (const auto& output : outputs) {
+        EXPECT_EQ(referenceOut.str(), output);
+    }
+    
+    std::atomic<size_t> total(0);
+    ThreadPool::shared().parallelFor(8, [&total](size_t) {
+        ThreadPool::shared().parallelFor(8, [&total](size_t) { ++total; });
+    });
+    EXPECT_EQ(64u, total.load());
+    EXPECT_THROW(ThreadPool::shared().parallelFor(4, [](size_t i) {
+        if (i == 2) {
+            throw std::runtime_error("task failed");
+        }
+    }), std::runtime_error);
+}
+
+// 测试仍能解压旧版（v1）格式的文件
+TEST_F(HuffmanCompressorTest, DecompressLegacyFormat) {
+    HuffmanCompressor compressor;
+    
+    // "aab"：a频率2，b频率1；v1格式为 填充位数、字符种类数、(字符, 频率)表、原始大小、数据
+    fs::path legacyFile = testDir / "legacy.huff";
+    std::ofstream legacy(legacyFile, std::ios::binary);
+    auto writeInt = [&legacy](unsigned int value) {
+        legacy.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    legacy.put(5);
+    writeInt(2);
+    legacy.put('a');
+    writeInt(2);
+    legacy.put('b');
+    writeInt(1);
+    writeInt(3);
+    // 树的左子树为b(0)，右子树为a(1)：a a b -> 110，填充5位
+    legacy.put(static_cast<char>(0xC0));
+    legacy.close();
+    
+    fs::path restored = testDir / "legacy_restored.txt";
+    EXPECT_TRUE(compressor.decompressFile(legacyFile.string(), restored.string()));
+    std::vector<char> expected = {'a', 'a', 'b'};
+    EXPECT_EQ(readAll(restored), expected);
+}
+
+// 测试数组形式的Huffman树：频率相同时的排序规则与码长
+TEST(HuffmanTreeTest, DeterministicCodeLengths) {
+    uint64_t frequencies[256] = {};
+    frequencies['a'] = 5;
+    frequencies['b'] = 2;
+    frequencies['c'] = 1;
+    frequencies['d'] = 1;
+    HuffmanTree tree;
+    tree.build(frequencies);
+    EXPECT_EQ(tree.leafCount, 4);
+    EXPECT_EQ(tree.root, 6);
+    EXPECT_EQ(tree.nodes[tree.root].freq, 9u);
+    
+    // c、d先合并（叶节点按符号值排序，c在左），再与b合并，最后与a合并
+    EXPECT_EQ(tree.nodes[tree.nodes[4].child[0]].symbol, 'c');
+    EXPECT_EQ(tree.nodes[tree.nodes[4].child[1]].symbol, 'd');
+    uint8_t lengths[256];
+    tree.codeLengths(lengths);
+    EXPECT_EQ(lengths['a'], 1);
+    EXPECT_EQ(lengths['b'], 2);
+    EXPECT_EQ(lengths['c'], 3);
+    EXPECT_EQ(lengths['d'], 3);
+    EXPECT_EQ(lengths['e'], 0);
+    
+    uint64_t empty[256] = {};
+    tree.build(empty);
+    EXPECT_TRUE(tree.empty());
+}
+
+// 测试码长限制：结果不超过上限、仍是完整前缀码，频率高的符号码长不长于频率低的
+TEST(HuffmanTreeTest, LimitCodeLengths) {
+    uint64_t frequencies[256] = {};
+    uint64_t a = 1, b = 1;
+    for (int symbol = 0; symbol < 30; ++symbol) {
+        frequencies[symbol] = a;
+        uint64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    HuffmanTree tree;
+    tree.build(frequencies);
+    uint8_t lengths[256];
+    tree.codeLengths(lengths);
+    EXPECT_GT(lengths[0], 15);
+    
+    limitCodeLengths(lengths, frequencies, 15);
+    uint64_t codes[256];
+    EXPECT_TRUE(assignCanonicalCodes(lengths, codes));
+    for (int symbol = 0; symbol < 30; ++symbol) {
+        EXPECT_GE(lengths[symbol], 1);
+        EXPECT_LE(lengths[symbol], 15);
+        if (symbol > 0) {
+            EXPECT_LE(lengths[symbol], lengths[symbol - 1]);
+        }
+    }
+}
+
+// 测试多个压缩器实例在不同线程上同时工作
+TEST_F(HuffmanCompressorTest, ConcurrentInstances) {
+    std::vector<std::vector<char>> contents(4);
+    for (size_t t = 0; t < contents.size(); ++t) {
+        uint32_t seed = static_cast<uint32_t>(t + 1);
+        for (int i = 0; i < 50000; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            contents[t].push_back(static_cast<char>('a' + ((seed >> 16) % (3 + 5 * t))));
+        }
+        std::ofstream(testDir / ("concurrent" + std::to_string(t) + ".dat"), std::ios::binary)
+            .write(contents[t].data(), contents[t].size());
+    }
+    
+    std::vector<std::thread> threads;
+    std::vector<char> results(contents.size(), 0);
+    for (size_t t = 0; t < contents.size(); ++t) {
+        threads.emplace_back([this, t, &results] {
+            HuffmanCompressor compressor;
+            compressor.setThreadCount(1);
+            compressor.setBlockSize(8192);
+            std::string base = (testDir / ("concurrent" + std::to_string(t))).string();
+            results[t] = compressor.compressFile(base + ".dat", base + ".huff") &&
+                         compressor.decompressFile(base + ".huff", base + ".out");
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (size_t t = 0; t < contents.size(); ++t) {
+        EXPECT_TRUE(results[t]);
+        EXPECT_EQ(readAll(testDir / ("concurrent" + std::to_string(t) + ".out")), contents[t]);
+    }
+}
+
+// 测试字节频率统计：运行时选用的实现与标量实现结果一致，覆盖未对齐的起点、尾部和整段相同字节
+TEST(ByteHistogramTest, MatchesScalarCount) {
+    std::vector<unsigned char> data(100000);
+    uint32_t seed = 31;
+    for (size_t i = 0; i < data.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = static_cast<unsigned char>(seed >> 16);
+    }
+    std::fill(data.begin() + 5000, data.begin() + 9000, 0);
+    std::fill(data.begin() + 9000, data.begin() + 9100, 0xFF);
+    
+    for (size_t offset : {0, 1, 7}) {
+        for (size_t size : {0, 1, 31, 33, 4099, 99000}) {
+            uint64_t expected[256] = {};
+            for (size_t i = 0; i < size; ++i) {
+                expected[data[offset + i]]++;
+            }
+            uint64_t scalar[256] = {};
+            uint64_t counted[256] = {};
+            ByteHistogram::countScalar(data.data() + offset, size, scalar);
+            ByteHistogram::count(data.data() + offset, size, counted);
+            for (int symbol = 0; symbol < 256; ++symbol) {
+                EXPECT_EQ(scalar[symbol], expected[symbol]);
+                EXPECT_EQ(counted[symbol], expected[symbol]);
+            }
+        }
+    }
+}
+
+// 测试未知的块类型（例如1）按损坏处理
+TEST_F(HuffmanCompressorTest, RejectUnknownBlockType) {
+    HuffmanCompressor compressor;
+    
+    const unsigned char data[] = {
+        'B', 'H', 'U', 'F', 2,
+        16, 0, 0, 0, 1, 14, 0, 0, 0,
+        2, 0, 'a', 15, 0, 0, 0, 'b', 1, 0, 0, 0, 0x00, 0x01,
+        0, 0, 0, 0, 16, 0, 0, 0, 0, 0, 0, 0,
+    };
+    fs::path blockFile = testDir / "unknown_block.huff";
+    std::ofstream(blockFile, std::ios::binary).write(reinterpret_cast<const char*>(data), sizeof(data));
+    
+    EXPECT_FALSE(compressor.decompressFile(blockFile.string(), (testDir / "unknown_block.txt").string()));
+}
+
+// 测试小文件的压缩输出：码长表取代频率表后头部开销小于原始数据
+TEST_F(HuffmanCompressorTest, SmallFileUsesCompactHeader) {
+    HuffmanCompressor compressor;
+    
+    fs::path smallFile = testDir / "small.txt";
+    std::string content;
+    for (int i = 0; i < 40; ++i) {
+        content += "abcabdaab";
+    }
+    std::ofstream(smallFile, std::ios::binary) << content;
+    
+    fs::path compressed = testDir / "small.txt.huff";
+    EXPECT_TRUE(compressor.compressFile(smallFile.string(), compressed.string()));
+    // 文件头5 + 块头9 + 稀疏码长表(1 + 4 + 2) + 码流 + 结束块12
+    EXPECT_LT(fs::file_size(compressed), 5 + 9 + 7 + content.size() / 2 + 12);
+    
+    fs::path restored = testDir / "small_restored.txt";
+    EXPECT_TRUE(compressor.decompressFile(compressed.string(), restored.string()));
+    EXPECT_EQ(readAll(restored), std::vector<char>(content.begin(), content.end()));
+}
+
+// 测试熵预估：随机数据在编码前就被判定为不可压缩，直接复制并计入统计
+TEST_F(HuffmanCompressorTest, SkipIncompressibleBeforeEncoding) {
+    fs::path randomFile = testDir / "random.bin";
+    std::vector<char> content(300000);
+    uint32_t seed = 77;
+    for (auto& byte : content) {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<char>(seed >> 24);
+    }
+    std::ofstream(randomFile, std::ios::binary).write(content.data(), content.size());
+    
+    HuffmanCompressor compressor;
+    EXPECT_FALSE(compressor.isWorthCompressing(randomFile.string()));
+    EXPECT_TRUE(compressor.isWorthCompressing((testDir / "large_missing.txt").string()));
+    
+    // 可压缩的文本
+    fs::path textFile = testDir / "text.txt";
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        text += "backup helper compresses text files well. ";
+    }
+    std::ofstream(textFile, std::ios::binary) << text;
+    EXPECT_TRUE(compressor.isWorthCompressing(textFile.string()));
+    
+    fs::path destination = testDir / "out" / "random.bin.huff";
+    fs::create_directories(destination.parent_path());
+    CompressResult result = CompressResult::Failed;
+    EXPECT_TRUE(FileSystem::copyAndCompressFile(randomFile.string(), destination.string(), CodecId::Huffman, &result));
+    EXPECT_EQ(CompressResult::Skipped, result);
+    EXPECT_FALSE(fs::exists(destination));
+    EXPECT_EQ(readAll(testDir / "out" / "random.bin"), content);
+    
+    CompressionStats stats;
+    stats.record(result, content.size());
+    EXPECT_EQ(stats.skippedFiles, 1u);
+    EXPECT_EQ(stats.skippedBytes, content.size());
+    EXPECT_EQ(stats.compressedFiles, 0u);
+}
+
 // 测试不存在的文件压缩
 TEST_F(HuffmanCompressorTest, CompressNonExistentFile) {
     HuffmanCompressor compressor;
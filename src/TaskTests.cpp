@@ -8,6 +8,7 @@
 #include "core/tasks/BackupTask.hpp"
 #include "core/tasks/RestoreTask.hpp"
 #include "utils/ILogger.hpp"
+#include "utils/Encryption.hpp"
 
 namespace fs = std::filesystem;
 
@@ -75,6 +76,8 @@ protected:
     }
     
     void TearDown() override {
+        // 恢复进程级的线程数设置，断言提前返回时也不影响后续用例
+        Encryption::setThreadCount(0);
         // 清理测试目录
         fs::remove_all(testDir);
     }
@@ -146,6 +149,9 @@ TEST_F(TaskTest, BackupTaskWithPackage) {
     // 验证包文件已生成 - 非加密备份生成普通.pkg文件
     EXPECT_TRUE(fs::exists(packageFile));
     EXPECT_GT(fs::file_size(packageFile), 0);
+    
+    // 源文件直接写入包，备份目录中只有包文件
+    EXPECT_EQ(1, std::distance(fs::recursive_directory_iterator(backupDir), fs::recursive_directory_iterator()));
 }
 
 // 测试带加密的备份任务
@@ -167,6 +173,10 @@ TEST_F(TaskTest, BackupTaskWithEncryption) {
     fs::path encryptedPackageFile = backupDir / "backup.pkg.enc";
     EXPECT_TRUE(fs::exists(encryptedPackageFile));
     EXPECT_GT(fs::file_size(encryptedPackageFile), 0);
+    
+    // 包经过加密流直接写出，不留下未加密的包
+    EXPECT_FALSE(fs::exists(packageFile));
+    EXPECT_EQ(1, std::distance(fs::recursive_directory_iterator(backupDir), fs::recursive_directory_iterator()));
 }
 
 // 测试基本还原任务
@@ -189,6 +199,46 @@ TEST_F(TaskTest, RestoreTaskBasic) {
     EXPECT_TRUE(compareDirectories(sourceDir, restoreDir));
 }
 
+// 测试不打包的压缩备份：原本就叫notes.lz的文件按原样存储，还原时不解压也不改名
+TEST_F(TaskTest, RestoreTaskKeepsRawFileWithCompressedExtension) {
+    std::ofstream(sourceDir / "notes.lz") << "plain notes";
+    
+    std::vector<std::shared_ptr<Filter>> filters;
+    BackupTask backupTask(sourceDir.string(), backupDir.string(), mockLogger.get(), filters, true, false);
+    EXPECT_TRUE(backupTask.execute());
+    
+    RestoreTask restoreTask(backupDir.string(), restoreDir.string(), mockLogger.get(), filters, true, false);
+    EXPECT_TRUE(restoreTask.execute());
+    
+    std::ifstream restored(restoreDir / "notes.lz");
+    EXPECT_EQ("plain notes", std::string((std::istreambuf_iterator<char>(restored)), std::istreambuf_iterator<char>()));
+    EXPECT_FALSE(fs::exists(restoreDir / "notes"));
+    EXPECT_TRUE(compareDirectories(sourceDir, restoreDir));
+}
+
+// 测试跳过压缩的统计按任务累计：每个任务只报告自己跳过的文件
+TEST_F(TaskTest, BackupTaskReportsOwnSkippedCompression) {
+    std::string random(300000, '\0');
+    uint32_t seed = 11;
+    for (auto& byte : random) {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<char>(seed >> 24);
+    }
+    fs::path randomDir = testDir / "random_source";
+    fs::create_directories(randomDir);
+    std::ofstream(randomDir / "random.bin", std::ios::binary) << random;
+    
+    EXPECT_CALL(*mockLogger, info(::testing::HasSubstr("Skipped compression for 1 incompressible files (" +
+                                                       std::to_string(random.size()) + " bytes)")))
+        .Times(2);
+    
+    std::vector<std::shared_ptr<Filter>> filters;
+    BackupTask copyTask(randomDir.string(), (backupDir / "first").string(), mockLogger.get(), filters, true, false);
+    EXPECT_TRUE(copyTask.execute());
+    BackupTask packageTask(randomDir.string(), (backupDir / "second").string(), mockLogger.get(), filters, true, true);
+    EXPECT_TRUE(packageTask.execute());
+}
+
 // 测试带打包的还原任务
 TEST_F(TaskTest, RestoreTaskWithPackage) {
     // 首先执行带打包的备份任务，生成备份包
@@ -211,6 +261,61 @@ TEST_F(TaskTest, RestoreTaskWithPackage) {
     EXPECT_TRUE(compareDirectories(sourceDir, restoreDir));
 }
 
+// 测试从包中部分还原：过滤器作用于包中的条目，只还原匹配的文件
+TEST_F(TaskTest, RestoreTaskPartialFromPackage) {
+    std::vector<std::shared_ptr<Filter>> noFilters;
+    BackupTask backupTask(sourceDir.string(), backupDir.string(), mockLogger.get(), 
+                         noFilters, true, true, "backup.pkg", testPassword);
+    EXPECT_TRUE(backupTask.execute());
+    
+    auto nameFilter = std::make_shared<NameFilter>();
+    nameFilter->addIncludePattern("^file3\\.txt$");
+    std::vector<std::shared_ptr<Filter>> filters = {nameFilter};
+    RestoreTask restoreTask(backupDir.string(), restoreDir.string(), mockLogger.get(), 
+                          filters, true, true, "backup.pkg", testPassword);
+    EXPECT_TRUE(restoreTask.execute());
+    EXPECT_EQ(restoreTask.getStatus(), TaskStatus::COMPLETED);
+    
+    std::ifstream restored(restoreDir / "subdir1" / "file3.txt");
+    EXPECT_EQ("Content of file 3 in subdir1",
+              std::string((std::istreambuf_iterator<char>(restored)), std::istreambuf_iterator<char>()));
+    EXPECT_FALSE(fs::exists(restoreDir / "file1.txt"));
+    EXPECT_FALSE(fs::exists(restoreDir / "subdir2" / "file4.txt"));
+}
+
+// 测试从未加密的压缩包部分还原：条目直接从包中解压到还原目录，不经过临时解包目录
+TEST_F(TaskTest, RestoreTaskPartialFromCompressedPackage) {
+    std::string log;
+    for (int i = 0; i < 4096; ++i) {
+        log += "2024-01-01 12:00:00 INFO request " + std::to_string(i % 16) + " handled\n";
+    }
+    std::ofstream(sourceDir / "subdir1" / "app.log", std::ios::binary) << log;
+    auto modified = fs::file_time_type::clock::now() - std::chrono::hours(48);
+    fs::last_write_time(sourceDir / "subdir1" / "app.log", modified);
+    
+    std::vector<std::shared_ptr<Filter>> noFilters;
+    BackupTask backupTask(sourceDir.string(), backupDir.string(), mockLogger.get(), 
+                         noFilters, true, true, "backup.pkg", "");
+    EXPECT_TRUE(backupTask.execute());
+    
+    auto nameFilter = std::make_shared<NameFilter>();
+    nameFilter->addIncludePattern("^app\\.log$");
+    std::vector<std::shared_ptr<Filter>> filters = {nameFilter};
+    RestoreTask restoreTask(backupDir.string(), restoreDir.string(), mockLogger.get(), 
+                          filters, true, true, "backup.pkg", "");
+    EXPECT_TRUE(restoreTask.execute());
+    EXPECT_EQ(restoreTask.getStatus(), TaskStatus::COMPLETED);
+    
+    std::ifstream restored(restoreDir / "subdir1" / "app.log", std::ios::binary);
+    EXPECT_EQ(log, std::string((std::istreambuf_iterator<char>(restored)), std::istreambuf_iterator<char>()));
+    // 包中的时间戳精确到秒
+    EXPECT_EQ(std::chrono::floor<std::chrono::seconds>(modified),
+              std::chrono::floor<std::chrono::seconds>(fs::last_write_time(restoreDir / "subdir1" / "app.log")));
+    EXPECT_EQ(1, std::distance(fs::directory_iterator(restoreDir / "subdir1"), fs::directory_iterator()));
+    EXPECT_FALSE(fs::exists(restoreDir / "file1.txt"));
+    EXPECT_FALSE(fs::exists(backupDir / "temp_unpack"));
+}
+
 // 测试带加密的还原任务
 TEST_F(TaskTest, RestoreTaskWithEncryption) {
     // 首先执行带加密的备份任务，生成加密备份包
@@ -219,6 +324,9 @@ TEST_F(TaskTest, RestoreTaskWithEncryption) {
                          filters, true, true, "backup.pkg", testPassword);
     EXPECT_TRUE(backupTask.execute());
     
+    // 加密包是分段格式，还原时按需解密，不生成临时解密文件
+    EXPECT_TRUE(Encryption::isSegmentedFile((backupDir / "backup.pkg.enc").string()));
+    
     // 创建带加密的还原任务
     RestoreTask restoreTask(backupDir.string(), restoreDir.string(), mockLogger.get(), 
                           filters, true, true, "backup.pkg", testPassword);
@@ -228,11 +336,70 @@ TEST_F(TaskTest, RestoreTaskWithEncryption) {
     
     // 验证还原任务状态
     EXPECT_EQ(restoreTask.getStatus(), TaskStatus::COMPLETED);
+    EXPECT_FALSE(fs::exists(backupDir / "backup.pkg.enc.tmp"));
     
     // 验证还原目录中包含源目录的内容
     EXPECT_TRUE(compareDirectories(sourceDir, restoreDir));
 }
 
+// 测试多线程加密的大包：包大于一轮槽位环，写包和还原时都并行加解密
+TEST_F(TaskTest, RestoreTaskWithLargeEncryptedPackage) {
+    Encryption::setThreadCount(4);
+    // 不可压缩的数据，包的大小超过4个线程时一轮槽位环的容量（8个槽位 * 4段 * 64 KiB）
+    uint32_t seed = 7;
+    for (int f = 0; f < 3; ++f) {
+        std::string data(1 << 20, '\0');
+        for (auto& byte : data) {
+            seed = seed * 1103515245u + 12345u;
+            byte = static_cast<char>(seed >> 24);
+        }
+        std::ofstream(sourceDir / "subdir1" / ("random" + std::to_string(f) + ".bin"), std::ios::binary) << data;
+    }
+    
+    std::vector<std::shared_ptr<Filter>> filters;
+    BackupTask backupTask(sourceDir.string(), backupDir.string(), mockLogger.get(), 
+                         filters, false, true, "backup.pkg", testPassword);
+    EXPECT_TRUE(backupTask.execute());
+    fs::path encryptedPackage = backupDir / "backup.pkg.enc";
+    ASSERT_TRUE(Encryption::isSegmentedFile(encryptedPackage.string()));
+    EXPECT_GT(fs::file_size(encryptedPackage), 8 * Encryption::SEGMENTS_PER_SLOT * (Encryption::SEGMENT_SIZE + Encryption::TAG_SIZE));
+    
+    RestoreTask restoreTask(backupDir.string(), restoreDir.string(), mockLogger.get(), 
+                          filters, false, true, "backup.pkg", testPassword);
+    EXPECT_TRUE(restoreTask.execute());
+    EXPECT_EQ(restoreTask.getStatus(), TaskStatus::COMPLETED);
+    EXPECT_TRUE(compareDirectories(sourceDir, restoreDir));
+}
+
+// 测试不打包时的加密备份：压缩和加密在一次读取中完成，不留下未加密的中间文件
+TEST_F(TaskTest, RestoreTaskWithEncryptionNoPackage) {
+    // 可压缩的较大文件，跨越多个加密分段
+    {
+        std::ofstream log(sourceDir / "subdir1" / "app.log");
+        for (int i = 0; i < 20000; ++i) {
+            log << "2024-01-01 12:00:00 INFO request " << i << " handled in " << (i % 97) << " ms\n";
+        }
+    }
+    
+    std::vector<std::shared_ptr<Filter>> filters;
+    BackupTask backupTask(sourceDir.string(), backupDir.string(), mockLogger.get(), 
+                         filters, true, false, "backup.pkg", testPassword);
+    EXPECT_TRUE(backupTask.execute());
+    
+    EXPECT_TRUE(fs::exists(backupDir / "subdir1" / ("app.log" + std::string(Codec::extensionOf(CodecId::Huffman)) + ".enc")));
+    for (const auto& entry : fs::recursive_directory_iterator(backupDir)) {
+        if (entry.is_regular_file()) {
+            EXPECT_EQ(".enc", entry.path().extension().string()) << entry.path();
+        }
+    }
+    
+    RestoreTask restoreTask(backupDir.string(), restoreDir.string(), mockLogger.get(), 
+                          filters, true, false, "backup.pkg", testPassword);
+    EXPECT_TRUE(restoreTask.execute());
+    EXPECT_EQ(restoreTask.getStatus(), TaskStatus::COMPLETED);
+    EXPECT_TRUE(compareDirectories(sourceDir, restoreDir));
+}
+
 // 测试中断标志
 TEST_F(TaskTest, BackupTaskInterrupt) {
     // 创建空过滤器列表
@@ -329,6 +496,49 @@ TEST_F(TaskTest, BackupTaskWithFilters) {
     EXPECT_FALSE(fs::exists(backupDir / "subdir2"));
 }
 
+// 测试边扫描边备份时，只读目录在其中的文件写入后才设置权限
+TEST_F(TaskTest, BackupTaskReadOnlyDirectory) {
+#ifndef _WIN32
+    fs::path readOnlyDir = sourceDir / "readonly";
+    fs::create_directories(readOnlyDir / "nested");
+    std::ofstream(readOnlyDir / "inner.txt") << "inside a read-only directory";
+    std::ofstream(readOnlyDir / "nested" / "deep.txt") << "deeper";
+    fs::permissions(readOnlyDir / "nested", fs::perms::owner_read | fs::perms::owner_exec);
+    fs::permissions(readOnlyDir, fs::perms::owner_read | fs::perms::owner_exec);
+    
+    std::vector<std::shared_ptr<Filter>> filters;
+    BackupTask backupTask(sourceDir.string(), backupDir.string(), mockLogger.get(), filters, false, false);
+    bool succeeded = backupTask.execute();
+    
+    fs::permissions(readOnlyDir, fs::perms::owner_all);
+    fs::permissions(readOnlyDir / "nested", fs::perms::owner_all);
+    auto backupPerms = fs::status(backupDir / "readonly").permissions();
+    if (fs::exists(backupDir / "readonly")) {
+        fs::permissions(backupDir / "readonly", fs::perms::owner_all);
+        fs::permissions(backupDir / "readonly" / "nested", fs::perms::owner_all);
+    }
+    
+    EXPECT_TRUE(succeeded);
+    EXPECT_EQ(TaskStatus::COMPLETED, backupTask.getStatus());
+    EXPECT_TRUE(fs::exists(backupDir / "readonly" / "inner.txt"));
+    EXPECT_TRUE(fs::exists(backupDir / "readonly" / "nested" / "deep.txt"));
+    EXPECT_EQ(fs::perms::none, backupPerms & fs::perms::owner_write);
+#endif
+}
+
+// 测试过滤掉所有文件时不留下空包
+TEST_F(TaskTest, BackupTaskPackageNothingMatched) {
+    std::vector<std::shared_ptr<Filter>> filters;
+    auto nameFilter = std::make_shared<NameFilter>();
+    nameFilter->addIncludePattern("^no-such-file$");
+    filters.push_back(nameFilter);
+    
+    BackupTask backupTask(sourceDir.string(), backupDir.string(), mockLogger.get(), filters, true, true);
+    EXPECT_TRUE(backupTask.execute());
+    EXPECT_EQ(TaskStatus::COMPLETED, backupTask.getStatus());
+    EXPECT_FALSE(fs::exists(packageFile));
+}
+
 // 测试任务状态初始值
 TEST_F(TaskTest, TaskStatusInitialValue) {
     // 创建空过滤器列表
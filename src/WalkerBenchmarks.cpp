@@ -0,0 +1,106 @@
+// 多线程目录遍历的扩展性基准测试
+// 用法: WalkerBenchmarks [目录] [最大线程数]
+// 不指定目录（或目录为空字符串）时在临时目录下生成一棵测试树（约10万个条目）
+// 先用单线程的recursive_directory_iterator作为基准，再对1到N个线程分别遍历，
+// 输出每秒条目数和相对基准的加速比，并检查条目数一致
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+#include "utils/DirectoryWalker.hpp"
+#include "core/models/File.hpp"
+
+namespace fs = std::filesystem;
+
+// 生成测试树：3层目录，每个叶子目录若干小文件
+static void makeTestTree(const fs::path& root) {
+    for (int a = 0; a < 16; ++a) {
+        for (int b = 0; b < 32; ++b) {
+            fs::path dir = root / ("d" + std::to_string(a)) / ("d" + std::to_string(b));
+            fs::create_directories(dir);
+            for (int f = 0; f < 190; ++f) {
+                std::ofstream(dir / ("f" + std::to_string(f))) << f;
+            }
+        }
+    }
+}
+
+// 线程数序列：1, 2, 4, ... 直到maxThreads（maxThreads本身也会包含在内）
+static std::vector<size_t> threadSteps(size_t maxThreads) {
+    std::vector<size_t> steps;
+    for (size_t count = 1; count < maxThreads; count *= 2) {
+        steps.push_back(count);
+    }
+    steps.push_back(maxThreads);
+    return steps;
+}
+
+int main(int argc, char** argv) {
+    fs::path root;
+    bool generated = false;
+    if (argc > 1 && argv[1][0] != '\0') {
+        root = argv[1];
+    } else {
+        root = fs::temp_directory_path() / "walker_benchmark_tree";
+        fs::remove_all(root);
+        std::cout << "Generating test tree in " << root << std::endl;
+        makeTestTree(root);
+        generated = true;
+    }
+    size_t maxThreads = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+    maxThreads = std::max<size_t>(1, maxThreads);
+
+    // 基准：原来的单线程遍历方式
+    size_t baseCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<File> files;
+        std::error_code ec;
+        for (const auto& entry : fs::recursive_directory_iterator(
+                 root, fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, ec)) {
+            files.emplace_back(entry.path());
+        }
+        baseCount = files.size();
+    }
+    double baseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double baseRate = static_cast<double>(baseCount) / baseSeconds;
+    std::cout << "Entries: " << baseCount << ", recursive_directory_iterator: "
+              << std::fixed << std::setprecision(0) << baseRate << " entries/s" << std::endl;
+
+    std::cout << std::left << std::setw(10) << "threads"
+              << std::setw(18) << "getdents64 e/s" << std::setw(12) << "speedup"
+              << std::setw(18) << "iterator e/s" << std::setw(12) << "speedup" << std::endl;
+
+    int status = 0;
+    for (size_t threads : threadSteps(maxThreads)) {
+        double rates[2] = {};
+        for (int mode = 0; mode < 2; ++mode) {
+            DirectoryWalker walker(threads);
+            walker.setUseGetdents(mode == 0);
+            start = std::chrono::steady_clock::now();
+            size_t count = walker.walk(root).size();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (count != baseCount) {
+                std::cerr << "Entry count differs with " << threads << " threads: " << count << std::endl;
+                status = 1;
+            }
+            rates[mode] = static_cast<double>(count) / seconds;
+        }
+        std::cout << std::left << std::fixed
+                  << std::setw(10) << threads << std::setprecision(0)
+                  << std::setw(18) << rates[0] << std::setprecision(2) << std::setw(12) << rates[0] / baseRate
+                  << std::setprecision(0)
+                  << std::setw(18) << rates[1] << std::setprecision(2) << std::setw(12) << rates[1] / baseRate
+                  << std::endl;
+    }
+
+    if (generated) {
+        fs::remove_all(root);
+    }
+    return status;
+}
@@ -10,8 +10,9 @@ bool BackupEngine::backup(const std::string& sourceDir,
                           bool packageEnabled,
                           const std::string& packageFileName,
                           const std::string& password,
-                          std::atomic<bool>* interrupted) {
-    BackupTask task(sourceDir, backupPath, logger, filters, compressEnabled, packageEnabled, packageFileName, password, interrupted);
+                          std::atomic<bool>* interrupted,
+                          CodecId codec) {
+    BackupTask task(sourceDir, backupPath, logger, filters, compressEnabled, packageEnabled, packageFileName, password, interrupted, codec);
     return task.execute();
 }
 
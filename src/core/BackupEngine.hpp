@@ -3,6 +3,7 @@
 #include <vector>
 #include "Types.hpp"
 #include "Filter.hpp"
+#include "../utils/Codec.hpp"
 
 class ILogger;
 
@@ -12,7 +13,8 @@ public:
                       const std::vector<std::shared_ptr<Filter>>& filters = {}, bool compressEnabled = true, 
                       bool packageEnabled = false, const std::string& packageFileName = "backup.pkg",
                       const std::string& password = "",
-                      std::atomic<bool>* interrupted = nullptr);
+                      std::atomic<bool>* interrupted = nullptr,
+                      CodecId codec = CodecId::Huffman);
     static bool restore(const std::string& backupPath, const std::string& restorePath, ILogger* logger, 
                        const std::vector<std::shared_ptr<Filter>>& filters = {}, bool compressEnabled = true,
                        bool packageEnabled = false, const std::string& packageFileName = "backup.pkg",
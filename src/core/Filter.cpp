@@ -106,6 +106,25 @@ bool PathFilter::match(const File& file) const {
     return true; // 不排除此文件或目录
 }
 
+bool PathFilter::shouldDescend(const fs::path& directory) const {
+    // 与match对目录的判断相同：目录是排除路径本身或位于其下时，其中的条目都会被match排除
+    std::string checkPath = directory.string();
+    for (char& c : checkPath) {
+        if (c == '/' || c == '\\') {
+            c = fs::path::preferred_separator;
+        }
+    }
+    if (checkPath.empty() || checkPath.back() != fs::path::preferred_separator) {
+        checkPath += fs::path::preferred_separator;
+    }
+    for (const auto& excludedPath : excludedPaths) {
+        if (checkPath.compare(0, excludedPath.size(), excludedPath) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 std::string PathFilter::getFilterDescription() const 
 {
     std::string desc = "Path Filter: Excluded Paths (" +
@@ -15,6 +15,13 @@ public:
     virtual ~Filter() = default;
     virtual bool match(const File& file) const = 0;
 
+    // 遍历时是否需要进入directory：返回false表示该目录及其下所有条目都不会通过match，
+    // 遍历器可以整棵子树跳过，不打开也不stat其中任何条目。默认总是进入
+    virtual bool shouldDescend(const fs::path& directory) const {
+        (void)directory;
+        return true;
+    }
+
     virtual std::string getFilterDescription() const = 0;
 };
 
@@ -36,6 +43,8 @@ public:
         this->excludedPaths.clear();
     }
     bool match(const File& file) const override;
+    // 排除目录本身及其子目录都不再进入
+    bool shouldDescend(const fs::path& directory) const override;
 
     std::string getFilterDescription() const override;
 };
@@ -186,7 +186,9 @@ bool RealTimeBackupManager::executeBackup() {
             config.compressEnabled,
             config.packageEnabled,
             config.packageFileName,
-            config.password
+            config.password,
+            nullptr,
+            config.codec
         );
         
         if (success) {
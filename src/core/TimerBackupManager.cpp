@@ -145,7 +145,8 @@ bool TimerBackupManager::executeBackup() {
             localConfig.packageEnabled,
             localConfig.packageFileName,
             localConfig.password,
-            &interrupted
+            &interrupted,
+            localConfig.codec
         );
         
         if (success) {
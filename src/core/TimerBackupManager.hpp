@@ -8,6 +8,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include "../utils/Codec.hpp"
 
 // 前向声明
 class ILogger;
@@ -19,6 +20,7 @@ struct TimerBackupConfig {
     std::string backupDir;          // 备份目录
     std::vector<std::shared_ptr<Filter>> filters; // 过滤条件
     bool compressEnabled;           // 是否启用压缩
+    CodecId codec = CodecId::Huffman; // 压缩算法
     bool packageEnabled;            // 是否启用打包
     std::string packageFileName;    // 包文件名
     std::string password;           // 加密密码
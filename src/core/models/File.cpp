@@ -15,6 +15,85 @@
     #include <errno.h>
 #endif
 
+#ifndef _WIN32
+namespace {
+    // 一次系统调用取得的文件元数据
+    struct EntryStat {
+        unsigned int mode = 0;
+        uint64_t size = 0;
+        unsigned int linkCount = 1;
+        unsigned int uid = 0;
+        unsigned int gid = 0;
+        std::chrono::system_clock::time_point accessTime;
+        std::chrono::system_clock::time_point modifiedTime;
+        std::chrono::system_clock::time_point birthTime;
+        bool hasBirthTime = false;
+    };
+
+    std::chrono::system_clock::time_point toTimePoint(int64_t seconds, int64_t nanoseconds) {
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds)));
+    }
+
+    // 读取dirFd下name的元数据，不跟随符号链接；dirFd为AT_FDCWD时name可以是完整路径
+    bool statEntry(int dirFd, const char* name, EntryStat& out) {
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+        struct statx stx;
+        if (statx(dirFd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_BASIC_STATS | STATX_BTIME, &stx) == 0) {
+            out.mode = stx.stx_mode;
+            out.size = stx.stx_size;
+            out.linkCount = stx.stx_nlink;
+            out.uid = stx.stx_uid;
+            out.gid = stx.stx_gid;
+            out.accessTime = toTimePoint(stx.stx_atime.tv_sec, stx.stx_atime.tv_nsec);
+            out.modifiedTime = toTimePoint(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec);
+            out.hasBirthTime = (stx.stx_mask & STATX_BTIME) != 0;
+            if (out.hasBirthTime) {
+                out.birthTime = toTimePoint(stx.stx_btime.tv_sec, stx.stx_btime.tv_nsec);
+            }
+            return true;
+        }
+        // 旧内核或容器的系统调用过滤可能不支持statx，退回fstatat
+        if (errno != ENOSYS && errno != EPERM) {
+            return false;
+        }
+#endif
+        struct stat st;
+        if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            return false;
+        }
+        out.mode = st.st_mode;
+        out.size = static_cast<uint64_t>(st.st_size);
+        out.linkCount = static_cast<unsigned int>(st.st_nlink);
+        out.uid = st.st_uid;
+        out.gid = st.st_gid;
+#ifdef __APPLE__
+        out.accessTime = toTimePoint(st.st_atimespec.tv_sec, st.st_atimespec.tv_nsec);
+        out.modifiedTime = toTimePoint(st.st_mtimespec.tv_sec, st.st_mtimespec.tv_nsec);
+        out.birthTime = toTimePoint(st.st_birthtimespec.tv_sec, st.st_birthtimespec.tv_nsec);
+        out.hasBirthTime = true;
+#else
+        out.accessTime = toTimePoint(st.st_atim.tv_sec, st.st_atim.tv_nsec);
+        out.modifiedTime = toTimePoint(st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+#endif
+        return true;
+    }
+
+    fs::file_type fileTypeFromMode(unsigned int mode) {
+        switch (mode & S_IFMT) {
+            case S_IFREG: return fs::file_type::regular;
+            case S_IFDIR: return fs::file_type::directory;
+            case S_IFLNK: return fs::file_type::symlink;
+            case S_IFIFO: return fs::file_type::fifo;
+            case S_IFCHR: return fs::file_type::character;
+            case S_IFBLK: return fs::file_type::block;
+            case S_IFSOCK: return fs::file_type::socket;
+            default: return fs::file_type::unknown;
+        }
+    }
+}
+#endif
+
 File::File(): 
     fileType(fs::file_type::none),
     fileSize(0),
@@ -28,7 +107,26 @@ File::File(const fs::path& path) {
     initialize(path);
 }
 
+File File::fromMetadata(const fs::path& path, fs::file_type type, uint64_t size, unsigned int permissions,
+                       std::chrono::system_clock::time_point creationTime,
+                       std::chrono::system_clock::time_point lastModifiedTime,
+                       std::chrono::system_clock::time_point lastAccessTime,
+                       const fs::path& symlinkTarget) {
+    File file;
+    file.filePath = path;
+    file.fileName = path.filename().string();
+    file.fileType = type;
+    file.fileSize = size;
+    file.permissions = permissions;
+    file.creationTime = creationTime;
+    file.lastModifiedTime = lastModifiedTime;
+    file.lastAccessTime = lastAccessTime;
+    file.symlinkTarget = symlinkTarget;
+    return file;
+}
+
 void File::initialize(const fs::path& path) {
+#ifdef _WIN32
     this->filePath = path;
     this->fileName = path.filename().string();
     this->dataLoaded = false;
@@ -38,54 +136,26 @@ void File::initialize(const fs::path& path) {
         std::error_code ec;
         fs::file_status status = fs::symlink_status(path, ec);
         if (ec) {
-            this->fileType = fs::file_type::none;
-            // 确保元数据始终被初始化
-            this->fileSize = 0;
-            this->hardLinkCount = 1;
-            this->permissions = 0644; // 默认权限
-            this->ownerId = 0;
-            this->groupId = 0;
-            this->isHardLink = false;
-            this->symlinkTarget.clear();
-            // 使用当前时间作为默认时间戳
-            auto now = std::chrono::system_clock::now();
-            this->creationTime = now;
-            this->lastModifiedTime = now;
-            this->lastAccessTime = now;
+            resetMetadata();
             return;
         }
         this->fileType = status.type();
         
         // 获取文件大小
+        this->fileSize = 0;
         if (fs::is_regular_file(status)) {
             this->fileSize = fs::file_size(path, ec);
             if (ec) {
                 this->fileSize = 0;
             }
-        } else {
-            this->fileSize = 0;
         }
         
-        // 获取硬链接数量和权限信息
         this->hardLinkCount = 1;
         this->permissions = 0644; // 默认权限
         this->ownerId = 0;
         this->groupId = 0;
         this->isHardLink = false;
         
-        #ifdef _WIN32
-            // Windows平台实现 - 使用后面定义的fileInfo变量
-        #else
-            struct stat st;
-            if (stat(path.string().c_str(), &st) == 0) {
-                this->hardLinkCount = st.st_nlink;
-                this->isHardLink = (this->hardLinkCount > 1);
-                this->permissions = st.st_mode & 07777; // 获取权限
-                this->ownerId = st.st_uid;
-                this->groupId = st.st_gid;
-            }
-        #endif
-        
         // 获取符号链接目标
         this->symlinkTarget.clear();
         if (fs::is_symlink(status)) {
@@ -95,29 +165,15 @@ void File::initialize(const fs::path& path) {
             }
         }
         
-        // 从文件系统获取实际的时间戳
-        try {
-            // 获取文件的最后修改时间
-            std::error_code ec2;
-            auto ftime = fs::last_write_time(path, ec2);
-            if (!ec2) {
-                // 将文件时间转换为system_clock::time_point
-                // 处理不同平台的时间类型差异
-                auto fileTimePoint = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                    ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                
-                this->lastModifiedTime = fileTimePoint;
-                this->lastAccessTime = fileTimePoint;
-                this->creationTime = fileTimePoint;
-            } else {
-                // 如果获取失败，使用当前时间作为默认时间戳
-                auto now = std::chrono::system_clock::now();
-                this->creationTime = now;
-                this->lastModifiedTime = now;
-                this->lastAccessTime = now;
-            }
-        } catch (const std::exception&) {
-            // 如果转换失败，使用当前时间作为默认时间戳
+        // 只能取到修改时间，创建/访问时间也用它代替
+        auto ftime = fs::last_write_time(path, ec);
+        if (!ec) {
+            auto fileTimePoint = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+                ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+            this->lastModifiedTime = fileTimePoint;
+            this->lastAccessTime = fileTimePoint;
+            this->creationTime = fileTimePoint;
+        } else {
             auto now = std::chrono::system_clock::now();
             this->creationTime = now;
             this->lastModifiedTime = now;
@@ -126,21 +182,72 @@ void File::initialize(const fs::path& path) {
         
     } catch (const std::exception& e) {
         std::cerr << "Error initializing file: " << e.what() << std::endl; 
-        // 确保元数据始终被初始化
-        this->fileType = fs::file_type::none;
-        this->fileSize = 0;
-        this->hardLinkCount = 1;
-        this->permissions = 0644; // 默认权限
-        this->ownerId = 0;
-        this->groupId = 0;
-        this->isHardLink = false;
-        this->symlinkTarget.clear();
-        // 使用当前时间作为默认时间戳
-        auto now = std::chrono::system_clock::now();
-        this->creationTime = now;
-        this->lastModifiedTime = now;
-        this->lastAccessTime = now;
+        resetMetadata();
+    }
+#else
+    initializeAt(AT_FDCWD, path.c_str(), path);
+#endif
+}
+
+#ifndef _WIN32
+void File::initializeAt(int dirFd, const char* name, const fs::path& path) {
+    this->filePath = path;
+    this->fileName = path.filename().string();
+    this->dataLoaded = false;
+    this->symlinkTarget.clear();
+    
+    // 一次statx（或fstatat）取得全部元数据，不解析符号链接
+    EntryStat st;
+    if (!statEntry(dirFd, name, st)) {
+        resetMetadata();
+        return;
     }
+    
+    this->fileType = fileTypeFromMode(st.mode);
+    this->fileSize = this->fileType == fs::file_type::regular ? st.size : 0;
+    this->permissions = st.mode & 07777;
+    this->ownerId = st.uid;
+    this->groupId = st.gid;
+    this->hardLinkCount = st.linkCount;
+    this->isHardLink = (this->hardLinkCount > 1);
+    this->lastModifiedTime = st.modifiedTime;
+    this->lastAccessTime = st.accessTime;
+    // 文件系统不记录创建时间时用修改时间代替
+    this->creationTime = st.hasBirthTime ? st.birthTime : st.modifiedTime;
+    
+    // 获取符号链接目标
+    if (this->fileType == fs::file_type::symlink) {
+        char target[4096];
+        ssize_t length = readlinkat(dirFd, name, target, sizeof(target));
+        if (length >= 0 && static_cast<size_t>(length) < sizeof(target)) {
+            this->symlinkTarget = fs::path(std::string(target, static_cast<size_t>(length)));
+        } else {
+            // 目标过长时退回标准库实现
+            std::error_code ec;
+            this->symlinkTarget = fs::read_symlink(path, ec);
+            if (ec) {
+                this->symlinkTarget.clear();
+            }
+        }
+    }
+}
+#endif
+
+void File::resetMetadata() {
+    // 无法获取状态时，确保元数据始终被初始化
+    this->fileType = fs::file_type::none;
+    this->fileSize = 0;
+    this->hardLinkCount = 1;
+    this->permissions = 0644; // 默认权限
+    this->ownerId = 0;
+    this->groupId = 0;
+    this->isHardLink = false;
+    this->symlinkTarget.clear();
+    // 使用当前时间作为默认时间戳
+    auto now = std::chrono::system_clock::now();
+    this->creationTime = now;
+    this->lastModifiedTime = now;
+    this->lastAccessTime = now;
 }
 
 const fs::path& File::getFilePath() const {
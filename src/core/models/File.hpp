@@ -37,11 +37,30 @@ private:
     bool isHardLink; // 是否是硬链接
     unsigned int hardLinkCount; // 硬链接数量
 
+    // 无法获取文件状态时的默认元数据
+    void resetMetadata();
+    
+    // 从扫描目录还原File时直接填入属主和链接信息
+    friend class FileEntry;
+
 public:
     File();
     explicit File(const fs::path& path);
     void initialize(const fs::path& path);
     
+#ifndef _WIN32
+    // 按已打开目录dirFd下的名称初始化，遍历目录时不必重复解析整条路径
+    // 元数据通过一次statx（不支持时fstatat）取得，不跟随符号链接
+    void initializeAt(int dirFd, const char* name, const fs::path& path);
+#endif
+    
+    // 由已知的元数据构造，不访问磁盘（例如描述包中的条目，以便用过滤器匹配）
+    static File fromMetadata(const fs::path& path, fs::file_type type, uint64_t size, unsigned int permissions,
+                             std::chrono::system_clock::time_point creationTime,
+                             std::chrono::system_clock::time_point lastModifiedTime,
+                             std::chrono::system_clock::time_point lastAccessTime,
+                             const fs::path& symlinkTarget = fs::path());
+    
     // 基本属性访问
     const fs::path& getFilePath() const;
     const std::string& getFileName() const;
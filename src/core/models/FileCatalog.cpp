@@ -0,0 +1,191 @@
+#include "FileCatalog.hpp"
+#include <algorithm>
+
+namespace {
+    using Clock = std::chrono::system_clock;
+
+    int64_t toCount(Clock::time_point time) {
+        return static_cast<int64_t>(time.time_since_epoch().count());
+    }
+
+    Clock::time_point fromCount(int64_t count) {
+        return Clock::time_point(Clock::duration(count));
+    }
+
+    template <typename T>
+    void permute(std::vector<T>& column, const std::vector<size_t>& order) {
+        std::vector<T> result;
+        result.reserve(order.size());
+        for (size_t index : order) {
+            result.push_back(column[index]);
+        }
+        column.swap(result);
+    }
+
+    template <typename T>
+    size_t capacityBytes(const std::vector<T>& column) {
+        return column.capacity() * sizeof(T);
+    }
+}
+
+fs::path FileEntry::getFilePath() const {
+    std::string_view stored = getStoredPath();
+    if (stored.empty()) {
+        return catalog->root;
+    }
+    return catalog->root / fs::path(stored);
+}
+
+std::string_view FileEntry::getStoredPath() const {
+    return catalog->text(catalog->pathOffsets[entryIndex], catalog->pathLengths[entryIndex]);
+}
+
+fs::path FileEntry::getRelativePath(const fs::path& base) const {
+    if ((catalog->flags[entryIndex] & FileCatalog::FLAG_DIRECT) && base == catalog->root) {
+        return fs::path(getStoredPath());
+    }
+    return toFile().getRelativePath(base);
+}
+
+fs::file_type FileEntry::getFileType() const {
+    return static_cast<fs::file_type>(catalog->types[entryIndex]);
+}
+
+uint64_t FileEntry::getFileSize() const {
+    return catalog->sizes[entryIndex];
+}
+
+unsigned int FileEntry::getPermissions() const {
+    return catalog->permissions[entryIndex];
+}
+
+std::chrono::system_clock::time_point FileEntry::getCreationTime() const {
+    return fromCount(catalog->creationTimes[entryIndex]);
+}
+
+std::chrono::system_clock::time_point FileEntry::getLastModifiedTime() const {
+    return fromCount(catalog->modifiedTimes[entryIndex]);
+}
+
+std::chrono::system_clock::time_point FileEntry::getLastAccessTime() const {
+    return fromCount(catalog->accessTimes[entryIndex]);
+}
+
+fs::path FileEntry::getSymlinkTarget() const {
+    return fs::path(catalog->text(catalog->targetOffsets[entryIndex], catalog->targetLengths[entryIndex]));
+}
+
+File FileEntry::toFile() const {
+    File file = File::fromMetadata(getFilePath(), getFileType(), getFileSize(), getPermissions(),
+                                   getCreationTime(), getLastModifiedTime(), getLastAccessTime(),
+                                   getSymlinkTarget());
+    file.ownerId = catalog->ownerIds[entryIndex];
+    file.groupId = catalog->groupIds[entryIndex];
+    file.hardLinkCount = catalog->linkCounts[entryIndex];
+    file.isHardLink = file.hardLinkCount > 1;
+    return file;
+}
+
+FileCatalog::FileCatalog(const fs::path& root) : root(root) {
+}
+
+void FileCatalog::reserve(size_t count) {
+    pathOffsets.reserve(count);
+    pathLengths.reserve(count);
+    targetOffsets.reserve(count);
+    targetLengths.reserve(count);
+    types.reserve(count);
+    flags.reserve(count);
+    permissions.reserve(count);
+    ownerIds.reserve(count);
+    groupIds.reserve(count);
+    linkCounts.reserve(count);
+    sizes.reserve(count);
+    creationTimes.reserve(count);
+    modifiedTimes.reserve(count);
+    accessTimes.reserve(count);
+}
+
+void FileCatalog::add(const File& file, std::string_view relativePath, bool direct) {
+    pathOffsets.push_back(pathArena.size());
+    pathLengths.push_back(static_cast<uint32_t>(relativePath.size()));
+    pathArena.append(relativePath.data(), relativePath.size());
+
+    std::string target = file.getSymlinkTarget().string();
+    targetOffsets.push_back(pathArena.size());
+    targetLengths.push_back(static_cast<uint32_t>(target.size()));
+    pathArena.append(target);
+
+    types.push_back(static_cast<uint8_t>(file.getFileType()));
+    flags.push_back(direct ? FLAG_DIRECT : 0);
+    permissions.push_back(static_cast<uint16_t>(file.getPermissions()));
+    ownerIds.push_back(file.getOwnerId());
+    groupIds.push_back(file.getGroupId());
+    linkCounts.push_back(file.getHardLinkCount());
+    sizes.push_back(file.getFileSize());
+    creationTimes.push_back(toCount(file.getCreationTime()));
+    modifiedTimes.push_back(toCount(file.getLastModifiedTime()));
+    accessTimes.push_back(toCount(file.getLastAccessTime()));
+}
+
+void FileCatalog::append(FileCatalog&& other) {
+    if (empty()) {
+        fs::path keepRoot = root;
+        *this = std::move(other);
+        root = keepRoot;
+        other = FileCatalog(root);
+        return;
+    }
+    uint64_t shift = pathArena.size();
+    pathArena.append(other.pathArena);
+    for (uint64_t offset : other.pathOffsets) {
+        pathOffsets.push_back(offset + shift);
+    }
+    for (uint64_t offset : other.targetOffsets) {
+        targetOffsets.push_back(offset + shift);
+    }
+    auto extend = [](auto& column, const auto& source) {
+        column.insert(column.end(), source.begin(), source.end());
+    };
+    extend(pathLengths, other.pathLengths);
+    extend(targetLengths, other.targetLengths);
+    extend(types, other.types);
+    extend(flags, other.flags);
+    extend(permissions, other.permissions);
+    extend(ownerIds, other.ownerIds);
+    extend(groupIds, other.groupIds);
+    extend(linkCounts, other.linkCounts);
+    extend(sizes, other.sizes);
+    extend(creationTimes, other.creationTimes);
+    extend(modifiedTimes, other.modifiedTimes);
+    extend(accessTimes, other.accessTimes);
+    other = FileCatalog(other.root);
+}
+
+void FileCatalog::reorder(const std::vector<size_t>& order) {
+    // 路径区不移动，只重排各列（丢弃的条目在路径区中留下的空间不回收）
+    permute(pathOffsets, order);
+    permute(pathLengths, order);
+    permute(targetOffsets, order);
+    permute(targetLengths, order);
+    permute(types, order);
+    permute(flags, order);
+    permute(permissions, order);
+    permute(ownerIds, order);
+    permute(groupIds, order);
+    permute(linkCounts, order);
+    permute(sizes, order);
+    permute(creationTimes, order);
+    permute(modifiedTimes, order);
+    permute(accessTimes, order);
+}
+
+size_t FileCatalog::memoryUsage() const {
+    return sizeof(*this) + pathArena.capacity() +
+           capacityBytes(pathOffsets) + capacityBytes(pathLengths) +
+           capacityBytes(targetOffsets) + capacityBytes(targetLengths) +
+           capacityBytes(types) + capacityBytes(flags) + capacityBytes(permissions) +
+           capacityBytes(ownerIds) + capacityBytes(groupIds) + capacityBytes(linkCounts) +
+           capacityBytes(sizes) + capacityBytes(creationTimes) +
+           capacityBytes(modifiedTimes) + capacityBytes(accessTimes);
+}
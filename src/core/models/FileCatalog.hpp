@@ -0,0 +1,104 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include "File.hpp"
+
+namespace fs = std::filesystem;
+
+class FileCatalog;
+
+// 目录中一个条目的只读视图（目录引用 + 下标），按值传递，不复制任何数据
+// 访问接口与File相同，扫描、过滤、备份各阶段可以直接替换使用
+class FileEntry {
+public:
+    FileEntry(const FileCatalog& catalog, size_t index) : catalog(&catalog), entryIndex(index) {}
+
+    size_t index() const { return entryIndex; }
+
+    // 完整路径（根目录 / 扫描时的相对路径）
+    fs::path getFilePath() const;
+    // 扫描时的相对路径，直接指向目录内的路径区，不分配内存
+    std::string_view getStoredPath() const;
+    // 相对base的路径：base为扫描根目录且条目是直接扫描到的时直接返回存储的路径，
+    // 否则（经由符号链接到达、条目本身是符号链接）与File::getRelativePath的结果相同
+    fs::path getRelativePath(const fs::path& base) const;
+
+    fs::file_type getFileType() const;
+    uint64_t getFileSize() const;
+    unsigned int getPermissions() const;
+    std::chrono::system_clock::time_point getCreationTime() const;
+    std::chrono::system_clock::time_point getLastModifiedTime() const;
+    std::chrono::system_clock::time_point getLastAccessTime() const;
+    fs::path getSymlinkTarget() const;
+
+    bool isDirectory() const { return getFileType() == fs::file_type::directory; }
+    bool isRegularFile() const { return getFileType() == fs::file_type::regular; }
+    bool isSymbolicLink() const { return getFileType() == fs::file_type::symlink; }
+
+    // 还原为完整的File对象（仍需要File接口的地方使用，例如过滤器）
+    File toFile() const;
+
+private:
+    const FileCatalog* catalog;
+    size_t entryIndex;
+};
+
+// 扫描结果目录：按列存储（struct-of-arrays），路径集中存放在一块连续的路径区中
+// 每个条目只占固定的几十字节加上相对路径本身，不保存File中的文件名副本、数据缓冲等；
+// 过滤、备份、打包各阶段通过下标共享同一份目录，而不是复制std::vector<File>：
+//   FileCatalog catalog = FileSystem::scanDirectory(source);
+//   for (size_t i = 0; i < catalog.size(); ++i) { FileEntry entry = catalog[i]; ... }
+class FileCatalog {
+public:
+    explicit FileCatalog(const fs::path& root = fs::path());
+
+    const fs::path& getRoot() const { return root; }
+    size_t size() const { return types.size(); }
+    bool empty() const { return types.empty(); }
+    FileEntry operator[](size_t index) const { return FileEntry(*this, index); }
+
+    void reserve(size_t count);
+
+    // 追加一个条目，relativePath为相对根目录的路径
+    // direct为false表示条目经由符号链接到达或本身是符号链接，计算备份相对路径时需要解析真实路径
+    void add(const File& file, std::string_view relativePath, bool direct = true);
+
+    // 追加另一个目录的全部条目（两者根目录相同）
+    void append(FileCatalog&& other);
+
+    // 按order中的下标重新排列，不在order中的条目被丢弃（用于排序和过滤）
+    void reorder(const std::vector<size_t>& order);
+
+    // 目录占用的内存（字节，按容量计算）
+    size_t memoryUsage() const;
+
+private:
+    friend class FileEntry;
+
+    std::string_view text(uint64_t offset, uint32_t length) const {
+        return std::string_view(pathArena.data() + offset, length);
+    }
+
+    static constexpr uint8_t FLAG_DIRECT = 1;
+
+    fs::path root;
+    std::string pathArena;                 // 所有相对路径和符号链接目标依次存放
+    std::vector<uint64_t> pathOffsets;
+    std::vector<uint32_t> pathLengths;
+    std::vector<uint64_t> targetOffsets;   // 符号链接目标，非符号链接长度为0
+    std::vector<uint32_t> targetLengths;
+    std::vector<uint8_t> types;            // fs::file_type
+    std::vector<uint8_t> flags;
+    std::vector<uint16_t> permissions;
+    std::vector<uint32_t> ownerIds;
+    std::vector<uint32_t> groupIds;
+    std::vector<uint32_t> linkCounts;
+    std::vector<uint64_t> sizes;
+    std::vector<int64_t> creationTimes;    // system_clock的时间计数
+    std::vector<int64_t> modifiedTimes;
+    std::vector<int64_t> accessTimes;
+};
@@ -2,19 +2,43 @@
 #include "../../utils/FileSystem.hpp"
 #include "../../utils/FilePackager.hpp"
 #include "../../utils/Encryption.hpp"
+#include "../../utils/EncryptedStream.hpp"
 #include <filesystem>
 #include <atomic>
+#include <algorithm>
+
+namespace {
+
+// 压缩输出直接写入加密流，compressedSize返回压缩后（加密前）的字节数
+bool compressIntoEncryptedFile(const std::string& source, const std::string& destination, CodecId codec,
+                               KeyCache& keys, uint64_t& compressedSize) {
+    std::ifstream inFile(source, std::ios::binary);
+    if (!inFile) {
+        return false;
+    }
+    EncryptingStreamBuf encrypted;
+    if (!encrypted.open(destination, keys)) {
+        return false;
+    }
+    std::ostream outFile(&encrypted);
+    bool ok = Codec::compressStream(codec, inFile, outFile);
+    compressedSize = encrypted.size();
+    return encrypted.close() && ok;
+}
+
+} // namespace
 
 BackupTask::BackupTask(const std::string& source, const std::string& backup, ILogger* log, 
                       const std::vector<std::shared_ptr<Filter>>& filterList, bool compress, bool package, const std::string& pkgFileName, const std::string& pass, 
-                      std::atomic<bool>* interruptFlag) 
+                      std::atomic<bool>* interruptFlag, CodecId codecId) 
   : sourcePath(source), backupPath(backup), status(TaskStatus::PENDING), logger(log), filters(filterList), 
-    compressEnabled(compress), packageEnabled(package), packageFileName(pkgFileName), password(pass), 
+    compressEnabled(compress), codec(codecId), packageEnabled(package), packageFileName(pkgFileName), password(pass), 
     interrupted(interruptFlag) {}
 
 bool BackupTask::execute() {
     logger->info("Starting backup: " + sourcePath + " -> " + backupPath);
     status = TaskStatus::RUNNING;
+    compressionStats = CompressionStats();
     
     // 检查是否被中断
     if (isInterrupted()) {
@@ -36,148 +60,71 @@ bool BackupTask::execute() {
         return false;
     }
     
-    auto files = FileSystem::getAllFiles(sourcePath);
-    
-    // 应用过滤器
-    std::vector<File> filteredFiles;
-    for (const auto& file : files) {
-        bool passAllFilters = true;
-        for (const auto& filter : filters) {
-            if (!filter->match(file)) {
-                passAllFilters = false;
-                break;
-            }
-        }
-        if (passAllFilters) {
-            filteredFiles.push_back(file);
-        }
-    }
-    
-    files = filteredFiles;
-    
-    if (files.empty()) {
-        logger->warn("No files found to backup");
-        status = TaskStatus::COMPLETED;
-        return true;
+    // 打包时源文件直接流式写入包中，不在备份目录生成逐个文件的临时副本
+    if (packageEnabled) {
+        return backupToPackage();
     }
-    int successCount = 0;
-    uint64_t totalSize = 0;
     
-    // 用于存储所有备份文件路径，以便后续拼接
+    // 不能在复制时加密的文件（符号链接等），复制后再单独加密
     std::vector<std::string> backedUpFiles;
+    // 目录在其中的内容全部写入后再复制，避免只读目录阻止写入、写入内容又改变目录的时间戳
+    std::vector<std::string> directories;
+    // 整个作业共用一个主密钥，PBKDF2只运行一次
+    KeyCache keys(password);
+    size_t matchedCount = 0;
+    bool cancelled = false;
     
-    for (const auto& file : files) {
+    // 扫描与复制重叠进行：遍历线程发现的条目经有界队列逐个交到这里处理，
+    // 不等待整个目录树扫描完，也不保存完整的文件列表
+    bool completed = FileSystem::streamDirectory(sourcePath, [&](const FileEntry& file) {
+        if (!passesFilters(file)) {
+            return true;
+        }
+        ++matchedCount;
         // 检查是否被中断
         if (isInterrupted()) {
-            logger->info("Backup interrupted.");
-            status = TaskStatus::CANCELLED;
+            cancelled = true;
             return false;
         }
-        
-        std::string relativePath = file.getRelativePath(std::filesystem::path(sourcePath)).string();
-        std::string backupFile = (std::filesystem::path(backupPath) / relativePath).string();
-        
-        // 获取父目录路径
-        std::string parentDir = std::filesystem::path(backupFile).parent_path().string();
-        
-        if (!parentDir.empty() && !FileSystem::createDirectories(parentDir)) {
-            logger->error("Failed to create target directory: " + parentDir);
-            status = TaskStatus::FAILED;
-            return false;
+        if (file.isDirectory()) {
+            directories.push_back(file.getRelativePath(std::filesystem::path(sourcePath)).string());
+            return true;
         }
-
-        // 根据压缩开关和文件类型选择复制方式
-        bool success;
-        std::string finalBackupFile;
-        if (compressEnabled && file.isRegularFile()) {
-            // 仅对普通文件进行压缩，添加.huff扩展名
-            std::string compressedBackupFile = backupFile + ".huff";
-            success = FileSystem::copyAndCompressFile(file.getFilePath().string(), compressedBackupFile);
-            
-            // 检查压缩是否真正创建了.huff文件
-            if (success) {
-                // 检查文件是否实际存在
-                if (std::filesystem::exists(compressedBackupFile)) {
-                    finalBackupFile = compressedBackupFile;
-                } else {
-                    // 压缩失败，文件已被替换为非压缩版本
-                    finalBackupFile = backupFile;
-                }
-            } else {
-                // 压缩失败，直接复制
-                finalBackupFile = backupFile;
-                success = FileSystem::copyFile(file.getFilePath().string(), backupFile);
-            }
-        } else if (file.isSymbolicLink()) {
-            // 处理符号链接文件
-            // 符号链接需要被打包，所以直接复制到备份目录
-            // 但不会添加到打包文件列表中，因为符号链接的处理逻辑在FilePackager中
-            finalBackupFile = backupFile;
-            success = FileSystem::copyFile(file.getFilePath().string(), backupFile);
-        } else {
-            // 对非普通文件和非符号链接文件（目录、设备文件等）直接复制，不压缩
-            finalBackupFile = backupFile;
-            success = FileSystem::copyFile(file.getFilePath().string(), backupFile);
-        }
-        
-        if (!success) {
-            logger->error("Copy failed: " + file.getFilePath().string() + " -> " + finalBackupFile);
-            status = TaskStatus::FAILED;
-            return false;
-        }
-        
-        // 将备份后的实际文件路径添加到列表中，包括符号链接
-        // 符号链接需要被打包，FilePackager会处理符号链接的特殊逻辑
-        backedUpFiles.push_back(finalBackupFile);
-        
-        successCount++;
-        totalSize += file.getFileSize();
+        return backupEntry(file, keys, backedUpFiles);
+    }, 0, descendFilter());
+    
+    if (cancelled) {
+        logger->info("Backup interrupted.");
+        status = TaskStatus::CANCELLED;
+        return false;
+    }
+    if (!completed) {
+        // backupEntry已记录错误并设置状态
+        return false;
+    }
+    if (matchedCount == 0) {
+        logger->warn("No files found to backup");
+        status = TaskStatus::COMPLETED;
+        return true;
     }
     
-    // 如果启用了文件拼接功能，将所有备份文件拼接成一个包文件
-    std::string finalPackagePath;
-    if (packageEnabled) {
-        // 检查是否被中断
-        if (isInterrupted()) {
-            logger->info("Backup interrupted.");
-            status = TaskStatus::CANCELLED;
-            return false;
-        }
-        
-        logger->info("Packaging backup files into a single file...");
-        
-        finalPackagePath = (std::filesystem::path(backupPath) / packageFileName).string();
-        
-        // 在删除原始文件之前，将它们转换为File对象，以便正确读取元数据
-        std::vector<File> backupFileObjects;
-        for (const auto& filePath : backedUpFiles) {
-            backupFileObjects.emplace_back(filePath);
-        }
-        
-        // 创建FilePackager实例并执行拼接
-        FilePackager packager;
-        if (!packager.packageFiles(backupFileObjects, finalPackagePath)) {
-            logger->error("Failed to package backup files");
+    // 子目录先于父目录处理，父目录的权限和时间戳最后设置
+    std::sort(directories.rbegin(), directories.rend());
+    for (const auto& relativePath : directories) {
+        std::string sourceDir = (std::filesystem::path(sourcePath) / relativePath).string();
+        std::string backupDir = (std::filesystem::path(backupPath) / relativePath).string();
+        if (!FileSystem::copyFile(sourceDir, backupDir)) {
+            logger->error("Copy failed: " + sourceDir + " -> " + backupDir);
             status = TaskStatus::FAILED;
             return false;
         }
-        
-        logger->info("Backup files packaged successfully: " + finalPackagePath);
-        
-        // 删除原始备份文件，只保留打包文件
-        for (const auto& file : backedUpFiles) {
-            if (!FileSystem::removeFile(file)) {
-                logger->warn("Failed to remove temporary backup file: " + file);
-            }
-        }
-        
-        // 删除空目录
-        removeEmptyDirectories(backupPath);
-        
-        logger->info("Removed temporary backup files, only packaged file remains");
-        
-        // 如果提供了密码，则加密打包文件
-        if (!password.empty()) {
+    }
+    
+    reportSkippedCompression();
+    
+    // 普通文件已在复制时加密，这里只剩符号链接等其他文件
+    if (!password.empty()) {
+        for (auto& backupFile : backedUpFiles) {
             // 检查是否被中断
             if (isInterrupted()) {
                 logger->info("Backup interrupted.");
@@ -185,86 +132,41 @@ bool BackupTask::execute() {
                 return false;
             }
             
-            std::string encryptedFile = finalPackagePath + ".enc";
-            if (!Encryption::encryptFile(finalPackagePath, encryptedFile, password)) {
-                logger->error("Encryption failed: " + finalPackagePath);
+            std::string encryptedFile = backupFile + ".enc";
+            if (!Encryption::encryptFile(backupFile, encryptedFile, keys)) {
+                logger->error("Encryption failed: " + backupFile);
                 status = TaskStatus::FAILED;
                 return false;
             }
             
-            // 复制打包文件的元数据到加密后的文件
+            // 复制加密前文件的元数据到加密后的文件
             std::error_code ec;
-            auto fileTime = std::filesystem::last_write_time(finalPackagePath, ec);
-            if (!ec) {
-                std::filesystem::last_write_time(encryptedFile, fileTime, ec);
-                if (ec) {
-                    logger->warn("Failed to copy file time to encrypted package: " + encryptedFile);
-                }
-            }
             
-            // 复制权限
-            auto permissions = std::filesystem::status(finalPackagePath, ec).permissions();
+            // 获取加密前文件的元数据
+            auto fileStatus = std::filesystem::status(backupFile, ec);
             if (!ec) {
-                std::filesystem::permissions(encryptedFile, permissions, ec);
-                if (ec) {
-                    logger->warn("Failed to copy permissions to encrypted package: " + encryptedFile);
-                }
-            }
-            
-            // 删除未加密的打包文件
-            if (!FileSystem::removeFile(finalPackagePath)) {
-                logger->warn("Failed to remove unencrypted package file: " + finalPackagePath);
-            }
-            
-            finalPackagePath = encryptedFile;
-        }
-    } else {
-        // 如果不打包，则对每个文件进行加密
-        if (!password.empty()) {
-            for (auto& backupFile : backedUpFiles) {
-                // 检查是否被中断
-                if (isInterrupted()) {
-                    logger->info("Backup interrupted.");
-                    status = TaskStatus::CANCELLED;
-                    return false;
-                }
-                
-                std::string encryptedFile = backupFile + ".enc";
-                if (!Encryption::encryptFile(backupFile, encryptedFile, password)) {
-                    logger->error("Encryption failed: " + backupFile);
-                    status = TaskStatus::FAILED;
-                    return false;
-                }
-                
-                // 复制加密前文件的元数据到加密后的文件
-                std::error_code ec;
-                
-                // 获取加密前文件的元数据
-                auto fileStatus = std::filesystem::status(backupFile, ec);
+                // 复制修改时间
+                auto fileTime = std::filesystem::last_write_time(backupFile, ec);
                 if (!ec) {
-                    // 复制修改时间
-                    auto fileTime = std::filesystem::last_write_time(backupFile, ec);
-                    if (!ec) {
-                        std::filesystem::last_write_time(encryptedFile, fileTime, ec);
-                        if (ec) {
-                            logger->warn("Failed to copy file time to encrypted file: " + encryptedFile);
-                        }
-                    }
-                    
-                    // 复制权限
-                    std::filesystem::permissions(encryptedFile, fileStatus.permissions(), ec);
+                    std::filesystem::last_write_time(encryptedFile, fileTime, ec);
                     if (ec) {
-                        logger->warn("Failed to copy permissions to encrypted file: " + encryptedFile);
+                        logger->warn("Failed to copy file time to encrypted file: " + encryptedFile);
                     }
                 }
                 
-                // 删除未加密的备份文件
-                if (!FileSystem::removeFile(backupFile)) {
-                    logger->warn("Failed to remove unencrypted backup file: " + backupFile);
+                // 复制权限
+                std::filesystem::permissions(encryptedFile, fileStatus.permissions(), ec);
+                if (ec) {
+                    logger->warn("Failed to copy permissions to encrypted file: " + encryptedFile);
                 }
-                
-                backupFile = encryptedFile;
             }
+            
+            // 删除未加密的备份文件
+            if (!FileSystem::removeFile(backupFile)) {
+                logger->warn("Failed to remove unencrypted backup file: " + backupFile);
+            }
+            
+            backupFile = encryptedFile;
         }
     }
     
@@ -273,6 +175,102 @@ bool BackupTask::execute() {
     return true;
 }
 
+bool BackupTask::passesFilters(const FileEntry& file) const {
+    if (filters.empty()) {
+        return true;
+    }
+    File candidate = file.toFile();
+    for (const auto& filter : filters) {
+        if (!filter->match(candidate)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::function<bool(const std::filesystem::path&)> BackupTask::descendFilter() const {
+    if (filters.empty()) {
+        return nullptr;
+    }
+    // 被剪掉的目录中的条目反正不会通过passesFilters，遍历时直接跳过，不打开也不stat
+    return [this](const std::filesystem::path& directory) {
+        for (const auto& filter : filters) {
+            if (!filter->shouldDescend(directory)) {
+                return false;
+            }
+        }
+        return true;
+    };
+}
+
+bool BackupTask::backupEntry(const FileEntry& file, KeyCache& keys, std::vector<std::string>& backedUpFiles) {
+    std::string relativePath = file.getRelativePath(std::filesystem::path(sourcePath)).string();
+    std::string backupFile = (std::filesystem::path(backupPath) / relativePath).string();
+    
+    // 获取父目录路径
+    std::string parentDir = std::filesystem::path(backupFile).parent_path().string();
+    
+    if (!parentDir.empty() && !FileSystem::createDirectories(parentDir)) {
+        logger->error("Failed to create target directory: " + parentDir);
+        status = TaskStatus::FAILED;
+        return false;
+    }
+
+    // 根据压缩开关和文件类型选择复制方式
+    bool success;
+    std::string finalBackupFile;
+    if (!password.empty() && file.isRegularFile()) {
+        // 需要加密时，普通文件单遍读取、在内存中压缩加密后只写出最终的.enc文件
+        if (!backupEncryptedFile(file, backupFile, keys, finalBackupFile)) {
+            logger->error("Encryption failed: " + file.getFilePath().string());
+            status = TaskStatus::FAILED;
+            return false;
+        }
+        return true;
+    } else if (compressEnabled && file.isRegularFile()) {
+        // 仅对普通文件进行压缩，添加所选算法的扩展名
+        std::string compressedBackupFile = backupFile + Codec::extensionOf(codec);
+        CompressResult result = CompressResult::Failed;
+        success = FileSystem::copyAndCompressFile(file.getFilePath().string(), compressedBackupFile, codec, &result);
+        compressionStats.record(result, file.getFileSize());
+        
+        // 检查压缩是否真正创建了.huff文件
+        if (success) {
+            // 检查文件是否实际存在
+            if (std::filesystem::exists(compressedBackupFile)) {
+                finalBackupFile = compressedBackupFile;
+            } else {
+                // 压缩失败，文件已被替换为非压缩版本
+                finalBackupFile = backupFile;
+            }
+        } else {
+            // 压缩失败，直接复制
+            finalBackupFile = backupFile;
+            success = FileSystem::copyFile(file.getFilePath().string(), backupFile);
+        }
+    } else if (file.isSymbolicLink()) {
+        // 处理符号链接文件，直接复制链接本身
+        finalBackupFile = backupFile;
+        success = FileSystem::copyFile(file.getFilePath().string(), backupFile);
+    } else {
+        // 对非普通文件和非符号链接文件（设备文件等）直接复制，不压缩
+        finalBackupFile = backupFile;
+        success = FileSystem::copyFile(file.getFilePath().string(), backupFile);
+    }
+    
+    if (!success) {
+        logger->error("Copy failed: " + file.getFilePath().string() + " -> " + finalBackupFile);
+        status = TaskStatus::FAILED;
+        return false;
+    }
+    
+    // 需要加密时记录备份后的实际文件路径，包括符号链接
+    if (!password.empty()) {
+        backedUpFiles.push_back(finalBackupFile);
+    }
+    return true;
+}
+
 TaskStatus BackupTask::getStatus() const {
     return status;
 }
@@ -284,18 +282,172 @@ bool BackupTask::isInterrupted() const {
     return false;
 }
 
-// 删除空目录的辅助方法
-void BackupTask::removeEmptyDirectories(const std::string& path) {
-    for (auto it = std::filesystem::directory_iterator(path); it != std::filesystem::directory_iterator();) {
-        if (std::filesystem::is_directory(*it) && !std::filesystem::is_symlink(*it)) {
-            std::string subdirPath = it->path().string();
-            ++it;
-            removeEmptyDirectories(subdirPath);
-            if (std::filesystem::is_empty(subdirPath)) {
-                std::filesystem::remove(subdirPath);
+bool BackupTask::backupEncryptedFile(const FileEntry& file, const std::string& backupFile, KeyCache& keys,
+                                     std::string& encryptedFile) {
+    std::string source = file.getFilePath().string();
+    bool done = false;
+    
+    bool worthCompressing = compressEnabled && FileSystem::isWorthCompressing(source, codec);
+    if (compressEnabled && !worthCompressing) {
+        compressionStats.record(CompressResult::Skipped, file.getFileSize());
+    }
+    if (worthCompressing) {
+        encryptedFile = backupFile + Codec::extensionOf(codec) + ".enc";
+        uint64_t compressedSize = 0;
+        if (compressIntoEncryptedFile(source, encryptedFile, codec, keys, compressedSize) &&
+            compressedSize < file.getFileSize()) {
+            compressionStats.record(CompressResult::Compressed, file.getFileSize());
+            done = true;
+        } else {
+            // 压缩后没有变小，改为直接加密原始内容
+            FileSystem::removeFile(encryptedFile);
+        }
+    }
+    
+    if (!done) {
+        encryptedFile = backupFile + ".enc";
+        if (!Encryption::encryptFile(source, encryptedFile, keys)) {
+            return false;
+        }
+    }
+    
+    // 复制源文件的元数据到加密后的文件
+    std::error_code ec;
+    auto fileStatus = std::filesystem::status(source, ec);
+    if (!ec) {
+        auto fileTime = std::filesystem::last_write_time(source, ec);
+        if (!ec) {
+            std::filesystem::last_write_time(encryptedFile, fileTime, ec);
+            if (ec) {
+                logger->warn("Failed to copy file time to encrypted file: " + encryptedFile);
+            }
+        }
+        
+        std::filesystem::permissions(encryptedFile, fileStatus.permissions(), ec);
+        if (ec) {
+            logger->warn("Failed to copy permissions to encrypted file: " + encryptedFile);
+        }
+    }
+    return true;
+}
+
+bool BackupTask::backupToPackage() {
+    std::string packagePath = (std::filesystem::path(backupPath) / packageFileName).string();
+    if (!password.empty()) {
+        packagePath += ".enc";
+    }
+    logger->info("Packaging backup files into a single file: " + packagePath);
+    
+    // 包直接写入最终文件，加密时经过加密流，磁盘上不出现未加密的包
+    KeyCache keys(password);
+    std::ofstream plainFile;
+    EncryptingStreamBuf encrypted;
+    std::ostream out(nullptr);
+    if (password.empty()) {
+        plainFile.open(packagePath, std::ios::binary);
+        if (plainFile) {
+            out.rdbuf(plainFile.rdbuf());
+        }
+    } else if (encrypted.open(packagePath, keys)) {
+        out.rdbuf(&encrypted);
+    }
+    if (!out.rdbuf()) {
+        logger->error("Failed to create package file: " + packagePath);
+        status = TaskStatus::FAILED;
+        return false;
+    }
+    
+    // 失败或中断时删除不完整的包
+    auto abort = [&](TaskStatus result) {
+        plainFile.close();
+        encrypted.close();
+        FileSystem::removeFile(packagePath);
+        status = result;
+        return false;
+    };
+    
+    PackageWriter writer(out);
+    
+    // 扫描到的条目直接写入包，扫描与写包重叠进行
+    size_t matchedCount = 0;
+    bool cancelled = false;
+    bool completed = FileSystem::streamDirectory(sourcePath, [&](const FileEntry& file) {
+        if (!passesFilters(file)) {
+            return true;
+        }
+        ++matchedCount;
+        // 检查是否被中断
+        if (isInterrupted()) {
+            cancelled = true;
+            return false;
+        }
+        
+        std::string source = file.getFilePath().string();
+        std::string entryName = file.getRelativePath(std::filesystem::path(sourcePath)).string();
+        bool added;
+        bool compress = compressEnabled && file.isRegularFile();
+        if (compress && FileSystem::isWorthCompressing(source, codec)) {
+            // 流式写入无法回退，是否压缩只由采样估计决定
+            uint64_t compressedSize = 0;
+            added = writer.addCompressedFile(file.toFile(), entryName, codec, compressedSize);
+            if (added && compressedSize < file.getFileSize()) {
+                compressionStats.record(CompressResult::Compressed, file.getFileSize());
             }
         } else {
-            ++it;
+            if (compress) {
+                compressionStats.record(CompressResult::Skipped, file.getFileSize());
+            }
+            added = writer.addFile(file.toFile(), entryName);
+        }
+        
+        if (!added) {
+            logger->error("Failed to add file to package: " + source);
         }
+        return added;
+    }, 0, descendFilter());
+    
+    if (cancelled) {
+        logger->info("Backup interrupted.");
+        return abort(TaskStatus::CANCELLED);
+    }
+    if (!completed) {
+        return abort(TaskStatus::FAILED);
+    }
+    if (matchedCount == 0) {
+        // 没有需要备份的文件，不留下空包
+        logger->warn("No files found to backup");
+        abort(TaskStatus::COMPLETED);
+        return true;
+    }
+    
+    reportSkippedCompression();
+    
+    if (!writer.finish()) {
+        logger->error("Failed to write package metadata: " + packagePath);
+        return abort(TaskStatus::FAILED);
     }
-}
\ No newline at end of file
+    bool closed = password.empty() ? (plainFile.close(), static_cast<bool>(plainFile)) : encrypted.close();
+    if (!closed) {
+        logger->error("Failed to write package file: " + packagePath);
+        FileSystem::removeFile(packagePath);
+        status = TaskStatus::FAILED;
+        return false;
+    }
+    
+    logger->info("Backup files packaged successfully: " + packagePath + " (" +
+                 std::to_string(writer.getEntryCount()) + " entries)");
+    logger->info("Backup completed!");
+    status = TaskStatus::COMPLETED;
+    return true;
+}
+
+void BackupTask::reportSkippedCompression() {
+    // 报告因不可压缩而跳过编码的文件
+    if (!compressEnabled) {
+        return;
+    }
+    if (compressionStats.skippedFiles > 0) {
+        logger->info("Skipped compression for " + std::to_string(compressionStats.skippedFiles) +
+                     " incompressible files (" + std::to_string(compressionStats.skippedBytes) + " bytes)");
+    }
+}
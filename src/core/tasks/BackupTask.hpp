@@ -3,19 +3,42 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <functional>
+#include <filesystem>
 #include "../Types.hpp"
 #include "../Filter.hpp"
+#include "../models/FileCatalog.hpp"
 #include "../../utils/ILogger.hpp"
+#include "../../utils/Codec.hpp"
 
 class FileSystem; // 前向声明
+class KeyCache;
 
 class BackupTask {
 private:
     std::string sourcePath;
     std::string backupPath;
     
-    // 删除空目录的辅助方法
-    void removeEmptyDirectories(const std::string& path);
+    // 打包模式：源文件直接流式写入包（需要时经过加密流），不生成逐个文件的临时副本
+    bool backupToPackage();
+    
+    // 条目是否通过所有过滤器
+    bool passesFilters(const FileEntry& file) const;
+    
+    // 遍历时的子树剪枝条件：任一过滤器排除整个目录时不再进入，没有过滤器时为空
+    std::function<bool(const std::filesystem::path&)> descendFilter() const;
+    
+    // 复制（按需压缩、加密）一个非目录条目，失败时记录错误并设置状态
+    // 需要复制后再加密的文件路径追加到backedUpFiles
+    bool backupEntry(const FileEntry& file, KeyCache& keys, std::vector<std::string>& backedUpFiles);
+    
+    // 报告本次因不可压缩而跳过编码的文件
+    void reportSkippedCompression();
+    
+    // 单遍读取源文件，按需压缩后直接加密写出，不生成未加密的中间文件；
+    // encryptedFile返回实际写出的路径（backupFile + [压缩扩展名] + ".enc"）
+    bool backupEncryptedFile(const FileEntry& file, const std::string& backupFile, KeyCache& keys,
+                             std::string& encryptedFile);
     
     // 当前任务状态
     TaskStatus status;
@@ -25,6 +48,10 @@ private:
     std::vector<std::shared_ptr<Filter>> filters;
     // 压缩开关
     bool compressEnabled;
+    // 压缩算法
+    CodecId codec;
+    // 本次执行的压缩统计
+    CompressionStats compressionStats;
     // 拼接开关
     bool packageEnabled;
     // 包文件名
@@ -39,7 +66,8 @@ public:
               const std::vector<std::shared_ptr<Filter>>& filterList = {}, bool compress = true, 
               bool package = false, const std::string& pkgFileName = "backup.pkg",
               const std::string& pass = "",
-              std::atomic<bool>* interruptFlag = nullptr);
+              std::atomic<bool>* interruptFlag = nullptr,
+              CodecId codecId = CodecId::Huffman);
     bool execute();
     TaskStatus getStatus() const;
     // 检查是否被中断
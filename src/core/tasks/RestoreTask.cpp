@@ -2,6 +2,8 @@
 #include "../../utils/FileSystem.hpp"
 #include "../../utils/FilePackager.hpp"
 #include "../../utils/Encryption.hpp"
+#include "../../utils/EncryptedStream.hpp"
+#include "../../utils/Codec.hpp"
 #include <filesystem>
 #include <atomic>
 
@@ -43,39 +45,39 @@ bool RestoreTask::execute() {
     }
     
     // 获取备份文件列表
-    auto files = FileSystem::getAllFiles(backupPath);
+    FileCatalog files = FileSystem::scanDirectory(backupPath);
     logger->info("Found " + std::to_string(files.size()) + " files to restore");
     
-    // 应用过滤器
-    std::vector<File> filteredFiles;
-    for (const auto& file : files) {
-        bool passAllFilters = true;
-        for (const auto& filter : filters) {
-            if (!filter->match(file)) {
-                passAllFilters = false;
-                break;
+    // 应用过滤器，只保留通过的条目的下标
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < files.size(); ++i) {
+        // 如果启用了打包功能，只保留打包文件或打包文件的加密版本；
+        // 过滤器在解包时作用于包中的条目，只解出匹配的条目
+        if (packageEnabled) {
+            std::string fileName = files[i].getFilePath().filename().string();
+            if (fileName == packageFileName || fileName == (packageFileName + ".enc")) {
+                selected.push_back(i);
             }
+            continue;
         }
-        if (passAllFilters) {
-            // 过滤掉非当前备份生成的.enc文件
-            std::string filePath = file.getFilePath().string();
-            std::filesystem::path backupFile(filePath);
-            std::string fileName = backupFile.filename().string();
-            
-            // 如果启用了打包功能，只保留打包文件或打包文件的加密版本
-            if (packageEnabled) {
-                if (fileName == packageFileName || fileName == (packageFileName + ".enc")) {
-                    filteredFiles.push_back(file);
+        
+        bool passAllFilters = true;
+        if (!filters.empty()) {
+            File file = files[i].toFile();
+            for (const auto& filter : filters) {
+                if (!filter->match(file)) {
+                    passAllFilters = false;
+                    break;
                 }
-            } else {
-                // 如果未启用打包功能，保留所有文件
-                filteredFiles.push_back(file);
             }
         }
+        if (passAllFilters) {
+            selected.push_back(i);
+        }
     }
+    files.reorder(selected);
     
-    logger->info("After filtering, " + std::to_string(filteredFiles.size()) + " files will be restored");
-    files = filteredFiles;
+    logger->info("After filtering, " + std::to_string(files.size()) + " files will be restored");
     
     if (files.empty()) {
         logger->info("No files found to restore");
@@ -84,8 +86,11 @@ bool RestoreTask::execute() {
     }
     
     int successCount = 0;
+    // 同一作业的加密文件共用盐值，按盐值缓存主密钥，每次还原只派生一次
+    KeyCache keys(password);
     
-    for (const auto& backupFile : files) {
+    for (size_t fileIndex = 0; fileIndex < files.size(); ++fileIndex) {
+        FileEntry backupFile = files[fileIndex];
         // 检查是否被中断
         if (isInterrupted()) {
             logger->info("Restore interrupted.");
@@ -113,6 +118,8 @@ bool RestoreTask::execute() {
         bool isEncrypted = false;
         bool isCompressed = false;
         bool isPackaged = false;
+        // 分段加密的打包文件在解包时按需解密，不生成临时文件
+        std::unique_ptr<DecryptingStreamBuf> decryptedPackage;
         
         // 先检查文件是否加密
         if (backupFilePath.size() > 4 && backupFilePath.substr(backupFilePath.size() - 4) == ".enc") {
@@ -134,45 +141,55 @@ bool RestoreTask::execute() {
                     return false;
                 }
                 
-                // 尝试解密
-                logger->info("Decrypting file: " + backupFilePath);
+                if (isPackagedEncrypted && Encryption::isSegmentedFile(backupFilePath)) {
+                    logger->info("Decrypting package on demand: " + backupFilePath);
+                    decryptedPackage.reset(new DecryptingStreamBuf());
+                    if (!decryptedPackage->open(backupFilePath, keys)) {
+                        logger->error("Decryption failed: " + backupFilePath + " (wrong password?)");
+                        status = TaskStatus::FAILED;
+                        return false;
+                    }
+                } else {
+                    // 尝试解密
+                    logger->info("Decrypting file: " + backupFilePath);
                 
-                // 保存原始加密文件的元数据
-                std::error_code ec;
-                auto originalFileTime = std::filesystem::last_write_time(backupFilePath, ec);
-                auto originalPermissions = std::filesystem::status(backupFilePath, ec).permissions();
+                    // 保存原始加密文件的元数据
+                    std::error_code ec;
+                    auto originalFileTime = std::filesystem::last_write_time(backupFilePath, ec);
+                    auto originalPermissions = std::filesystem::status(backupFilePath, ec).permissions();
                 
-                // 创建临时解密文件
-                tempFile = backupFilePath + ".tmp";
-                needCleanup = true;
+                    // 创建临时解密文件
+                    tempFile = backupFilePath + ".tmp";
+                    needCleanup = true;
                 
-                if (!Encryption::decryptFile(backupFilePath, tempFile, password)) {
-                    logger->error("Decryption failed: " + backupFilePath + " (wrong password?)");
-                    status = TaskStatus::FAILED;
-                    // 清理临时文件
-                    if (needCleanup) {
-                        std::filesystem::remove(tempFile);
+                    if (!Encryption::decryptFile(backupFilePath, tempFile, keys)) {
+                        logger->error("Decryption failed: " + backupFilePath + " (wrong password?)");
+                        status = TaskStatus::FAILED;
+                        // 清理临时文件
+                        if (needCleanup) {
+                            std::filesystem::remove(tempFile);
+                        }
+                        return false;
                     }
-                    return false;
-                }
                 
-                // 将原始加密文件的元数据复制到临时解密文件
-                if (!ec) {
-                    std::filesystem::last_write_time(tempFile, originalFileTime, ec);
-                    if (ec) {
-                        logger->warn("Failed to copy file time to decrypted temp file: " + tempFile);
-                    }
+                    // 将原始加密文件的元数据复制到临时解密文件
+                    if (!ec) {
+                        std::filesystem::last_write_time(tempFile, originalFileTime, ec);
+                        if (ec) {
+                            logger->warn("Failed to copy file time to decrypted temp file: " + tempFile);
+                        }
                     
-                    std::filesystem::permissions(tempFile, originalPermissions, ec);
-                    if (ec) {
-                        logger->warn("Failed to copy permissions to decrypted temp file: " + tempFile);
+                        std::filesystem::permissions(tempFile, originalPermissions, ec);
+                        if (ec) {
+                            logger->warn("Failed to copy permissions to decrypted temp file: " + tempFile);
+                        }
                     }
-                }
                 
-                currentSource = tempFile;
-                // 去掉目标文件的.enc扩展名
-                if (currentDest.size() > 4) {
-                    currentDest = currentDest.substr(0, currentDest.size() - 4);
+                    currentSource = tempFile;
+                    // 去掉目标文件的.enc扩展名
+                    if (currentDest.size() > 4) {
+                        currentDest = currentDest.substr(0, currentDest.size() - 4);
+                    }
                 }
             } else {
                 // 不是加密的打包文件，不需要解密
@@ -181,9 +198,6 @@ bool RestoreTask::execute() {
         }
         
         // 2. 检查是否需要解包
-        std::string tempUnpackDir;
-        bool unpacked = false;
-        
         if (packageEnabled) {
             // 检查当前源文件是否是打包文件
             // 处理以下情况：
@@ -198,12 +212,25 @@ bool RestoreTask::execute() {
                 (isEncrypted && (fileName == (packageFileName + ".enc.tmp")))) {
                 logger->info("Unpacking file: " + currentSource);
                 
-                // 创建临时解包目录
-                tempUnpackDir = backupPath + "/temp_unpack";
+                if (isInterrupted()) {
+                    logger->info("Restore interrupted.");
+                    status = TaskStatus::CANCELLED;
+                    if (needCleanup) {
+                        std::filesystem::remove(tempFile);
+                    }
+                    return false;
+                }
                 
-                // 创建FilePackager实例并执行解包
+                // 只读取包的索引，然后把匹配过滤器的条目直接解出到还原目录：
+                // 压缩条目从包中的数据直接解压，权限和时间戳按索引中的元数据恢复
                 FilePackager packager;
-                if (!packager.unpackFiles(currentSource, tempUnpackDir)) {
+                std::istream packageStream(decryptedPackage.get());
+                bool indexLoaded = decryptedPackage ? packager.loadIndex(packageStream)
+                                                    : packager.loadIndex(currentSource);
+                std::vector<std::string> extractedEntries;
+                bool unpackOk = indexLoaded &&
+                                packager.extractMatching(filters, restorePath, extractedEntries, compressEnabled);
+                if (!unpackOk) {
                     logger->error("Failed to unpack backup files");
                     status = TaskStatus::FAILED;
                     // 清理临时文件
@@ -213,113 +240,16 @@ bool RestoreTask::execute() {
                     return false;
                 }
                 
-                unpacked = true;
-                
-                // 获取解包后的所有文件并逐个处理
-                auto unpackedFiles = FileSystem::getAllFiles(tempUnpackDir);
-                
-                for (const auto& unpackedFile : unpackedFiles) {
-                    // 检查是否被中断
-                    if (isInterrupted()) {
-                        logger->info("Restore interrupted.");
-                        status = TaskStatus::CANCELLED;
-                        // 清理临时文件和目录
-                        std::filesystem::remove_all(tempUnpackDir);
-                        if (needCleanup) {
-                            std::filesystem::remove(tempFile);
-                        }
-                        return false;
-                    }
-                    
-                    std::string unpackedFilePath = unpackedFile.getFilePath().string();
-                    std::string unpackedRelativePath = unpackedFile.getRelativePath(std::filesystem::path(tempUnpackDir)).string();
-                    std::string unpackedRestoreFile = (std::filesystem::path(restorePath) / unpackedRelativePath).string();
-                    
-                    // 确保目标目录存在
-                    if (!FileSystem::createDirectories(
-                            std::filesystem::path(unpackedRestoreFile).parent_path().string())) {
-                        logger->error("Failed to create restore directory: " + unpackedRestoreFile);
-                        status = TaskStatus::FAILED;
-                        // 清理临时文件和目录
-                        std::filesystem::remove_all(tempUnpackDir);
-                        if (needCleanup) {
-                            std::filesystem::remove(tempFile);
-                        }
-                        return false;
-                    }
-                    
-                    bool unpackedSuccess = false;
-                    
-                    // 检查是否是符号链接
-                    bool isSymlink = std::filesystem::is_symlink(unpackedFilePath);
-                    
-                    if (isSymlink) {
-                        // 直接使用FileSystem::copyFile处理符号链接，确保正确还原
-                        unpackedSuccess = FileSystem::copyFile(unpackedFilePath, unpackedRestoreFile);
-                    } else if (compressEnabled) {
-                        // 检查是否需要解压
-                        if ((unpackedFilePath.size() > 5 && unpackedFilePath.substr(unpackedFilePath.size() - 5) == ".huff")) {
-                            logger->info("Decompressing file: " + unpackedFilePath);
-                            
-                            // 去掉目标文件的.huff扩展名
-                            std::string finalDest = unpackedRestoreFile;
-                            if (finalDest.size() > 5 && finalDest.substr(finalDest.size() - 5) == ".huff") {
-                                finalDest = finalDest.substr(0, finalDest.size() - 5);
-                            }
-                            
-                            // 保存解包后压缩文件的元数据（这些是从打包文件中恢复的原始文件元数据）
-                            std::error_code ec;
-                            auto originalFileTime = std::filesystem::last_write_time(unpackedFilePath, ec);
-                            auto originalPermissions = std::filesystem::status(unpackedFilePath, ec).permissions();
-                            
-                            // 使用decompressFile而不是decompressAndCopyFile，确保元数据不被覆盖
-                            if (FileSystem::decompressFile(unpackedFilePath, finalDest)) {
-                                unpackedSuccess = true;
-                                
-                                // 确保解压后的文件具有正确的元数据（从打包文件中恢复的原始元数据）
-                                if (!ec) {
-                                    std::filesystem::last_write_time(finalDest, originalFileTime, ec);
-                                    if (ec) {
-                                        logger->warn("Failed to copy original file time to decompressed file: " + finalDest);
-                                    }
-                                    
-                                    std::filesystem::permissions(finalDest, originalPermissions, ec);
-                                    if (ec) {
-                                        logger->warn("Failed to copy original permissions to decompressed file: " + finalDest);
-                                    }
-                                }
-                            } else {
-                                unpackedSuccess = false;
-                            }
-                        } else {
-                            // 普通复制
-                            unpackedSuccess = FileSystem::copyFile(unpackedFilePath, unpackedRestoreFile);
-                        }
-                    } else {
-                        // 不压缩，直接复制
-                        unpackedSuccess = FileSystem::copyFile(unpackedFilePath, unpackedRestoreFile);
-                    }
-                    
-                     if (unpackedSuccess) {
-                        logger->info("Restored: " + 
-                                    ((compressEnabled && (unpackedFilePath.size() > 5 && unpackedFilePath.substr(unpackedFilePath.size() - 5) == ".huff")) ? 
-                                    (unpackedRestoreFile.size() > 5 ? unpackedRestoreFile.substr(0, unpackedRestoreFile.size() - 5) : unpackedRestoreFile) : 
-                                    unpackedRestoreFile));
-                        successCount++;
-                    } else {
-                        logger->error("Failed to restore unpacked file: " + unpackedFilePath);
-                        status = TaskStatus::FAILED;
-                        // 清理临时文件和目录
-                        std::filesystem::remove_all(tempUnpackDir);
-                        if (needCleanup) {
-                            std::filesystem::remove(tempFile);
-                        }
-                        return false;
-                    }
+                logger->info("Extracted " + std::to_string(extractedEntries.size()) + " of " +
+                             std::to_string(packager.getEntryCount()) + " package entries");
+                FileMetadata entry;
+                for (const auto& entryName : extractedEntries) {
+                    std::string restoredFile = (std::filesystem::path(restorePath) / entryName).string();
+                    bool decompressed = compressEnabled && packager.findEntry(entryName, entry) && entry.isCompressed;
+                    logger->info("Restored: " + (decompressed ? Codec::stripCompressedExtension(restoredFile)
+                                                              : restoredFile));
                 }
-                
-                // 清理临时解包目录
-                std::filesystem::remove_all(tempUnpackDir);
+                successCount += static_cast<int>(extractedEntries.size());
                 
                 // 跳过当前文件的后续处理，因为已经完成解包和还原
                 // 清理临时文件
@@ -332,7 +262,6 @@ bool RestoreTask::execute() {
         
         // 3. 处理符号链接和压缩文件
         std::filesystem::path sourcePath(currentSource);
-        std::filesystem::path originalPath(backupFilePath);
         
         // 检查是否是符号链接
         bool isSymlink = std::filesystem::is_symlink(sourcePath);
@@ -356,25 +285,16 @@ bool RestoreTask::execute() {
             bool shouldDecompress = false;
             
             if (compressEnabled) {
-                // 如果当前文件是.huff格式，直接解压
-                if (sourcePath.extension().string() == ".huff") {
-                    shouldDecompress = true;
-                }
-                // 如果原始文件是.huff.enc格式（加密压缩），解密后也需要解压
-                else if (originalPath.extension().string() == ".enc" && 
-                         originalPath.stem().extension().string() == ".huff") {
-                    shouldDecompress = true;
-                }
+                // 带压缩扩展名（.huff、.lz，加密文件为去掉.enc后的名称）且内容以压缩文件头开头时才解压；
+                // 不值得压缩而直接存储的文件和用户自己的notes.lz按原样还原
+                shouldDecompress = Codec::isCompressedFile(currentSource, currentDest);
             }
             
             if (shouldDecompress) {
                 logger->info("Decompressing file: " + currentSource);
                 
-                // 去掉目标文件的.huff扩展名
-                std::string finalDest = currentDest;
-                if (finalDest.size() > 5 && finalDest.substr(finalDest.size() - 5) == ".huff") {
-                    finalDest = finalDest.substr(0, finalDest.size() - 5);
-                }
+                // 去掉目标文件的压缩扩展名
+                std::string finalDest = Codec::stripCompressedExtension(currentDest);
                 
                 if (FileSystem::decompressAndCopyFile(currentSource, finalDest)) {
                     logger->info("Restored: " + finalDest);
@@ -63,6 +63,7 @@ struct AppConfig {
     bool packageEnabled = true;   // 拼接开关，默认为关闭
     std::string packageFileName = "backup.pkg"; // 拼接后的文件名
     std::string password; // 加密/解密密码
+    CodecId codec = CodecId::Huffman; // 压缩算法
 };
 
 // 用户界面抽象接口
@@ -241,7 +242,8 @@ public:
         }
         
         bool success = BackupEngine::backup(config.sourceDir, config.backupDir, &logger, filters, config.compressEnabled, 
-                                           config.packageEnabled, config.packageFileName, config.password);
+                                           config.packageEnabled, config.packageFileName, config.password,
+                                           nullptr, config.codec);
         
         if (success) {
             logger.info("Backup operation completed successfully.");
@@ -377,6 +379,7 @@ public:
         rtConfig.compressEnabled = config.compressEnabled;
         rtConfig.packageEnabled = config.packageEnabled;
         rtConfig.packageFileName = config.packageFileName;
+        rtConfig.codec = config.codec;
         rtConfig.password = config.password;
         rtConfig.debounceTimeMs = 1000; // 降低防抖时间到1秒，提高灵敏度
         
@@ -424,6 +427,7 @@ public:
         tbConfig.compressEnabled = config.compressEnabled;
         tbConfig.packageEnabled = config.packageEnabled;
         tbConfig.packageFileName = config.packageFileName;
+        tbConfig.codec = config.codec;
         tbConfig.password = config.password;
         tbConfig.intervalSeconds = intervalSeconds;
         
@@ -556,6 +560,7 @@ public:
             tbConfig.compressEnabled = config.compressEnabled;
             tbConfig.packageEnabled = config.packageEnabled;
             tbConfig.packageFileName = config.packageFileName;
+            tbConfig.codec = config.codec;
             tbConfig.password = config.password;
             tbConfig.intervalSeconds = timerBackupManager->getConfig().intervalSeconds; // 保留当前间隔
             
@@ -736,6 +741,7 @@ public:
         std::cout << "  --backup <path> Set backup directory path\n";
         std::cout << "  --compress      Enable compression for backup\n";
         std::cout << "  --no-compress   Disable compression for backup\n";
+        std::cout << "  --codec <name>  Compression codec: huffman (default) or lz (faster, better on logs/source)\n";
         std::cout << "  --package       Enable file packaging\n";
         std::cout << "  --no-package    Disable file packaging\n";
         std::cout << "  --package-name  Set package file name (default: backup.pkg)\n";
@@ -747,6 +753,7 @@ public:
         std::cout << "  BackupHelper --backup ./backup -r Execute restore operation to specified backup directory\n";
         std::cout << "  BackupHelper --compress -b        Execute backup with compression enabled\n";
         std::cout << "  BackupHelper --no-compress -b     Execute backup with compression disabled\n";
+        std::cout << "  BackupHelper --compress --codec lz -b Execute backup with the fast LZ codec\n";
         std::cout << "  BackupHelper --package -b         Execute backup with file packaging enabled\n";
         std::cout << "  BackupHelper --compress --package -b Execute backup with both compression and packaging enabled\n";
         std::cout << "  BackupHelper --package-name mybackup.pkg -b Execute backup with custom package name\n";
@@ -1197,6 +1204,11 @@ private:
                 config.packageEnabled = true;
             } else if (args[i] == "--no-package") {
                 config.packageEnabled = false;
+            } else if (args[i] == "--codec" && i + 1 < args.size()) {
+                if (!Codec::fromName(args[++i], config.codec)) {
+                    std::cerr << "Unknown codec: " << args[i] << " (expected huffman or lz)" << std::endl;
+                    return false;
+                }
             } else if (args[i] == "--package-name" && i + 1 < args.size()) {
                 config.packageFileName = args[++i];
             } else if (args[i] == "--password" && i + 1 < args.size()) {
@@ -0,0 +1,185 @@
+#include "ByteHistogram.hpp"
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define BYTE_HISTOGRAM_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 交错计数表的数量：连续的字节落在不同的表上，相同字节连续出现时不会串行等待同一个计数器
+constexpr size_t TABLE_COUNT = 4;
+
+// 每轮最多处理的字节数，保证32位计数器不会溢出
+constexpr size_t ROUND_SIZE = size_t(1) << 30;
+
+struct CountTables {
+    uint32_t bins[TABLE_COUNT][256];
+
+    CountTables() { std::memset(bins, 0, sizeof(bins)); }
+
+    // 把8个字节分散到各张表
+    inline void add8(uint64_t word) {
+        bins[0][word & 0xFF]++;
+        bins[1][(word >> 8) & 0xFF]++;
+        bins[2][(word >> 16) & 0xFF]++;
+        bins[3][(word >> 24) & 0xFF]++;
+        bins[0][(word >> 32) & 0xFF]++;
+        bins[1][(word >> 40) & 0xFF]++;
+        bins[2][(word >> 48) & 0xFF]++;
+        bins[3][word >> 56]++;
+    }
+
+    // 合并各张表并累加到结果
+    void mergeInto(uint64_t counts[256]) const {
+        for (int symbol = 0; symbol < 256; ++symbol) {
+            uint64_t total = 0;
+            for (size_t t = 0; t < TABLE_COUNT; ++t) {
+                total += bins[t][symbol];
+            }
+            counts[symbol] += total;
+        }
+    }
+};
+
+// 处理不足一个字的尾部
+inline void countTail(CountTables& tables, const unsigned char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        tables.bins[i % TABLE_COUNT][data[i]]++;
+    }
+}
+
+inline uint64_t loadWord(const unsigned char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+// 标量实现：每次读取8个字节
+void countRoundScalar(const unsigned char* data, size_t size, CountTables& tables) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        tables.add8(loadWord(data + i));
+        tables.add8(loadWord(data + i + 8));
+    }
+    for (; i + 8 <= size; i += 8) {
+        tables.add8(loadWord(data + i));
+    }
+    countTail(tables, data + i, size - i);
+}
+
+#ifdef BYTE_HISTOGRAM_X86
+
+// SSE2实现：每次载入16个字节，整段都是同一个字节（如文件中的零填充区）时直接累加
+__attribute__((target("sse2")))
+void countRoundSse2(const unsigned char* data, size_t size, CountTables& tables) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i first = _mm_set1_epi8(static_cast<char>(data[i]));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, first)) == 0xFFFF) {
+            tables.bins[0][data[i]] += 16;
+            continue;
+        }
+        tables.add8(static_cast<uint64_t>(_mm_cvtsi128_si64(block)));
+        tables.add8(static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(block, block))));
+    }
+    countRoundScalar(data + i, size - i, tables);
+}
+
+// AVX2实现：每次载入32个字节，同样跳过单一字节的整段
+__attribute__((target("avx2")))
+void countRoundAvx2(const unsigned char* data, size_t size, CountTables& tables) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i first = _mm256_set1_epi8(static_cast<char>(data[i]));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, first)) == -1) {
+            tables.bins[0][data[i]] += 32;
+            continue;
+        }
+        __m128i low = _mm256_castsi256_si128(block);
+        __m128i high = _mm256_extracti128_si256(block, 1);
+        tables.add8(static_cast<uint64_t>(_mm_cvtsi128_si64(low)));
+        tables.add8(static_cast<uint64_t>(_mm_extract_epi64(low, 1)));
+        tables.add8(static_cast<uint64_t>(_mm_cvtsi128_si64(high)));
+        tables.add8(static_cast<uint64_t>(_mm_extract_epi64(high, 1)));
+    }
+    countRoundScalar(data + i, size - i, tables);
+}
+
+#endif
+
+using CountRoundFunction = void (*)(const unsigned char*, size_t, CountTables&);
+
+struct Implementation {
+    CountRoundFunction function;
+    const char* name;
+};
+
+// 运行时检测CPU特性，只在第一次调用时执行
+const Implementation& selectImplementation() {
+    static const Implementation selected = [] {
+#ifdef BYTE_HISTOGRAM_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Implementation{countRoundAvx2, "avx2"};
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return Implementation{countRoundSse2, "sse2"};
+        }
+#endif
+        return Implementation{countRoundScalar, "scalar"};
+    }();
+    return selected;
+}
+
+void countWith(CountRoundFunction function, const unsigned char* data, size_t size, uint64_t counts[256]) {
+    while (size > 0) {
+        size_t round = std::min(size, ROUND_SIZE);
+        CountTables tables;
+        function(data, round, tables);
+        tables.mergeInto(counts);
+        data += round;
+        size -= round;
+    }
+}
+
+} // namespace
+
+namespace ByteHistogram {
+
+void count(const unsigned char* data, size_t size, uint64_t counts[256]) {
+    countWith(selectImplementation().function, data, size, counts);
+}
+
+double entropy(const uint64_t counts[256]) {
+    uint64_t total = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        total += counts[symbol];
+    }
+    if (total == 0) {
+        return 0.0;
+    }
+    double bits = 0.0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        if (counts[symbol] > 0) {
+            double p = static_cast<double>(counts[symbol]) / static_cast<double>(total);
+            bits -= p * std::log2(p);
+        }
+    }
+    return bits;
+}
+
+const char* implementationName() {
+    return selectImplementation().name;
+}
+
+void countScalar(const unsigned char* data, size_t size, uint64_t counts[256]) {
+    countWith(countRoundScalar, data, size, counts);
+}
+
+} // namespace ByteHistogram
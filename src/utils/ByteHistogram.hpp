@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 字节频率统计
+// 使用多张交错的计数表消除相邻字节相同时的写后读依赖，
+// 并在运行时根据CPU支持情况选择AVX2/SSE2实现，其他平台使用标量实现
+namespace ByteHistogram {
+
+// 统计data中每个字节值出现的次数，结果累加到counts
+void count(const unsigned char* data, size_t size, uint64_t counts[256]);
+
+// 按频率计算的香农熵（每字节的位数，0~8），计数全为0时返回0
+double entropy(const uint64_t counts[256]);
+
+// 当前选用的实现名称（"avx2"、"sse2"或"scalar"），用于基准测试输出
+const char* implementationName();
+
+// 标量实现，供测试与SIMD实现对照
+void countScalar(const unsigned char* data, size_t size, uint64_t counts[256]);
+
+} // namespace ByteHistogram
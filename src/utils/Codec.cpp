@@ -0,0 +1,235 @@
+#include "Codec.hpp"
+#include "HuffmanCompressor.hpp"
+#include "LzCompressor.hpp"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+    // 算法文件头："BKCD" + 版本号 + 算法编号
+    constexpr char CODEC_MAGIC[4] = {'B', 'K', 'C', 'D'};
+    constexpr int CODEC_VERSION = 1;
+    // 不经过Codec直接写出的Huffman v2文件头
+    constexpr char HUFF_MAGIC[4] = {'B', 'H', 'U', 'F'};
+
+    // 已注册的算法
+    struct CodecInfo {
+        CodecId id;
+        const char* name;
+        const char* extension;
+    };
+
+    constexpr CodecInfo CODECS[] = {
+        {CodecId::Huffman, "huffman", ".huff"},
+        {CodecId::LZ, "lz", ".lz"},
+    };
+
+    const CodecInfo* findCodec(CodecId id) {
+        for (const auto& info : CODECS) {
+            if (info.id == id) {
+                return &info;
+            }
+        }
+        return nullptr;
+    }
+
+    // Huffman算法
+    class HuffmanCodec : public Codec {
+    public:
+        CodecId id() const override { return CodecId::Huffman; }
+        bool isWorthCompressing(const std::string& inputFilePath) const override {
+            return compressor.isWorthCompressing(inputFilePath);
+        }
+        bool compress(std::istream& in, std::ostream& out) override {
+            return compressor.compressStream(in, out);
+        }
+        bool decompress(std::istream& in, std::ostream& out) override {
+            return compressor.decompressStream(in, out);
+        }
+
+    private:
+        HuffmanCompressor compressor;
+    };
+
+    // LZ算法
+    class LzCodec : public Codec {
+    public:
+        CodecId id() const override { return CodecId::LZ; }
+        bool isWorthCompressing(const std::string& inputFilePath) const override {
+            return compressor.isWorthCompressing(inputFilePath);
+        }
+        bool compress(std::istream& in, std::ostream& out) override {
+            return compressor.compressStream(in, out);
+        }
+        bool decompress(std::istream& in, std::ostream& out) override {
+            return compressor.decompressStream(in, out);
+        }
+
+    private:
+        LzCompressor compressor;
+    };
+}
+
+std::unique_ptr<Codec> Codec::create(CodecId id) {
+    switch (id) {
+        case CodecId::Huffman:
+            return std::unique_ptr<Codec>(new HuffmanCodec());
+        case CodecId::LZ:
+            return std::unique_ptr<Codec>(new LzCodec());
+    }
+    return nullptr;
+}
+
+const char* Codec::nameOf(CodecId id) {
+    const CodecInfo* info = findCodec(id);
+    return info ? info->name : "unknown";
+}
+
+bool Codec::fromName(const std::string& name, CodecId& id) {
+    for (const auto& info : CODECS) {
+        if (name == info.name) {
+            id = info.id;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* Codec::extensionOf(CodecId id) {
+    const CodecInfo* info = findCodec(id);
+    return info ? info->extension : "";
+}
+
+bool Codec::hasCompressedExtension(const std::string& path) {
+    return stripCompressedExtension(path).size() != path.size();
+}
+
+std::string Codec::stripCompressedExtension(const std::string& path) {
+    for (const auto& info : CODECS) {
+        size_t length = std::strlen(info.extension);
+        if (path.size() > length && path.compare(path.size() - length, length, info.extension) == 0) {
+            return path.substr(0, path.size() - length);
+        }
+    }
+    return path;
+}
+
+bool Codec::isCompressedFile(const std::string& path, const std::string& name) {
+    const std::string& fileName = name.empty() ? path : name;
+    if (!hasCompressedExtension(fileName)) {
+        return false;
+    }
+    std::ifstream inFile(path, std::ios::binary);
+    char header[sizeof(CODEC_MAGIC) + 2] = {};
+    inFile.read(header, sizeof(header));
+    if (inFile.gcount() < static_cast<std::streamsize>(sizeof(header))) {
+        return false;
+    }
+    if (std::memcmp(header, CODEC_MAGIC, sizeof(CODEC_MAGIC)) == 0) {
+        return header[sizeof(CODEC_MAGIC)] == CODEC_VERSION &&
+               findCodec(static_cast<CodecId>(header[sizeof(CODEC_MAGIC) + 1])) != nullptr;
+    }
+    if (std::memcmp(header, HUFF_MAGIC, sizeof(HUFF_MAGIC)) == 0) {
+        return true;
+    }
+
+    // 旧版.huff：填充位数(0~7) + 字符种类数(不超过256)
+    size_t length = std::strlen(extensionOf(CodecId::Huffman));
+    if (fileName.compare(fileName.size() - std::min(length, fileName.size()), length,
+                         extensionOf(CodecId::Huffman)) != 0) {
+        return false;
+    }
+    uint32_t charCount = 0;
+    std::memcpy(&charCount, header + 1, sizeof(charCount));
+    return static_cast<unsigned char>(header[0]) <= 7 && charCount <= 256;
+}
+
+bool Codec::compressStream(CodecId id, std::istream& in, std::ostream& out) {
+    std::unique_ptr<Codec> codec = create(id);
+    if (!codec) {
+        return false;
+    }
+
+    // 算法文件头
+    out.write(CODEC_MAGIC, sizeof(CODEC_MAGIC));
+    out.put(static_cast<char>(CODEC_VERSION));
+    out.put(static_cast<char>(id));
+
+    return codec->compress(in, out) && static_cast<bool>(out);
+}
+
+bool Codec::compressFile(CodecId id, const std::string& inputFilePath, const std::string& outputFilePath) {
+    if (!create(id)) {
+        return false;
+    }
+    try {
+        std::ifstream inFile(inputFilePath, std::ios::binary);
+        if (!inFile.is_open()) {
+            return false;
+        }
+
+        std::ofstream outFile(outputFilePath, std::ios::binary);
+        if (!outFile.is_open()) {
+            return false;
+        }
+
+        if (!compressStream(id, inFile, outFile)) {
+            outFile.close();
+            return false;
+        }
+
+        outFile.close();
+        return static_cast<bool>(outFile);
+
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
+bool Codec::decompressStream(std::istream& in, std::ostream& out) {
+    // 读取算法文件头；没有文件头的是旧版的Huffman文件，从头开始解压
+    std::unique_ptr<Codec> codec;
+    std::istream::pos_type start = in.tellg();
+    char header[sizeof(CODEC_MAGIC) + 2];
+    in.read(header, sizeof(header));
+    if (in && std::memcmp(header, CODEC_MAGIC, sizeof(CODEC_MAGIC)) == 0) {
+        if (header[sizeof(CODEC_MAGIC)] != CODEC_VERSION) {
+            return false;
+        }
+        codec = create(static_cast<CodecId>(header[sizeof(CODEC_MAGIC) + 1]));
+        if (!codec) {
+            return false;
+        }
+    } else {
+        in.clear();
+        in.seekg(start);
+        codec = create(CodecId::Huffman);
+    }
+
+    return codec->decompress(in, out) && static_cast<bool>(out);
+}
+
+bool Codec::decompressFile(const std::string& inputFilePath, const std::string& outputFilePath) {
+    try {
+        std::ifstream inFile(inputFilePath, std::ios::binary);
+        if (!inFile.is_open()) {
+            return false;
+        }
+
+        std::ofstream outFile(outputFilePath, std::ios::binary);
+        if (!outFile.is_open()) {
+            return false;
+        }
+
+        if (!decompressStream(inFile, outFile)) {
+            outFile.close();
+            return false;
+        }
+
+        outFile.close();
+        return static_cast<bool>(outFile);
+
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <iostream>
+#include <cstdint>
+
+// 压缩算法编号，记录在压缩文件头中
+enum class CodecId : uint8_t {
+    Huffman = 1,  // 分块Huffman编码，适合字节分布偏斜的数据
+    LZ = 2,       // LZ77族字典编码，速度优先，适合重复内容多的源代码和日志
+};
+
+// 单个文件的压缩结果
+enum class CompressResult {
+    Compressed,  // 压缩后变小，保留压缩结果
+    Skipped,     // 采样估计判定为不可压缩，没有编码
+    NotSmaller,  // 编码后没有变小，已丢弃压缩结果
+    Failed,      // 读写或编码失败
+};
+
+// 压缩统计，由每个备份任务自己累计，同时运行的任务互不影响
+struct CompressionStats {
+    uint64_t compressedFiles = 0;   // 压缩后变小并保留压缩文件的文件数
+    uint64_t skippedFiles = 0;      // 熵估计判定为不可压缩、未编码直接存储的文件数
+    uint64_t skippedBytes = 0;      // 上述文件的总字节数
+
+    // 记录一个大小为size字节的文件的压缩结果
+    void record(CompressResult result, uint64_t size) {
+        if (result == CompressResult::Compressed) {
+            ++compressedFiles;
+        } else if (result == CompressResult::Skipped) {
+            ++skippedFiles;
+            skippedBytes += size;
+        }
+    }
+};
+
+// 压缩算法接口
+// FileSystem和RestoreTask通过这里分派到具体算法；
+// 压缩文件以 "BKCD" + 版本号 + 算法编号 开头，解压时按文件头选择算法，
+// 没有该文件头的旧.huff文件按Huffman格式解压
+class Codec {
+public:
+    virtual ~Codec() = default;
+
+    virtual CodecId id() const = 0;
+
+    // 编码前快速判断是否值得压缩
+    virtual bool isWorthCompressing(const std::string& inputFilePath) const = 0;
+
+    // 流式压缩/解压（不含算法文件头）
+    virtual bool compress(std::istream& in, std::ostream& out) = 0;
+    virtual bool decompress(std::istream& in, std::ostream& out) = 0;
+
+    // 创建指定算法的实例，编号未知时返回nullptr
+    static std::unique_ptr<Codec> create(CodecId id);
+
+    // 算法名称（"huffman"、"lz"），用于命令行参数和日志
+    static const char* nameOf(CodecId id);
+    static bool fromName(const std::string& name, CodecId& id);
+
+    // 压缩文件的扩展名（".huff"、".lz"）
+    static const char* extensionOf(CodecId id);
+    // 只按名称判断；不值得压缩而直接存储的文件和用户自己的notes.lz也带这些扩展名，
+    // 判断是否需要解压用isCompressedFile
+    static bool hasCompressedExtension(const std::string& path);
+    static std::string stripCompressedExtension(const std::string& path);
+
+    // path是否是压缩输出：name（为空时用path）带压缩扩展名，且内容以"BKCD"或"BHUF"文件头开头；
+    // 没有文件头的旧.huff文件按v1头部字段（填充位数、字符种类数）判断
+    static bool isCompressedFile(const std::string& path, const std::string& name = "");
+
+    // 写入算法文件头并压缩，输出可以是加密流等任意输出流
+    static bool compressStream(CodecId id, std::istream& in, std::ostream& out);
+
+    // 压缩文件并写入算法文件头
+    static bool compressFile(CodecId id, const std::string& inputFilePath, const std::string& outputFilePath);
+
+    // 按文件头选择算法解压；输入需要可定位（没有文件头的旧Huffman数据要回到起点重新读取），
+    // 可以是包中的一段数据等任意输入流
+    static bool decompressStream(std::istream& in, std::ostream& out);
+
+    // 按文件头选择算法解压
+    static bool decompressFile(const std::string& inputFilePath, const std::string& outputFilePath);
+};
@@ -0,0 +1,342 @@
+#include "DirectoryWalker.hpp"
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <system_error>
+
+#ifdef __linux__
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/syscall.h>
+#endif
+
+namespace {
+    // 判断path是否为ancestor本身或位于其下
+    bool isWithin(const fs::path& path, const fs::path& ancestor) {
+        auto mismatch = std::mismatch(ancestor.begin(), ancestor.end(), path.begin(), path.end());
+        return mismatch.first == ancestor.end();
+    }
+}
+
+DirectoryWalker::DirectoryWalker(size_t threadCount)
+    : threadCount(threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency())),
+      useGetdents(true),
+      pendingDirectories(0),
+      stopping(false),
+      output(nullptr) {
+}
+
+bool DirectoryWalker::prepare(const fs::path& root) {
+    std::error_code ec;
+    if (fs::symlink_status(root, ec).type() != fs::file_type::directory || ec) {
+        return false;
+    }
+    fs::path realRoot = fs::canonical(root, ec);
+    if (ec) {
+        realRoot = root;
+    }
+
+    std::vector<WorkQueue> freshQueues(threadCount);
+    queues.swap(freshQueues);
+    pendingDirectories = 0;
+    stopping = false;
+    pushTask(0, DirectoryTask{root, realRoot, std::string(), false});
+    return true;
+}
+
+FileCatalog DirectoryWalker::walkCatalog(const fs::path& root) {
+    FileCatalog catalog(root);
+    if (!prepare(root)) {
+        return catalog;
+    }
+
+    // 各线程先收集到自己的目录，结束后再合并
+    std::vector<FileCatalog> results(threadCount, FileCatalog(root));
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (size_t i = 1; i < threadCount; ++i) {
+        workers.emplace_back([this, i, &results] { workerLoop(i, results[i]); });
+    }
+    workerLoop(0, results[0]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    size_t total = 0;
+    for (const auto& part : results) {
+        total += part.size();
+    }
+    catalog.reserve(total);
+    for (auto& part : results) {
+        catalog.append(std::move(part));
+    }
+    return catalog;
+}
+
+std::vector<File> DirectoryWalker::walk(const fs::path& root) {
+    FileCatalog catalog = walkCatalog(root);
+    std::vector<File> files;
+    files.reserve(catalog.size());
+    for (size_t i = 0; i < catalog.size(); ++i) {
+        files.push_back(catalog[i].toFile());
+    }
+    return files;
+}
+
+bool DirectoryWalker::stream(const fs::path& root, const EntryCallback& consume, size_t maxBatches) {
+    if (!prepare(root)) {
+        return true;
+    }
+
+    EntryQueue queue;
+    queue.capacity = std::max<size_t>(1, maxBatches);
+    queue.activeProducers = threadCount;
+    output = &queue;
+
+    // 所有遍历线程都在后台运行，调用线程只负责消费
+    std::vector<FileCatalog> results(threadCount, FileCatalog(root));
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back([this, i, &results, &queue] {
+            workerLoop(i, results[i]);
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            --queue.activeProducers;
+            queue.notEmpty.notify_all();
+        });
+    }
+
+    // 中止遍历：唤醒等待队列空位的线程，让它们丢弃手头的条目后退出
+    auto cancel = [this, &queue] {
+        stopping = true;
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.cancelled = true;
+        queue.notFull.notify_all();
+    };
+    auto finish = [this, &workers] {
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        output = nullptr;
+    };
+
+    bool completed = true;
+    try {
+        while (completed) {
+            FileCatalog batch;
+            {
+                std::unique_lock<std::mutex> lock(queue.mutex);
+                queue.notEmpty.wait(lock, [&queue] { return !queue.batches.empty() || queue.activeProducers == 0; });
+                if (queue.batches.empty()) {
+                    break;
+                }
+                batch = std::move(queue.batches.front());
+                queue.batches.pop_front();
+            }
+            queue.notFull.notify_one();
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (!consume(batch[i])) {
+                    completed = false;
+                    break;
+                }
+            }
+        }
+    } catch (...) {
+        cancel();
+        finish();
+        throw;
+    }
+    if (!completed) {
+        cancel();
+    }
+    finish();
+    return completed;
+}
+
+void DirectoryWalker::flushResults(FileCatalog& results) {
+    FileCatalog batch(results.getRoot());
+    batch.append(std::move(results));
+    std::unique_lock<std::mutex> lock(output->mutex);
+    output->notFull.wait(lock, [this] { return output->batches.size() < output->capacity || output->cancelled; });
+    if (!output->cancelled) {
+        output->batches.push_back(std::move(batch));
+        output->notEmpty.notify_one();
+    }
+}
+
+void DirectoryWalker::workerLoop(size_t self, FileCatalog& results) {
+    DirectoryTask task;
+    while (!stopping) {
+        if (takeTask(self, task)) {
+            scanDirectory(self, task, results);
+            if (output && results.size() >= STREAM_BATCH_SIZE) {
+                flushResults(results);
+            }
+            // 子目录已在扫描时入队，最后一个目录扫描完后唤醒所有空闲线程退出
+            if (--pendingDirectories == 0) {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                idleCondition.notify_all();
+            }
+            continue;
+        }
+        // 暂时没有目录可处理，先把手头不满一批的条目交给消费者，避免消费者空等
+        if (output && !results.empty()) {
+            flushResults(results);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idleMutex);
+        if (pendingDirectories == 0) {
+            break;
+        }
+        // 有目录正在扫描但暂时没有可窃取的，短暂等待后重试
+        idleCondition.wait_for(lock, std::chrono::milliseconds(1));
+    }
+    if (output && !results.empty()) {
+        flushResults(results);
+    }
+}
+
+bool DirectoryWalker::takeTask(size_t self, DirectoryTask& task) {
+    {
+        WorkQueue& own = queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < threadCount; ++offset) {
+        WorkQueue& victim = queues[(self + offset) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void DirectoryWalker::pushTask(size_t self, DirectoryTask task) {
+    ++pendingDirectories;
+    {
+        WorkQueue& own = queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.tasks.push_back(std::move(task));
+    }
+    idleCondition.notify_one();
+}
+
+void DirectoryWalker::scanDirectory(size_t self, const DirectoryTask& task, FileCatalog& results) {
+    std::vector<DirectoryItem> items;
+    int dirFd = -1;
+    if (!listDirectory(task.path, items, dirFd)) {
+        // 无权限或已被删除的目录本身已经收集，只是不再深入
+        return;
+    }
+
+    // 每个条目都stat到同一个File对象中，再写入目录
+    File file;
+    std::error_code ec;
+    for (const auto& item : items) {
+        fs::path childPath = task.path / item.name;
+        // 目录项已给出类型时在stat之前剪枝，被排除的目录连自身也不stat
+        if (item.typeKnown && item.isDirectory && descendFilter && !descendFilter(childPath)) {
+            continue;
+        }
+        std::string childRelative = task.relativePath.empty()
+            ? item.name
+            : task.relativePath + static_cast<char>(fs::path::preferred_separator) + item.name;
+#ifndef _WIN32
+        // 目录仍然打开着，按名称stat，不再从根解析整条路径
+        if (dirFd >= 0) {
+            file.initializeAt(dirFd, item.name.c_str(), childPath);
+        } else
+#endif
+        {
+            file.initialize(childPath);
+        }
+
+        bool isDirectory = item.isDirectory;
+        bool isSymlink = item.isSymlink;
+        if (!item.typeKnown) {
+            isDirectory = file.isDirectory();
+            isSymlink = file.isSymbolicLink();
+            if (isDirectory && descendFilter && !descendFilter(childPath)) {
+                continue;
+            }
+        }
+        results.add(file, childRelative, !task.viaSymlink && !isSymlink);
+
+        if (isDirectory) {
+            pushTask(self, DirectoryTask{childPath, task.realPath / item.name, childRelative, task.viaSymlink});
+        } else if (isSymlink && (!descendFilter || descendFilter(childPath)) &&
+                   fs::is_directory(childPath, ec) && !ec) {
+            // 跟随指向目录的符号链接，但目标是当前目录或其祖先时会形成循环，只收集链接本身
+            fs::path target = fs::canonical(childPath, ec);
+            if (!ec && !isWithin(task.realPath, target)) {
+                pushTask(self, DirectoryTask{childPath, target, childRelative, true});
+            }
+        }
+        ec.clear();
+    }
+#ifdef __linux__
+    if (dirFd >= 0) {
+        ::close(dirFd);
+    }
+#endif
+}
+
+bool DirectoryWalker::listDirectory(const fs::path& path, std::vector<DirectoryItem>& items, int& dirFd) const {
+    dirFd = -1;
+#ifdef __linux__
+    if (useGetdents) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        // getdents64一次读取一批目录项，d_type在大多数文件系统上可用，不需要逐个stat就能区分子目录
+        alignas(struct dirent64) char buffer[64 * 1024];
+        while (true) {
+            long bytes = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+            if (bytes <= 0) {
+                break;
+            }
+            for (long offset = 0; offset < bytes;) {
+                const auto* entry = reinterpret_cast<const struct dirent64*>(buffer + offset);
+                offset += entry->d_reclen;
+                const char* name = entry->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                    continue;
+                }
+                bool typeKnown = entry->d_type != DT_UNKNOWN;
+                items.push_back(DirectoryItem{name, entry->d_type == DT_DIR, entry->d_type == DT_LNK, typeKnown});
+            }
+        }
+        dirFd = fd;
+        return true;
+    }
+#endif
+
+    std::error_code ec;
+    fs::directory_iterator it(path, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        return false;
+    }
+    for (; it != fs::directory_iterator(); it.increment(ec)) {
+        fs::file_type type = it->symlink_status(ec).type();
+        if (ec) {
+            items.push_back(DirectoryItem{it->path().filename().string(), false, false, false});
+            ec.clear();
+            continue;
+        }
+        items.push_back(DirectoryItem{it->path().filename().string(),
+                                      type == fs::file_type::directory,
+                                      type == fs::file_type::symlink, true});
+    }
+    return true;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <filesystem>
+#include "../core/models/File.hpp"
+#include "../core/models/FileCatalog.hpp"
+
+namespace fs = std::filesystem;
+
+// 多线程目录遍历器
+// 每个工作线程有自己的目录队列：新发现的子目录压入自己队列的尾部并优先处理（深度优先，局部性好），
+// 自己的队列空了就从其他线程队列的头部窃取（窃取到的通常是层级较浅、子树较大的目录）。
+// 每个条目在工作线程中构造File（stat在线程间并行）；读取目录时用目录项的d_type分辨子目录，
+// 再相对已打开的目录statx一次取得元数据，每个条目只stat一次。结果与fs::recursive_directory_iterator
+// 使用skip_permission_denied | follow_directory_symlink时的条目集合相同，但顺序不确定：
+//   DirectoryWalker walker(8);
+//   std::vector<File> files = walker.walk("/data");
+// 也可以流式遍历，边遍历边处理，不等待整个目录树扫描完：
+//   walker.stream("/data", [](const FileEntry& entry) { ...; return true; });
+class DirectoryWalker {
+public:
+    // 流式遍历时每个条目的处理函数，返回false时停止遍历
+    using EntryCallback = std::function<bool(const FileEntry& entry)>;
+    // 子树剪枝：对每个子目录（含经由符号链接进入的目录）调用，返回false时整棵子树跳过
+    using DescendFilter = std::function<bool(const fs::path& directory)>;
+
+    // 流式遍历时每批交给消费者的条目数，以及默认最多积压的批数
+    static constexpr size_t STREAM_BATCH_SIZE = 256;
+    static constexpr size_t DEFAULT_STREAM_BATCHES = 64;
+
+    // threadCount为0时使用硬件并发数
+    explicit DirectoryWalker(size_t threadCount = 0);
+
+    // 是否使用getdents64读取目录（仅Linux，默认开启）
+    // 关闭时使用fs::directory_iterator，用于对比或在不支持的文件系统上回退
+    void setUseGetdents(bool enabled) { useGetdents = enabled; }
+
+    // 设置子树剪枝条件（在多个线程中并发调用，需要是只读的），为空时遍历全部子目录
+    // 被剪掉的目录本身不出现在结果中，也不会被打开或stat（目录项给出类型时连目录本身也不stat）；
+    // 被剪掉的指向目录的符号链接仍作为链接条目收集，只是不再跟随
+    void setDescendFilter(DescendFilter filter) { descendFilter = std::move(filter); }
+
+    size_t getThreadCount() const { return threadCount; }
+
+    // 递归收集root下的所有条目（不包括root本身），root不是目录时返回空目录
+    // 各线程直接写入自己的FileCatalog，结束后合并，不保存中间的File对象
+    FileCatalog walkCatalog(const fs::path& root);
+
+    // 同walkCatalog，结果还原为File列表
+    std::vector<File> walk(const fs::path& root);
+
+    // 流式遍历：遍历线程在后台扫描，发现的条目分批经过有界队列，由调用线程按到达顺序逐个交给consume
+    // 队列满时遍历线程等待，在途条目最多maxBatches * STREAM_BATCH_SIZE个，内存占用与条目总数无关
+    // consume返回false时停止遍历并返回false；consume抛出的异常在遍历线程结束后重新抛出
+    bool stream(const fs::path& root, const EntryCallback& consume, size_t maxBatches = DEFAULT_STREAM_BATCHES);
+
+private:
+    // 待遍历的目录
+    struct DirectoryTask {
+        fs::path path;
+        fs::path realPath;          // 经由符号链接进入时的真实路径，用于检测循环
+        std::string relativePath;   // 相对遍历根目录的路径
+        bool viaSymlink;            // 是否经由符号链接到达
+    };
+
+    // 一个工作线程的目录队列
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<DirectoryTask> tasks;
+    };
+
+    // 流式遍历时遍历线程与消费者之间的有界队列
+    struct EntryQueue {
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+        std::deque<FileCatalog> batches;
+        size_t capacity = 0;
+        size_t activeProducers = 0;
+        bool cancelled = false;
+    };
+
+    // 重置目录队列并放入根目录，root不是目录时返回false
+    bool prepare(const fs::path& root);
+
+    // 把一个线程手头的条目交给消费者，队列满时等待；遍历已取消时丢弃
+    void flushResults(FileCatalog& results);
+
+    void workerLoop(size_t self, FileCatalog& results);
+
+    // 从自己的队列尾部取出，失败时从其他队列头部窃取
+    bool takeTask(size_t self, DirectoryTask& task);
+    void pushTask(size_t self, DirectoryTask task);
+
+    // 读取一个目录的直接子项，子目录（含指向目录的符号链接）压入队列
+    void scanDirectory(size_t self, const DirectoryTask& task, FileCatalog& results);
+
+    // 目录中的一个条目，typeKnown为false时目录项没有给出类型，由调用方stat判断
+    struct DirectoryItem {
+        std::string name;
+        bool isDirectory;
+        bool isSymlink;
+        bool typeKnown;
+    };
+
+    // 列出目录的直接子项（不含.和..），目录无法打开时返回false，读取中途出错时保留已读到的条目
+    // 使用getdents64时dirFd返回仍打开的目录（由调用方关闭，用于按名称stat子项），否则为-1
+    bool listDirectory(const fs::path& path, std::vector<DirectoryItem>& items, int& dirFd) const;
+
+    size_t threadCount;
+    bool useGetdents;
+    DescendFilter descendFilter;
+    std::vector<WorkQueue> queues;
+    std::atomic<size_t> pendingDirectories;   // 已入队但尚未扫描完的目录数，为0时遍历结束
+    std::mutex idleMutex;                      // 没有可窃取的目录时，空闲线程在此等待
+    std::condition_variable idleCondition;
+    std::atomic<bool> stopping;                // 流式遍历被消费者中止
+    EntryQueue* output;                        // 流式遍历时非空
+};
@@ -0,0 +1,327 @@
+#include "EncryptedStream.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+DecryptingStreamBuf::DecryptingStreamBuf()
+    : segmentCount(0), plainSize(0), windowStart(NO_SEGMENT), windowEnd(NO_SEGMENT), readAhead(1),
+      areaStart(0), authFailed(false) {
+}
+
+DecryptingStreamBuf::~DecryptingStreamBuf() {
+}
+
+bool DecryptingStreamBuf::open(const std::string& path, const std::string& password) {
+    KeyCache keys(password);
+    return open(path, keys);
+}
+
+bool DecryptingStreamBuf::open(const std::string& path, KeyCache& keys) {
+    try {
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open input file: " << path << std::endl;
+            return false;
+        }
+
+        uint8_t headerBytes[Encryption::HEADER_SIZE];
+        file.read(reinterpret_cast<char*>(headerBytes), sizeof(headerBytes));
+        if (!file || !header.parse(headerBytes)) {
+            std::cerr << "Not a segmented encrypted file: " << path << std::endl;
+            return false;
+        }
+
+        file.seekg(0, std::ios::end);
+        uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+        if (!Encryption::segmentLayout(fileSize, header.segmentSize, segmentCount, plainSize)) {
+            std::cerr << "Corrupted encrypted file: " << path << std::endl;
+            return false;
+        }
+
+        // 密钥ID不符说明密码错误
+        std::vector<uint8_t> key;
+        if (!keys.fileKey(header, key)) {
+            return false;
+        }
+        ring.reset(new SegmentRing(key, header, Encryption::getThreadCount()));
+
+        // 解密第一段以校验密码
+        return loadSegment(0);
+
+    } catch (const std::exception& e) {
+        std::cerr << "Decryption error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool DecryptingStreamBuf::loadSegment(uint64_t index) {
+    const uint64_t segmentSize = header.segmentSize;
+    if (index < windowStart || index >= windowEnd) {
+        if (!ring || index >= segmentCount || authFailed) {
+            return false;
+        }
+
+        // 紧接着上一个窗口的顺序读取加倍预读，随机定位只解密一段
+        uint64_t capacity = static_cast<uint64_t>(ring->size()) * Encryption::SEGMENTS_PER_SLOT;
+        readAhead = index == windowEnd ? std::min(readAhead * 2, capacity) : 1;
+        uint64_t end = std::min(segmentCount, index + readAhead);
+
+        // 窗口中的分段在文件中是连续的，依次读入各槽位
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(Encryption::segmentOffset(index, header.segmentSize)), std::ios::beg);
+        size_t filled = 0;
+        bool ok = true;
+        for (uint64_t next = index; next < end && ok; ++filled) {
+            size_t segments = static_cast<size_t>(std::min<uint64_t>(end - next, Encryption::SEGMENTS_PER_SLOT));
+            SegmentRing::Slot& slot = ring->slot(filled, segments);
+            slot.firstIndex = next;
+            slot.sizes.clear();
+            for (size_t k = 0; k < segments; ++k, ++next) {
+                slot.sizes.push_back(static_cast<size_t>(std::min<uint64_t>(plainSize - next * segmentSize, segmentSize)));
+            }
+            ok = static_cast<bool>(file.read(reinterpret_cast<char*>(slot.sealed.data()), slot.sealedBytes()));
+        }
+        // 预读部分的分段认证失败时，前面完好的槽位仍可读取，读到失败的分段时才报告错误
+        size_t valid = 0;
+        if (ok && !ring->open(filled, segmentCount)) {
+            while (ring->slot(valid, 0).ok) {
+                ++valid;
+            }
+            end = ring->slot(valid, 0).firstIndex;
+        }
+        if (!ok || end == index) {
+            authFailed = true;
+            windowStart = windowEnd = NO_SEGMENT;
+            setg(nullptr, nullptr, nullptr);
+            return false;
+        }
+        windowStart = index;
+        windowEnd = end;
+    }
+
+    // 读取区为该段所在的整个槽位，槽位内的分段是连续的
+    SegmentRing::Slot& slot = ring->slot(static_cast<size_t>((index - windowStart) / Encryption::SEGMENTS_PER_SLOT), 0);
+    char* base = reinterpret_cast<char*>(slot.plain.data());
+    areaStart = slot.firstIndex * segmentSize;
+    setg(base, base + (index - slot.firstIndex) * segmentSize, base + slot.plainBytes());
+    return true;
+}
+
+uint64_t DecryptingStreamBuf::position() const {
+    if (!eback()) {
+        return 0;
+    }
+    return areaStart + static_cast<uint64_t>(gptr() - eback());
+}
+
+DecryptingStreamBuf::int_type DecryptingStreamBuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (!eback()) {
+        return traits_type::eof();
+    }
+    uint64_t areaEnd = areaStart + static_cast<uint64_t>(egptr() - eback());
+    if (areaEnd >= plainSize) {
+        return traits_type::eof();
+    }
+    if (!loadSegment(areaEnd / header.segmentSize) || gptr() == egptr()) {
+        return traits_type::eof();
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+DecryptingStreamBuf::pos_type DecryptingStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                           std::ios_base::openmode which) {
+    if (!(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type base = 0;
+    if (dir == std::ios_base::cur) {
+        base = static_cast<off_type>(position());
+        // tellg()不需要重新加载分段
+        if (off == 0) {
+            return pos_type(base);
+        }
+    } else if (dir == std::ios_base::end) {
+        base = static_cast<off_type>(plainSize);
+    }
+    return seekpos(pos_type(base + off), which);
+}
+
+DecryptingStreamBuf::pos_type DecryptingStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+    off_type target = static_cast<off_type>(pos);
+    if (!(which & std::ios_base::in) || target < 0 || static_cast<uint64_t>(target) > plainSize) {
+        return pos_type(off_type(-1));
+    }
+
+    // 定位到明文末尾时停在最后一段的末尾
+    uint64_t index = std::min<uint64_t>(static_cast<uint64_t>(target) / header.segmentSize, segmentCount - 1);
+    if (!loadSegment(index)) {
+        return pos_type(off_type(-1));
+    }
+    setg(eback(), eback() + (static_cast<uint64_t>(target) - areaStart), egptr());
+    return pos;
+}
+
+std::streamsize DecryptingStreamBuf::showmanyc() {
+    uint64_t current = position();
+    return current < plainSize ? static_cast<std::streamsize>(plainSize - current) : -1;
+}
+
+EncryptingStreamBuf::EncryptingStreamBuf() : currentSlot(0), segmentIndex(0), sealedBytes(0), writeFailed(false) {
+}
+
+EncryptingStreamBuf::~EncryptingStreamBuf() {
+}
+
+bool EncryptingStreamBuf::open(const std::string& path, KeyCache& keys) {
+    try {
+        std::vector<uint8_t> key;
+        if (!keys.newFileKey(header, key)) {
+            std::cerr << "Failed to generate nonce" << std::endl;
+            return false;
+        }
+
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open output file: " << path << std::endl;
+            return false;
+        }
+
+        uint8_t headerBytes[Encryption::HEADER_SIZE];
+        header.serialize(headerBytes);
+        file.write(reinterpret_cast<const char*>(headerBytes), sizeof(headerBytes));
+
+        ring.reset(new SegmentRing(key, header, Encryption::getThreadCount()));
+        segmentIndex = 0;
+        sealedBytes = 0;
+        writeFailed = !file;
+        // 先只分配一段，小文件不必分配整个槽位
+        ring->slot(0, 1);
+        usePutArea(0, 0);
+        return !writeFailed;
+
+    } catch (const std::exception& e) {
+        std::cerr << "Encryption error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void EncryptingStreamBuf::usePutArea(size_t i, size_t used) {
+    currentSlot = i;
+    char* base = reinterpret_cast<char*>(ring->slot(i, 0).plain.data());
+    setp(base, base + ring->slot(i, 0).plain.size());
+    pbump(static_cast<int>(used));
+}
+
+bool EncryptingStreamBuf::advance() {
+    if (!ring || writeFailed) {
+        return false;
+    }
+    size_t slotBytes = Encryption::SEGMENTS_PER_SLOT * header.segmentSize;
+    size_t used = static_cast<size_t>(pptr() - pbase());
+    if (used < slotBytes) {
+        // 当前槽位只分配了一部分，扩大到完整槽位后继续写入
+        ring->slot(currentSlot);
+        usePutArea(currentSlot, used);
+        return true;
+    }
+    // 写满的槽位都不含末段（后面还有数据），环满时一起加密写出
+    if (currentSlot + 1 == ring->size()) {
+        if (!sealSlots(ring->size(), slotBytes, false)) {
+            return false;
+        }
+        usePutArea(0, 0);
+        return true;
+    }
+    ring->slot(currentSlot + 1);
+    usePutArea(currentSlot + 1, 0);
+    return true;
+}
+
+bool EncryptingStreamBuf::sealSlots(size_t count, size_t lastBytes, bool final) {
+    const size_t segmentSize = header.segmentSize;
+    for (size_t i = 0; i < count; ++i) {
+        SegmentRing::Slot& slot = ring->slot(i, 0);
+        size_t bytes = i + 1 == count ? lastBytes : Encryption::SEGMENTS_PER_SLOT * segmentSize;
+        slot.firstIndex = segmentIndex;
+        slot.sizes.clear();
+        // 末段可能是满的，也可能为空（空文件只有一个标签）
+        do {
+            size_t size = std::min(bytes, segmentSize);
+            slot.sizes.push_back(size);
+            bytes -= size;
+        } while (bytes > 0);
+        segmentIndex += slot.sizes.size();
+    }
+
+    bool ok = ring->seal(count, final);
+    for (size_t i = 0; i < count && ok; ++i) {
+        const SegmentRing::Slot& slot = ring->slot(i, 0);
+        ok = static_cast<bool>(file.write(reinterpret_cast<const char*>(slot.sealed.data()), slot.sealedBytes()));
+        sealedBytes += slot.plainBytes();
+    }
+    if (!ok) {
+        writeFailed = true;
+        setp(nullptr, nullptr);
+    }
+    return ok;
+}
+
+EncryptingStreamBuf::int_type EncryptingStreamBuf::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    // 缓冲区满了且还有数据，说明已缓冲的部分不含末段
+    if (!advance()) {
+        return traits_type::eof();
+    }
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize EncryptingStreamBuf::xsputn(const char* s, std::streamsize n) {
+    std::streamsize written = 0;
+    while (written < n) {
+        if (pptr() == epptr() && !advance()) {
+            break;
+        }
+        std::streamsize chunk = std::min<std::streamsize>(n - written, epptr() - pptr());
+        std::memcpy(pptr(), s + written, static_cast<size_t>(chunk));
+        pbump(static_cast<int>(chunk));
+        written += chunk;
+    }
+    return written;
+}
+
+EncryptingStreamBuf::pos_type EncryptingStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                           std::ios_base::openmode which) {
+    if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out) || writeFailed) {
+        return pos_type(off_type(-1));
+    }
+    return pos_type(static_cast<off_type>(size()));
+}
+
+bool EncryptingStreamBuf::close() {
+    if (!file.is_open()) {
+        return false;
+    }
+    bool ok = ring && !writeFailed &&
+              sealSlots(currentSlot + 1, static_cast<size_t>(pptr() - pbase()), true);
+    ring.reset();
+    setp(nullptr, nullptr);
+    file.close();
+    return ok && static_cast<bool>(file);
+}
+
+uint64_t EncryptingStreamBuf::size() const {
+    if (!pbase()) {
+        return sealedBytes;
+    }
+    // 当前槽位之前的槽位都已写满
+    uint64_t buffered = static_cast<uint64_t>(currentSlot) * Encryption::SEGMENTS_PER_SLOT * header.segmentSize;
+    return sealedBytes + buffered + static_cast<uint64_t>(pptr() - pbase());
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <streambuf>
+#include <cstdint>
+#include "Encryption.hpp"
+
+// 分段加密文件的只读解密流缓冲，支持随机定位
+// 只解密实际读到的分段，还原包内单个文件时不需要先把整个包解密到临时文件：
+//   DecryptingStreamBuf buf;
+//   if (buf.open(path, password)) { std::istream in(&buf); ... }
+// 定位后只解密所在的一段；之后的顺序读取每次预读的分段数加倍，最多填满整个槽位环，
+// 一次预读的各槽位由共享线程池并行解密（线程数见Encryption::setThreadCount）
+// 分段认证失败时读取返回EOF，failed()为true
+class DecryptingStreamBuf : public std::streambuf {
+public:
+    DecryptingStreamBuf();
+    ~DecryptingStreamBuf() override;
+
+    // 打开分段加密文件并校验第一段，密码错误或格式不符时返回false
+    bool open(const std::string& path, const std::string& password);
+
+    // 使用密钥缓存打开，同一作业的多个文件只派生一次主密钥
+    bool open(const std::string& path, KeyCache& keys);
+
+    // 明文总大小
+    uint64_t size() const { return plainSize; }
+
+    // 是否遇到过认证失败
+    bool failed() const { return authFailed; }
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    std::streamsize showmanyc() override;
+
+private:
+    // 使第index段可读：不在已解密的窗口中时从index开始读取并解密一个新窗口，
+    // 读取区设为该段所在槽位，读取位置在该段开头
+    bool loadSegment(uint64_t index);
+
+    // 当前读取位置（明文偏移）
+    uint64_t position() const;
+
+    static constexpr uint64_t NO_SEGMENT = UINT64_MAX;
+
+    std::ifstream file;
+    EncryptionHeader header;
+    std::unique_ptr<SegmentRing> ring;
+    uint64_t segmentCount;
+    uint64_t plainSize;
+    uint64_t windowStart;     // 已解密窗口的分段范围 [windowStart, windowEnd)
+    uint64_t windowEnd;
+    uint64_t readAhead;       // 下一次顺序读取时预读的分段数
+    uint64_t areaStart;       // 读取区开头的明文偏移
+    bool authFailed;
+};
+
+// 分段加密文件的只写加密流缓冲
+// 写入的数据依次填满槽位环中的各槽位，环满时由共享线程池并行加密后按顺序写出，close()时加密剩余部分和末段；
+// 压缩输出可以直接写入，不需要中间文件，大文件的加密与Encryption::encryptFile一样是并行的：
+//   EncryptingStreamBuf buf;
+//   if (buf.open(path, keys)) { std::ostream out(&buf); ...; buf.close(); }
+// 没有调用close()就析构时文件不完整（缺少末段），解密会失败
+class EncryptingStreamBuf : public std::streambuf {
+public:
+    EncryptingStreamBuf();
+    ~EncryptingStreamBuf() override;
+
+    // 创建加密文件并写入文件头
+    bool open(const std::string& path, KeyCache& keys);
+
+    // 加密末段并关闭文件，任何一步失败都返回false
+    bool close();
+
+    // 已写入的明文字节数
+    uint64_t size() const;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    // 只支持查询当前位置（tellp），不能回写
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+private:
+    // 写入区已满且还有数据：扩大当前槽位或换到下一个槽位，环满时先加密写出
+    bool advance();
+
+    // 加密前count个槽位并按顺序写出，最后一个槽位有lastBytes字节，final表示其中包含末段
+    bool sealSlots(size_t count, size_t lastBytes, bool final);
+
+    // 写入区设为第i个槽位的明文缓冲区，跳过已写入的used字节
+    void usePutArea(size_t i, size_t used);
+
+    std::ofstream file;
+    EncryptionHeader header;
+    std::unique_ptr<SegmentRing> ring;
+    size_t currentSlot;       // 正在写入的槽位
+    uint64_t segmentIndex;    // 下一个要写出的段号
+    uint64_t sealedBytes;     // 已加密写出的明文字节数
+    bool writeFailed;
+};
@@ -1,19 +1,221 @@
 #include "Encryption.hpp"
+#include "ThreadPool.hpp"
 #include <openssl/aes.h>
 #include <openssl/evp.h>
 #include <openssl/sha.h>
 #include <openssl/rand.h>
+#include <openssl/hmac.h>
+#include <openssl/kdf.h>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <algorithm>
 
-// 生成随机盐值
-std::vector<uint8_t> Encryption::generateSalt() {
-    std::vector<uint8_t> salt(16);
-    if (RAND_bytes(salt.data(), salt.size()) != 1) {
-        throw std::runtime_error("Failed to generate salt");
+namespace {
+    using CipherContext = std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+
+    // 分段格式的魔数和版本号
+    constexpr char SEGMENT_MAGIC[4] = {'B', 'E', 'N', 'C'};
+    constexpr uint8_t SEGMENT_VERSION = 2;
+    constexpr size_t AAD_SIZE = Encryption::HEADER_SIZE + 9;
+
+    void writeLE32(uint8_t* out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint32_t readLE32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    void writeLE64(uint8_t* out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint64_t readLE64(const uint8_t* in) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    // 密钥ID：HMAC-SHA256(主密钥, 标签)的前8字节，不泄露主密钥本身
+    uint64_t computeKeyId(const std::vector<uint8_t>& master) {
+        static const char LABEL[] = "backuphelper key id";
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned int length = 0;
+        if (!HMAC(EVP_sha256(), master.data(), static_cast<int>(master.size()),
+                  reinterpret_cast<const unsigned char*>(LABEL), sizeof(LABEL) - 1, digest, &length)) {
+            throw std::runtime_error("Failed to compute key id");
+        }
+        return readLE64(digest);
+    }
+
+    // 文件密钥：HKDF-SHA256(主密钥, 盐 = 文件nonce)
+    std::vector<uint8_t> deriveFileKey(const std::vector<uint8_t>& master, const EncryptionHeader& header) {
+        static const char INFO[] = "backuphelper file key";
+        std::vector<uint8_t> key(32);
+        size_t length = key.size();
+        std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> ctx(
+            EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr), EVP_PKEY_CTX_free);
+        if (!ctx ||
+            EVP_PKEY_derive_init(ctx.get()) <= 0 ||
+            EVP_PKEY_CTX_set_hkdf_md(ctx.get(), EVP_sha256()) <= 0 ||
+            EVP_PKEY_CTX_set1_hkdf_salt(ctx.get(), header.nonce, sizeof(header.nonce)) <= 0 ||
+            EVP_PKEY_CTX_set1_hkdf_key(ctx.get(), master.data(), static_cast<int>(master.size())) <= 0 ||
+            EVP_PKEY_CTX_add1_hkdf_info(ctx.get(), reinterpret_cast<const unsigned char*>(INFO), sizeof(INFO) - 1) <= 0 ||
+            EVP_PKEY_derive(ctx.get(), key.data(), &length) <= 0) {
+            throw std::runtime_error("Failed to derive file key");
+        }
+        return key;
+    }
+
+    // 对前count个槽位执行fn；多于一个槽位时借用进程共享的线程池，最多threads个线程同时处理，
+    // 逐个文件加解密时不再为每个文件启动和回收一组线程
+    void forEachSlot(size_t threads, size_t count, const std::function<void(size_t)>& fn) {
+        if (threads <= 1 || count <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        ThreadPool::shared().parallelFor(count, fn, threads);
+    }
+
+    // 分块执行EVP_CipherUpdate，最后调用EVP_CipherFinal_ex处理填充
+    bool processStream(EVP_CIPHER_CTX* ctx, std::istream& in, std::ostream& out) {
+        std::vector<uint8_t> inBuffer(Encryption::CHUNK_SIZE);
+        std::vector<uint8_t> outBuffer(Encryption::CHUNK_SIZE + AES_BLOCK_SIZE);
+        int len;
+
+        while (in) {
+            in.read(reinterpret_cast<char*>(inBuffer.data()), inBuffer.size());
+            std::streamsize count = in.gcount();
+            if (count <= 0) {
+                break;
+            }
+            if (EVP_CipherUpdate(ctx, outBuffer.data(), &len, inBuffer.data(), static_cast<int>(count)) != 1) {
+                return false;
+            }
+            out.write(reinterpret_cast<const char*>(outBuffer.data()), len);
+        }
+        if (in.bad()) {
+            return false;
+        }
+
+        if (EVP_CipherFinal_ex(ctx, outBuffer.data(), &len) != 1) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(outBuffer.data()), len);
+        return static_cast<bool>(out);
     }
-    return salt;
+}
+
+void EncryptionHeader::serialize(uint8_t* out) const {
+    std::memcpy(out, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    out[4] = SEGMENT_VERSION;
+    out[5] = keyType;
+    out[6] = 0;
+    out[7] = 0;
+    writeLE32(out + 8, segmentSize);
+    std::memcpy(out + 12, salt, sizeof(salt));
+    std::memcpy(out + 28, nonce, sizeof(nonce));
+    writeLE64(out + 40, keyId);
+}
+
+bool EncryptionHeader::parse(const uint8_t* in) {
+    if (std::memcmp(in, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 || in[4] != SEGMENT_VERSION) {
+        return false;
+    }
+    keyType = in[5];
+    segmentSize = readLE32(in + 8);
+    std::memcpy(salt, in + 12, sizeof(salt));
+    std::memcpy(nonce, in + 28, sizeof(nonce));
+    keyId = readLE64(in + 40);
+    return keyType == KEY_MASTER && segmentSize > 0 && segmentSize <= Encryption::MAX_SEGMENT_SIZE;
+}
+
+SegmentCipher::SegmentCipher(const std::vector<uint8_t>& key, const EncryptionHeader& header)
+    : ctx(EVP_CIPHER_CTX_new()), key(key), headerBytes(Encryption::HEADER_SIZE) {
+    if (!ctx) {
+        throw std::runtime_error("Failed to create cipher context");
+    }
+    header.serialize(headerBytes.data());
+    std::memcpy(baseNonce, header.nonce, sizeof(baseNonce));
+}
+
+SegmentCipher::~SegmentCipher() {
+    EVP_CIPHER_CTX_free(static_cast<EVP_CIPHER_CTX*>(ctx));
+}
+
+void SegmentCipher::prepare(uint64_t index, bool final, uint8_t* nonce, uint8_t* aad) const {
+    // nonce的后8字节与段号（小端）异或
+    std::memcpy(nonce, baseNonce, sizeof(baseNonce));
+    for (int i = 0; i < 8; ++i) {
+        nonce[4 + i] ^= static_cast<uint8_t>(index >> (8 * i));
+    }
+
+    std::memcpy(aad, headerBytes.data(), headerBytes.size());
+    for (int i = 0; i < 8; ++i) {
+        aad[Encryption::HEADER_SIZE + i] = static_cast<uint8_t>(index >> (8 * i));
+    }
+    aad[Encryption::HEADER_SIZE + 8] = final ? 1 : 0;
+}
+
+bool SegmentCipher::seal(uint64_t index, bool final, const uint8_t* plain, size_t size, uint8_t* out) {
+    EVP_CIPHER_CTX* context = static_cast<EVP_CIPHER_CTX*>(ctx);
+    uint8_t nonce[12];
+    uint8_t aad[AAD_SIZE];
+    prepare(index, final, nonce, aad);
+
+    int len;
+    if (EVP_EncryptInit_ex(context, EVP_aes_256_gcm(), nullptr, key.data(), nonce) != 1 ||
+        EVP_EncryptUpdate(context, nullptr, &len, aad, sizeof(aad)) != 1) {
+        return false;
+    }
+    if (size > 0 && EVP_EncryptUpdate(context, out, &len, plain, static_cast<int>(size)) != 1) {
+        return false;
+    }
+    if (EVP_EncryptFinal_ex(context, out + size, &len) != 1) {
+        return false;
+    }
+    return EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_GET_TAG, Encryption::TAG_SIZE, out + size) == 1;
+}
+
+bool SegmentCipher::open(uint64_t index, bool final, const uint8_t* sealed, size_t size, uint8_t* plain) {
+    EVP_CIPHER_CTX* context = static_cast<EVP_CIPHER_CTX*>(ctx);
+    uint8_t nonce[12];
+    uint8_t aad[AAD_SIZE];
+    prepare(index, final, nonce, aad);
+
+    int len;
+    if (EVP_DecryptInit_ex(context, EVP_aes_256_gcm(), nullptr, key.data(), nonce) != 1 ||
+        EVP_DecryptUpdate(context, nullptr, &len, aad, sizeof(aad)) != 1) {
+        return false;
+    }
+    if (size > 0 && EVP_DecryptUpdate(context, plain, &len, sealed, static_cast<int>(size)) != 1) {
+        return false;
+    }
+    uint8_t tag[Encryption::TAG_SIZE];
+    std::memcpy(tag, sealed + size, sizeof(tag));
+    if (EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG, sizeof(tag), tag) != 1) {
+        return false;
+    }
+    // 标签不匹配时EVP_DecryptFinal_ex失败
+    return EVP_DecryptFinal_ex(context, plain + size, &len) == 1;
 }
 
 // 用于AES加密的密钥派生函数
@@ -29,98 +231,231 @@ std::vector<uint8_t> Encryption::deriveKey(const std::string& password, const st
     return key;
 }
 
-// AES加密函数
-bool Encryption::encryptAES(const std::vector<uint8_t>& plaintext, const std::vector<uint8_t>& key, 
-                          std::vector<uint8_t>& ciphertext, std::vector<uint8_t>& iv) {
-    // 生成随机IV
-    iv.resize(16);
-    if (RAND_bytes(iv.data(), iv.size()) != 1) {
+KeyCache::KeyCache(const std::string& password) : password(password), derivationCount(0) {
+}
+
+std::vector<uint8_t> KeyCache::passwordKey(const uint8_t* salt, size_t saltSize) {
+    std::string saltKey(reinterpret_cast<const char*>(salt), saltSize);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = keys.find(saltKey);
+    if (it == keys.end()) {
+        it = keys.emplace(saltKey, Encryption::deriveKey(password, std::vector<uint8_t>(salt, salt + saltSize))).first;
+        ++derivationCount;
+    }
+    return it->second;
+}
+
+bool KeyCache::newFileKey(EncryptionHeader& header, std::vector<uint8_t>& fileKey) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobSalt.empty()) {
+            jobSalt.resize(sizeof(header.salt));
+            if (RAND_bytes(reinterpret_cast<unsigned char*>(&jobSalt[0]), jobSalt.size()) != 1) {
+                jobSalt.clear();
+                return false;
+            }
+        }
+        std::memcpy(header.salt, jobSalt.data(), sizeof(header.salt));
+    }
+    if (RAND_bytes(header.nonce, sizeof(header.nonce)) != 1) {
         return false;
     }
-    
-    // 创建加密上下文
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) {
+
+    std::vector<uint8_t> master = passwordKey(header.salt, sizeof(header.salt));
+    header.keyType = EncryptionHeader::KEY_MASTER;
+    header.segmentSize = Encryption::SEGMENT_SIZE;
+    header.keyId = computeKeyId(master);
+    fileKey = deriveFileKey(master, header);
+    return true;
+}
+
+bool KeyCache::fileKey(const EncryptionHeader& header, std::vector<uint8_t>& fileKey) {
+    std::vector<uint8_t> master = passwordKey(header.salt, sizeof(header.salt));
+    if (computeKeyId(master) != header.keyId) {
         return false;
     }
-    
-    // 初始化加密操作
-    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.data(), iv.data()) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    fileKey = deriveFileKey(master, header);
+    return true;
+}
+
+size_t KeyCache::getDerivationCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return derivationCount;
+}
+
+bool Encryption::segmentLayout(uint64_t fileSize, uint32_t segmentSize, uint64_t& segmentCount, uint64_t& plainSize) {
+    // 至少有一个分段（空文件也有一个只含标签的末段）
+    if (fileSize < HEADER_SIZE + TAG_SIZE) {
         return false;
     }
-    
-    // 分配足够的空间用于存储密文
-    ciphertext.resize(plaintext.size() + AES_BLOCK_SIZE);
-    int len;
-    int ciphertext_len;
-    
-    // 执行加密
-    if (EVP_EncryptUpdate(ctx, ciphertext.data(), &len, plaintext.data(), plaintext.size()) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return false;
-    }
-    ciphertext_len = len;
-    
-    // 完成加密
-    if (EVP_EncryptFinal_ex(ctx, ciphertext.data() + len, &len) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return false;
-    }
-    ciphertext_len += len;
-    
-    // 调整密文大小
-    ciphertext.resize(ciphertext_len);
-    
-    // 清理
-    EVP_CIPHER_CTX_free(ctx);
+    uint64_t body = fileSize - HEADER_SIZE;
+    uint64_t stride = static_cast<uint64_t>(segmentSize) + TAG_SIZE;
+    segmentCount = (body + stride - 1) / stride;
+    uint64_t lastSealed = body - (segmentCount - 1) * stride;
+    if (lastSealed < TAG_SIZE) {
+        return false;
+    }
+    plainSize = (segmentCount - 1) * segmentSize + (lastSealed - TAG_SIZE);
+    return true;
+}
+
+bool Encryption::isSegmentedFile(const std::string& path) {
+    std::ifstream inFile(path, std::ios::binary);
+    uint8_t bytes[HEADER_SIZE];
+    inFile.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+    EncryptionHeader header;
+    return inFile && header.parse(bytes);
+}
+
+size_t SegmentRing::Slot::plainBytes() const {
+    size_t total = 0;
+    for (size_t size : sizes) {
+        total += size;
+    }
+    return total;
+}
+
+SegmentRing::SegmentRing(const std::vector<uint8_t>& key, const EncryptionHeader& header, size_t threads)
+    : key(key), header(header), threads(std::max<size_t>(1, threads)),
+      slots(this->threads > 1 ? std::max(Encryption::RING_SLOTS, 2 * this->threads) : 1) {
+}
+
+SegmentRing::Slot& SegmentRing::slot(size_t i, size_t segments) {
+    // 小文件只用到第一个槽位的一部分，缓冲区按需扩大
+    Slot& slot = slots[i];
+    if (!slot.cipher) {
+        slot.cipher.reset(new SegmentCipher(key, header));
+    }
+    segments = std::min(segments, Encryption::SEGMENTS_PER_SLOT);
+    if (slot.plain.size() < segments * header.segmentSize) {
+        slot.plain.resize(segments * header.segmentSize);
+        slot.sealed.resize(segments * (header.segmentSize + Encryption::TAG_SIZE));
+    }
+    return slot;
+}
+
+bool SegmentRing::seal(size_t count, bool lastFinal) {
+    const size_t segmentSize = header.segmentSize;
+    const size_t stride = segmentSize + Encryption::TAG_SIZE;
+    forEachSlot(threads, count, [this, count, lastFinal, segmentSize, stride](size_t i) {
+        Slot& slot = slots[i];
+        slot.ok = true;
+        for (size_t k = 0; k < slot.sizes.size() && slot.ok; ++k) {
+            bool final = lastFinal && i + 1 == count && k + 1 == slot.sizes.size();
+            slot.ok = slot.cipher->seal(slot.firstIndex + k, final, slot.plain.data() + k * segmentSize,
+                                        slot.sizes[k], slot.sealed.data() + k * stride);
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        if (!slots[i].ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SegmentRing::open(size_t count, uint64_t segmentCount) {
+    const size_t segmentSize = header.segmentSize;
+    const size_t stride = segmentSize + Encryption::TAG_SIZE;
+    forEachSlot(threads, count, [this, segmentCount, segmentSize, stride](size_t i) {
+        Slot& slot = slots[i];
+        slot.ok = true;
+        for (size_t k = 0; k < slot.sizes.size() && slot.ok; ++k) {
+            uint64_t index = slot.firstIndex + k;
+            slot.ok = slot.cipher->open(index, index + 1 == segmentCount, slot.sealed.data() + k * stride,
+                                        slot.sizes[k], slot.plain.data() + k * segmentSize);
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        if (!slots[i].ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::atomic<size_t> Encryption::threadCount(0);
+
+void Encryption::setThreadCount(size_t count) {
+    threadCount = count;
+}
+
+size_t Encryption::getThreadCount() {
+    size_t count = threadCount;
+    return count > 0 ? count : std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool Encryption::encryptSegments(std::istream& in, std::ostream& out,
+                                 const std::vector<uint8_t>& key, const EncryptionHeader& header) {
+    SegmentRing ring(key, header, getThreadCount());
+    const size_t segmentSize = header.segmentSize;
+
+    uint64_t nextIndex = 0;
+    bool endOfInput = false;
+    while (!endOfInput) {
+        // 1. 依次填满各槽位；读不满一段或读完后已到输入末尾的是末段
+        size_t filled = 0;
+        while (filled < ring.size() && !endOfInput) {
+            SegmentRing::Slot& slot = ring.slot(filled);
+            slot.firstIndex = nextIndex;
+            slot.sizes.clear();
+            while (slot.sizes.size() < SEGMENTS_PER_SLOT) {
+                char* target = reinterpret_cast<char*>(slot.plain.data() + slot.sizes.size() * segmentSize);
+                in.read(target, segmentSize);
+                size_t count = static_cast<size_t>(in.gcount());
+                if (in.bad()) {
+                    return false;
+                }
+                slot.sizes.push_back(count);
+                ++nextIndex;
+                if (count < segmentSize || in.peek() == std::char_traits<char>::eof()) {
+                    endOfInput = true;
+                    break;
+                }
+            }
+            ++filled;
+        }
+
+        // 2. 并行加密，末段只可能在最后一个槽位
+        if (!ring.seal(filled, endOfInput)) {
+            return false;
+        }
+
+        // 3. 按顺序写出
+        for (size_t i = 0; i < filled; ++i) {
+            out.write(reinterpret_cast<const char*>(ring.slot(i).sealed.data()), ring.slot(i).sealedBytes());
+        }
+        if (!out) {
+            return false;
+        }
+    }
     return true;
 }
 
 // AES解密函数
-bool Encryption::decryptAES(const std::vector<uint8_t>& ciphertext, const std::vector<uint8_t>& key, 
-                          const std::vector<uint8_t>& iv, std::vector<uint8_t>& plaintext) {
+bool Encryption::decryptAES(std::istream& in, std::ostream& out,
+                          const std::vector<uint8_t>& key, const std::vector<uint8_t>& iv) {
     // 创建解密上下文
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    CipherContext ctx(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
     if (!ctx) {
         return false;
     }
-    
+
     // 初始化解密操作
-    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.data(), iv.data()) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
+    if (EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_cbc(), nullptr, key.data(), iv.data()) != 1) {
         return false;
     }
-    
-    // 分配足够的空间用于存储明文
-    plaintext.resize(ciphertext.size());
-    int len;
-    int plaintext_len;
-    
-    // 执行解密
-    if (EVP_DecryptUpdate(ctx, plaintext.data(), &len, ciphertext.data(), ciphertext.size()) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return false;
-    }
-    plaintext_len = len;
-    
-    // 完成解密
-    if (EVP_DecryptFinal_ex(ctx, plaintext.data() + len, &len) != 1) {
-        EVP_CIPHER_CTX_free(ctx);
-        return false;
-    }
-    plaintext_len += len;
-    
-    // 调整明文大小
-    plaintext.resize(plaintext_len);
-    
-    // 清理
-    EVP_CIPHER_CTX_free(ctx);
-    return true;
+
+    return processStream(ctx.get(), in, out);
 }
 
 // 加密文件
 bool Encryption::encryptFile(const std::string& inputFile, const std::string& outputFile, const std::string& password) {
+    KeyCache keys(password);
+    return encryptFile(inputFile, outputFile, keys);
+}
+
+bool Encryption::encryptFile(const std::string& inputFile, const std::string& outputFile, KeyCache& keys) {
     try {
         // 读取输入文件
         std::ifstream inFile(inputFile, std::ios::binary);
@@ -128,53 +463,135 @@ bool Encryption::encryptFile(const std::string& inputFile, const std::string& ou
             std::cerr << "Failed to open input file: " << inputFile << std::endl;
             return false;
         }
-        
-        std::vector<uint8_t> plaintext(
-            (std::istreambuf_iterator<char>(inFile)),
-            (std::istreambuf_iterator<char>())
-        );
-        inFile.close();
-        
-        // 生成盐值
-        std::vector<uint8_t> salt = generateSalt();
-        
-        // 派生密钥
-        std::vector<uint8_t> key = deriveKey(password, salt);
-        
-        // 加密数据
-        std::vector<uint8_t> ciphertext;
-        std::vector<uint8_t> iv;
-        if (!encryptAES(plaintext, key, ciphertext, iv)) {
-            std::cerr << "Failed to encrypt data" << std::endl;
+
+        // 生成文件头并派生文件密钥
+        EncryptionHeader header;
+        std::vector<uint8_t> key;
+        if (!keys.newFileKey(header, key)) {
+            std::cerr << "Failed to generate nonce" << std::endl;
             return false;
         }
-        
+
         // 写入输出文件
         std::ofstream outFile(outputFile, std::ios::binary);
         if (!outFile) {
             std::cerr << "Failed to open output file: " << outputFile << std::endl;
             return false;
         }
-        
-        // 写入盐值 (16字节)
-        outFile.write(reinterpret_cast<const char*>(salt.data()), salt.size());
-        
-        // 写入IV (16字节)
-        outFile.write(reinterpret_cast<const char*>(iv.data()), iv.size());
-        
-        // 写入密文
-        outFile.write(reinterpret_cast<const char*>(ciphertext.data()), ciphertext.size());
-        
+
+        // 写入文件头
+        uint8_t headerBytes[HEADER_SIZE];
+        header.serialize(headerBytes);
+        outFile.write(reinterpret_cast<const char*>(headerBytes), sizeof(headerBytes));
+
+        // 分段加密
+        if (!encryptSegments(inFile, outFile, key, header)) {
+            std::cerr << (inFile.bad() ? "Failed to read input file: " + inputFile : std::string("Failed to encrypt data"))
+                      << std::endl;
+            outFile.close();
+            std::remove(outputFile.c_str());
+            return false;
+        }
+
         outFile.close();
-        return true;
+        return static_cast<bool>(outFile);
     } catch (const std::exception& e) {
         std::cerr << "Encryption error: " << e.what() << std::endl;
         return false;
     }
 }
 
+// 解密旧格式
+bool Encryption::decryptLegacy(std::istream& in, std::ostream& out, KeyCache& keys) {
+    // 读取盐值 (16字节)
+    std::vector<uint8_t> salt(16);
+    in.read(reinterpret_cast<char*>(salt.data()), salt.size());
+
+    // 读取IV (16字节)
+    std::vector<uint8_t> iv(16);
+    in.read(reinterpret_cast<char*>(iv.data()), iv.size());
+    if (!in) {
+        return false;
+    }
+
+    // 派生密钥并分块解密；密码错误或数据损坏要到最后一块校验填充时才能发现
+    std::vector<uint8_t> key = keys.passwordKey(salt.data(), salt.size());
+    return decryptAES(in, out, key, iv);
+}
+
+// 解密分段格式
+bool Encryption::decryptSegmented(std::istream& in, std::ostream& out, KeyCache& keys) {
+    uint8_t headerBytes[HEADER_SIZE];
+    in.read(reinterpret_cast<char*>(headerBytes), sizeof(headerBytes));
+    EncryptionHeader header;
+    if (!in || !header.parse(headerBytes)) {
+        return false;
+    }
+
+    // 由文件大小计算分段数，用于判断末段
+    in.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(HEADER_SIZE, std::ios::beg);
+    uint64_t segmentCount = 0;
+    uint64_t plainSize = 0;
+    if (!segmentLayout(fileSize, header.segmentSize, segmentCount, plainSize)) {
+        return false;
+    }
+
+    size_t threads = getThreadCount();
+    // 密钥ID不符说明密码错误，不必逐段尝试
+    std::vector<uint8_t> key;
+    if (!keys.fileKey(header, key)) {
+        return false;
+    }
+    SegmentRing ring(key, header, threads);
+    const size_t segmentSize = header.segmentSize;
+
+    uint64_t nextIndex = 0;
+    uint64_t remaining = plainSize;
+    while (nextIndex < segmentCount) {
+        // 1. 依次读满各槽位
+        size_t filled = 0;
+        while (filled < ring.size() && nextIndex < segmentCount) {
+            SegmentRing::Slot& slot = ring.slot(filled);
+            slot.firstIndex = nextIndex;
+            slot.sizes.clear();
+            while (slot.sizes.size() < SEGMENTS_PER_SLOT && nextIndex < segmentCount) {
+                size_t size = static_cast<size_t>(std::min<uint64_t>(remaining, segmentSize));
+                slot.sizes.push_back(size);
+                remaining -= size;
+                ++nextIndex;
+            }
+            in.read(reinterpret_cast<char*>(slot.sealed.data()), slot.sealedBytes());
+            if (!in) {
+                return false;
+            }
+            ++filled;
+        }
+
+        // 2. 并行解密并校验
+        if (!ring.open(filled, segmentCount)) {
+            return false;
+        }
+
+        // 3. 按顺序写出
+        for (size_t i = 0; i < filled; ++i) {
+            out.write(reinterpret_cast<const char*>(ring.slot(i).plain.data()), ring.slot(i).plainBytes());
+        }
+        if (!out) {
+            return false;
+        }
+    }
+    return static_cast<bool>(out);
+}
+
 // 解密文件
 bool Encryption::decryptFile(const std::string& inputFile, const std::string& outputFile, const std::string& password) {
+    KeyCache keys(password);
+    return decryptFile(inputFile, outputFile, keys);
+}
+
+bool Encryption::decryptFile(const std::string& inputFile, const std::string& outputFile, KeyCache& keys) {
     try {
         // 读取输入文件
         std::ifstream inFile(inputFile, std::ios::binary);
@@ -182,42 +599,28 @@ bool Encryption::decryptFile(const std::string& inputFile, const std::string& ou
             std::cerr << "Failed to open input file: " << inputFile << std::endl;
             return false;
         }
-        
-        // 读取盐值 (16字节)
-        std::vector<uint8_t> salt(16);
-        inFile.read(reinterpret_cast<char*>(salt.data()), salt.size());
-        
-        // 读取IV (16字节)
-        std::vector<uint8_t> iv(16);
-        inFile.read(reinterpret_cast<char*>(iv.data()), iv.size());
-        
-        // 读取密文
-        std::vector<uint8_t> ciphertext(
-            (std::istreambuf_iterator<char>(inFile)),
-            (std::istreambuf_iterator<char>())
-        );
-        inFile.close();
-        
-        // 派生密钥
-        std::vector<uint8_t> key = deriveKey(password, salt);
-        
-        // 解密数据
-        std::vector<uint8_t> plaintext;
-        if (!decryptAES(ciphertext, key, iv, plaintext)) {
-            std::cerr << "Failed to decrypt data" << std::endl;
-            return false;
-        }
-        
+
+        bool segmented = isSegmentedFile(inputFile);
+
         // 写入输出文件
         std::ofstream outFile(outputFile, std::ios::binary);
         if (!outFile) {
             std::cerr << "Failed to open output file: " << outputFile << std::endl;
             return false;
         }
-        
-        outFile.write(reinterpret_cast<const char*>(plaintext.data()), plaintext.size());
+
+        // 认证失败或数据损坏时删除已写出的部分明文
+        bool ok = segmented ? decryptSegmented(inFile, outFile, keys)
+                            : decryptLegacy(inFile, outFile, keys);
+        if (!ok) {
+            std::cerr << "Failed to decrypt data: " << inputFile << std::endl;
+            outFile.close();
+            std::remove(outputFile.c_str());
+            return false;
+        }
+
         outFile.close();
-        return true;
+        return static_cast<bool>(outFile);
     } catch (const std::exception& e) {
         std::cerr << "Decryption error: " << e.what() << std::endl;
         return false;
@@ -2,27 +2,187 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <memory>
+
+// 分段加密格式（v2）的文件头
+// 布局（48字节，整数为小端序）：
+//   "BENC" + 版本号(u8=2) + 密钥类型(u8) + 保留(u16) + 分段大小(u32)
+//   + 作业盐值(16) + 文件nonce(12) + 密钥ID(u64)
+// 文件头之后是各分段：密文 + GCM标签(16字节)，除最后一段外每段明文都是分段大小，
+// 因此第i段位于 HEADER_SIZE + i * (分段大小 + TAG_SIZE)，不需要额外的索引表
+struct EncryptionHeader {
+    // 主密钥 = PBKDF2(密码, 作业盐值)，文件密钥 = HKDF(主密钥, 文件nonce)
+    static constexpr uint8_t KEY_MASTER = 1;
+
+    uint8_t keyType = KEY_MASTER;
+    uint32_t segmentSize = 0;
+    uint8_t salt[16] = {};
+    uint8_t nonce[12] = {};
+    uint64_t keyId = 0;  // 主密钥的标识，用于还原时匹配缓存的主密钥、尽早发现密码错误
+
+    // 序列化为Encryption::HEADER_SIZE字节
+    void serialize(uint8_t* out) const;
+
+    // 解析文件头，魔数、版本或分段大小不合法时返回false
+    bool parse(const uint8_t* in);
+};
+
+// 作业级密钥缓存
+// 备份时整个作业只生成一个盐值、只运行一次PBKDF2得到主密钥，每个文件的密钥由HKDF从主密钥和文件nonce派生；
+// 还原时按文件头中的盐值缓存主密钥，同一作业的文件只派生一次。可在多个线程间共享
+class KeyCache {
+public:
+    explicit KeyCache(const std::string& password);
+
+    // 为新文件填写文件头（作业盐值、密钥ID、随机nonce）并返回文件密钥
+    bool newFileKey(EncryptionHeader& header, std::vector<uint8_t>& fileKey);
+
+    // 按文件头取得文件密钥，密钥ID不符（密码错误）时返回false
+    bool fileKey(const EncryptionHeader& header, std::vector<uint8_t>& fileKey);
+
+    // PBKDF2(密码, 盐值)，按盐值缓存；也用于旧的整体CBC格式
+    std::vector<uint8_t> passwordKey(const uint8_t* salt, size_t saltSize);
+
+    // 实际运行PBKDF2的次数
+    size_t getDerivationCount() const;
+
+private:
+    std::string password;
+    mutable std::mutex mutex;
+    std::map<std::string, std::vector<uint8_t>> keys;  // 盐值 -> PBKDF2结果
+    std::string jobSalt;                               // 本作业新文件使用的盐值，第一次加密时生成
+    size_t derivationCount;
+};
+
+// 单个分段的AES-256-GCM加解密
+// 每段的nonce是基础nonce与段号异或，附加认证数据为 文件头 + 段号(u64) + 末段标志(u8)，
+// 因此分段被调换、截断或篡改都会导致认证失败。
+// 一个实例持有一个OpenSSL上下文，不能在线程间共享；多线程时每个线程各建一个
+class SegmentCipher {
+public:
+    SegmentCipher(const std::vector<uint8_t>& key, const EncryptionHeader& header);
+    ~SegmentCipher();
+
+    SegmentCipher(const SegmentCipher&) = delete;
+    SegmentCipher& operator=(const SegmentCipher&) = delete;
+
+    // 加密size字节明文，out写入 size 字节密文 + TAG_SIZE 字节标签
+    bool seal(uint64_t index, bool final, const uint8_t* plain, size_t size, uint8_t* out);
+
+    // 解密 size 字节密文 + TAG_SIZE 字节标签，认证失败返回false
+    bool open(uint64_t index, bool final, const uint8_t* sealed, size_t size, uint8_t* plain);
+
+private:
+    // 计算段号对应的nonce和附加认证数据
+    void prepare(uint64_t index, bool final, uint8_t* nonce, uint8_t* aad) const;
+
+    void* ctx;                        // EVP_CIPHER_CTX
+    std::vector<uint8_t> key;
+    std::vector<uint8_t> headerBytes;
+    uint8_t baseNonce[12];
+};
 
 class Encryption {
 private:
-    // 用于AES加密的密钥派生函数
-    static std::vector<uint8_t> deriveKey(const std::string& password, const std::vector<uint8_t>& salt);
-    
-    // 生成随机盐值
-    static std::vector<uint8_t> generateSalt();
-    
-    // AES加密函数
-    static bool encryptAES(const std::vector<uint8_t>& plaintext, const std::vector<uint8_t>& key, 
-                          std::vector<uint8_t>& ciphertext, std::vector<uint8_t>& iv);
-    
-    // AES解密函数
-    static bool decryptAES(const std::vector<uint8_t>& ciphertext, const std::vector<uint8_t>& key, 
-                          const std::vector<uint8_t>& iv, std::vector<uint8_t>& plaintext);
-    
+    // AES解密函数，按CHUNK_SIZE分块从in读取密文，明文写入out
+    static bool decryptAES(std::istream& in, std::ostream& out,
+                          const std::vector<uint8_t>& key, const std::vector<uint8_t>& iv);
+
+    // 解密旧格式（盐值 + IV + 整体CBC密文）
+    static bool decryptLegacy(std::istream& in, std::ostream& out, KeyCache& keys);
+
+    // 解密分段格式
+    static bool decryptSegmented(std::istream& in, std::ostream& out, KeyCache& keys);
+
+    // 分段加密in中的全部数据写入out（不含文件头），各槽位的分段由工作线程并行加密
+    static bool encryptSegments(std::istream& in, std::ostream& out,
+                                const std::vector<uint8_t>& key, const EncryptionHeader& header);
+
+    // 分段加解密的工作线程数
+    static std::atomic<size_t> threadCount;
+
 public:
-    // 加密文件
+    // 流式加解密的分块大小，内存占用与文件大小无关
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    // 分段格式的参数
+    static constexpr size_t SEGMENT_SIZE = 64 * 1024;  // 默认分段明文大小
+    static constexpr size_t MAX_SEGMENT_SIZE = 16 << 20;  // 分段大小上限
+    static constexpr size_t TAG_SIZE = 16;             // GCM认证标签长度
+    static constexpr size_t HEADER_SIZE = 48;          // 文件头长度
+    static constexpr size_t SEGMENTS_PER_SLOT = 4;     // 并行加解密时每个槽位的分段数
+    static constexpr size_t RING_SLOTS = 4;            // 并行加解密时的最少槽位数
+
+    // 设置分段加解密的工作线程数，0表示使用全部硬件线程
+    // 工作线程借用进程共享的线程池（ThreadPool::shared），这里只限制同时参与的线程数
+    static void setThreadCount(size_t count);
+    static size_t getThreadCount();
+
+    // 用于AES加密的密钥派生函数（PBKDF2，开销大，应通过KeyCache调用）
+    static std::vector<uint8_t> deriveKey(const std::string& password, const std::vector<uint8_t>& salt);
+
+    // 根据文件大小计算分段数和明文总大小，大小不符合分段布局时返回false
+    static bool segmentLayout(uint64_t fileSize, uint32_t segmentSize, uint64_t& segmentCount, uint64_t& plainSize);
+
+    // 第index段在文件中的偏移
+    static uint64_t segmentOffset(uint64_t index, uint32_t segmentSize) {
+        return HEADER_SIZE + index * (static_cast<uint64_t>(segmentSize) + TAG_SIZE);
+    }
+
+    // 判断文件是否为分段加密格式
+    static bool isSegmentedFile(const std::string& path);
+
+    // 加密文件（分段格式），单独使用时每次调用都会运行一次PBKDF2
     static bool encryptFile(const std::string& inputFile, const std::string& outputFile, const std::string& password);
-    
-    // 解密文件
+
+    // 用作业级密钥加密文件，同一作业的文件共用一次PBKDF2
+    static bool encryptFile(const std::string& inputFile, const std::string& outputFile, KeyCache& keys);
+
+    // 解密文件，支持分段格式和旧的整体CBC格式
     static bool decryptFile(const std::string& inputFile, const std::string& outputFile, const std::string& password);
+
+    // 用密钥缓存解密文件，同一作业的文件只派生一次主密钥
+    static bool decryptFile(const std::string& inputFile, const std::string& outputFile, KeyCache& keys);
+};
+
+// 并行加解密用的槽位环：每个槽位是连续的至多SEGMENTS_PER_SLOT个分段及该槽位专用的加密上下文，
+// 一批槽位由进程共享的线程池并行加密或解密（最多threads个线程）。
+// 分段格式的文件加解密和加解密流缓冲都通过它处理分段，单线程时只有一个槽位
+class SegmentRing {
+public:
+    struct Slot {
+        uint64_t firstIndex = 0;
+        std::vector<size_t> sizes;    // 各分段的明文大小
+        std::vector<uint8_t> plain;   // 明文，第k段位于 k * 分段大小
+        std::vector<uint8_t> sealed;  // 密文和标签，第k段位于 k * (分段大小 + TAG_SIZE)
+        std::unique_ptr<SegmentCipher> cipher;
+        bool ok = true;
+
+        // 除最后一段外都是满段，明文和密文在缓冲区中都是连续的
+        size_t plainBytes() const;
+        size_t sealedBytes() const { return plainBytes() + sizes.size() * Encryption::TAG_SIZE; }
+    };
+
+    SegmentRing(const std::vector<uint8_t>& key, const EncryptionHeader& header, size_t threads);
+
+    size_t size() const { return slots.size(); }
+
+    // 第i个槽位，保证其缓冲区至少能容纳segments个分段（为0时不扩大）；缓冲区和加密上下文在第一次使用时才分配
+    Slot& slot(size_t i, size_t segments = Encryption::SEGMENTS_PER_SLOT);
+
+    // 并行加密前count个槽位（明文 -> 密文），lastFinal为true时最后一个槽位的最后一段是末段
+    bool seal(size_t count, bool lastFinal);
+
+    // 并行解密并校验前count个槽位（密文 -> 明文），segmentCount用于判断末段
+    bool open(size_t count, uint64_t segmentCount);
+
+private:
+    std::vector<uint8_t> key;
+    EncryptionHeader header;
+    size_t threads;
+    std::vector<Slot> slots;
 };
@@ -6,6 +6,7 @@
 #include <sys/stat.h>   // 用于 mkfifo
 #include <cerrno>       // 用于 errno
 #include <cstring>      // 用于 strerror
+#include <algorithm>
 
 // Windows平台特定头文件
 #ifdef _WIN32
@@ -15,10 +16,129 @@
 #else
     #include <fcntl.h>  // 用于 utimensat
     #include <time.h>   // 用于 struct timespec
+    #include <unistd.h> // 用于 copy_file_range
+    #include <sys/mman.h> // 用于 mmap
 #endif
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// 流式复制时使用的缓冲区大小
+constexpr size_t EXTRACT_BUFFER_SIZE = 1024 * 1024;
+
+#ifdef __linux__
+// 用copy_file_range把包中的一段数据直接复制到输出文件，数据不经过用户态（btrfs/xfs上可共享数据块）
+// 文件系统或内核不支持时unsupported为true且没有写入任何数据，由调用方回退到流式复制
+bool copyPackageRange(int packageFd, uint64_t offset, uint64_t size, const std::string& outputPath,
+                      bool& unsupported) {
+    unsupported = false;
+    int outFd = ::open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (outFd < 0) {
+        std::cerr << "Error: Cannot create output file: " << outputPath << std::endl;
+        return false;
+    }
+
+    loff_t inOffset = static_cast<loff_t>(offset);
+    uint64_t remaining = size;
+    bool ok = true;
+    while (remaining > 0) {
+        ssize_t copied = ::copy_file_range(packageFd, &inOffset, outFd, nullptr, remaining, 0);
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        if (copied < 0 && remaining == size &&
+            (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+            unsupported = true;
+            ok = false;
+            break;
+        }
+        if (copied <= 0) {
+            std::cerr << "Error: Failed to read file data for " << outputPath << std::endl;
+            ok = false;
+            break;
+        }
+        remaining -= static_cast<uint64_t>(copied);
+    }
+
+    if (::close(outFd) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+#endif
+
+// 包中一个条目的内容范围，作为独立的输入流读取（解压时不需要先解出压缩文件）
+// 映射的包直接读内存；否则按需从包的输入流读取，定位只在范围内进行
+class PackageRangeBuf : public std::streambuf {
+public:
+    PackageRangeBuf(const char* content, uint64_t size)
+        : source(nullptr), offset(0), size(size), areaStart(0), buffer(nullptr) {
+        char* base = const_cast<char*>(content);
+        setg(base, base, base + size);
+    }
+
+    PackageRangeBuf(std::istream& source, uint64_t offset, uint64_t size, std::vector<char>& buffer)
+        : source(&source), offset(offset), size(size), areaStart(0), buffer(&buffer) {
+        if (buffer.empty()) {
+            buffer.resize(EXTRACT_BUFFER_SIZE);
+        }
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        uint64_t next = areaStart + static_cast<uint64_t>(egptr() - eback());
+        if (!source || next >= size) {
+            return traits_type::eof();
+        }
+        source->clear();
+        source->seekg(static_cast<std::streamoff>(offset + next), std::ios::beg);
+        source->read(buffer->data(), static_cast<std::streamsize>(std::min<uint64_t>(buffer->size(), size - next)));
+        std::streamsize got = source->gcount();
+        if (got <= 0) {
+            return traits_type::eof();
+        }
+        areaStart = next;
+        setg(buffer->data(), buffer->data(), buffer->data() + got);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        int64_t base = dir == std::ios_base::beg ? 0
+                     : dir == std::ios_base::end ? static_cast<int64_t>(size)
+                     : static_cast<int64_t>(areaStart + (gptr() - eback()));
+        int64_t target = base + off;
+        if (target < 0 || static_cast<uint64_t>(target) > size) {
+            return pos_type(off_type(-1));
+        }
+        if (source) {
+            // 丢弃当前缓冲的数据，下次读取时从目标位置开始
+            areaStart = static_cast<uint64_t>(target);
+            setg(buffer->data(), buffer->data(), buffer->data());
+        } else {
+            setg(eback(), eback() + target, egptr());
+        }
+        return pos_type(target);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+private:
+    std::istream* source;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t areaStart;  // 当前读取区首字节在范围内的位置
+    std::vector<char>* buffer;
+};
+
+} // namespace
+
 // 实现FileMetadata从File对象的构造函数
 FileMetadata::FileMetadata(const File& file, const std::filesystem::path& basePath) {
     // Calculate relative filename
@@ -67,13 +187,15 @@ FileMetadata::FileMetadata(const File& file, const std::filesystem::path& basePa
     }
 }
 
-FilePackager::FilePackager() {
+FilePackager::FilePackager() : indexStream(nullptr), indexFd(-1) {
 }
 
 FilePackager::~FilePackager() {
+    closeIndex();
 }
 
 // 实现新的packageFiles方法，处理File对象
+// 文件内容经PackageWriter用固定大小的缓冲区流式写入，内存占用与文件大小无关
 bool FilePackager::packageFiles(const std::vector<File>& inputFiles, const std::string& outputFile, const std::string& basePath) {
     try {
         std::ofstream outFile(outputFile, std::ios::binary);
@@ -82,58 +204,24 @@ bool FilePackager::packageFiles(const std::vector<File>& inputFiles, const std::
             return false;
         }
 
-        // 保留元数据的位置
-        uint64_t metadataOffset = 0;
-        outFile.write(reinterpret_cast<const char*>(&metadataOffset), sizeof(metadataOffset));
-
-        // 收集文件元数据
-        std::vector<FileMetadata> metadata;
-        uint64_t currentOffset = sizeof(metadataOffset);
-
         // 使用提供的basePath，默认为输出文件的父目录
         fs::path actualBasePath = basePath.empty() ? fs::path(outputFile).parent_path() : fs::path(basePath);
 
+        PackageWriter writer(outFile);
         for (const auto& file : inputFiles) {
-            // 创建文件元数据
-            FileMetadata fileMeta(file, actualBasePath);
-            fileMeta.offset = currentOffset;
-            
-            // 只有普通文件需要写入内容
-            if (file.isRegularFile()) {
-                // 确保文件数据已加载
-                File mutableFile = file;
-                if (!mutableFile.loadFileData()) {
-                    std::cerr << "Error: Cannot load file data for " << file.getFilePath() << std::endl;
-                    outFile.close();
-                    fs::remove(outputFile);
-                    return false;
-                }
-                
-                const auto& fileData = mutableFile.getFileData();
-                fileMeta.fileSize = fileData.size();
-                
-                // 写入文件内容
-                outFile.write(fileData.data(), fileData.size());
-                
-                // 更新偏移量
-                currentOffset += fileData.size();
+            if (!writer.addFile(file, file.getRelativePath(actualBasePath).string())) {
+                outFile.close();
+                fs::remove(outputFile);
+                return false;
             }
-            
-            metadata.push_back(fileMeta);
         }
 
-        // 写入元数据
-        uint64_t actualMetadataOffset = outFile.tellp();
-        if (!writeMetadata(metadata, outFile)) {
+        if (!writer.finish()) {
             outFile.close();
             fs::remove(outputFile);
             return false;
         }
 
-        // 更新元数据偏移量
-        outFile.seekp(0, std::ios::beg);
-        outFile.write(reinterpret_cast<const char*>(&actualMetadataOffset), sizeof(actualMetadataOffset));
-
         outFile.close();
         std::cout << "Packaging completed successfully!" << std::endl;
         return true;
@@ -202,16 +290,9 @@ std::vector<File> FilePackager::unpackFilesToFiles(const std::string& inputFile,
             return files;
         }
         
-        // Read metadata offset
-        uint64_t metadataOffset = 0;
-        inFile.read(reinterpret_cast<char*>(&metadataOffset), sizeof(metadataOffset));
-        
-        // Seek to metadata
-        inFile.seekg(metadataOffset, std::ios::beg);
-        
         // Read metadata
         std::vector<FileMetadata> metadata;
-        if (!readMetadata(inFile, metadata)) {
+        if (!readIndex(inFile, metadata)) {
             inFile.close();
             return files;
         }
@@ -234,221 +315,332 @@ std::vector<File> FilePackager::unpackFilesToFiles(const std::string& inputFile,
 
 
 bool FilePackager::unpackFiles(const std::string& inputFile, const std::string& outputDir) {
-    try {
-        std::ifstream inFile(inputFile, std::ios::binary);
-        if (!inFile) {
-            std::cerr << "Error: Cannot open input file: " << inputFile << std::endl;
+    std::ifstream inFile(inputFile, std::ios::binary);
+    if (!inFile) {
+        std::cerr << "Error: Cannot open input file: " << inputFile << std::endl;
+        return false;
+    }
+
+    // 包是普通文件时文件内容可以在内核中直接复制
+    int packageFd = -1;
+#ifdef __linux__
+    packageFd = ::open(inputFile.c_str(), O_RDONLY);
+#endif
+    bool result = unpackFiles(inFile, outputDir, packageFd);
+#ifdef __linux__
+    if (packageFd >= 0) {
+        ::close(packageFd);
+    }
+#endif
+    return result;
+}
+
+bool FilePackager::unpackFiles(std::istream& inFile, const std::string& outputDir) {
+    return unpackFiles(inFile, outputDir, -1);
+}
+
+bool FilePackager::extractContent(std::istream* inFile, int packageFd, const char* content,
+                                  const FileMetadata& fileMeta, const std::string& outputPath,
+                                  std::vector<char>& buffer) {
+#ifdef __linux__
+    if (packageFd >= 0) {
+        bool unsupported = false;
+        if (copyPackageRange(packageFd, fileMeta.offset, fileMeta.fileSize, outputPath, unsupported)) {
+            return true;
+        }
+        if (!unsupported) {
+            return false;
+        }
+    }
+#else
+    (void)packageFd;
+#endif
+
+    if (content) {
+        // 内容已映射，直接写出
+        std::ofstream outFile(outputPath, std::ios::binary);
+        if (!outFile) {
+            std::cerr << "Error: Cannot create output file: " << outputPath << std::endl;
             return false;
         }
+        outFile.write(content, static_cast<std::streamsize>(fileMeta.fileSize));
+        outFile.close();
+        return static_cast<bool>(outFile);
+    }
+    if (!inFile) {
+        std::cerr << "Error: Failed to read file data for " << outputPath << std::endl;
+        return false;
+    }
 
-        // 读取元数据偏移量
-        uint64_t metadataOffset = 0;
-        inFile.read(reinterpret_cast<char*>(&metadataOffset), sizeof(metadataOffset));
+    std::ofstream outFile(outputPath, std::ios::binary);
+    if (!outFile) {
+        std::cerr << "Error: Cannot create output file: " << outputPath << std::endl;
+        return false;
+    }
 
-        // 跳转到元数据位置
-        inFile.seekg(metadataOffset, std::ios::beg);
+    // 跳转到文件数据位置
+    inFile->clear();
+    inFile->seekg(fileMeta.offset, std::ios::beg);
 
-        // 读取元数据
-        std::vector<FileMetadata> metadata;
-        if (!readMetadata(inFile, metadata)) {
-            inFile.close();
+    // 读取并写入文件内容，缓冲区在整个解包过程中复用
+    if (buffer.empty()) {
+        buffer.resize(EXTRACT_BUFFER_SIZE);
+    }
+    uint64_t bytesRead = 0;
+    while (bytesRead < fileMeta.fileSize) {
+        uint64_t bytesToRead = std::min<uint64_t>(buffer.size(), fileMeta.fileSize - bytesRead);
+        inFile->read(buffer.data(), bytesToRead);
+        outFile.write(buffer.data(), inFile->gcount());
+        bytesRead += inFile->gcount();
+        
+        // 检查读取错误
+        if (!*inFile) {
+            std::cerr << "Error: Failed to read file data for " << outputPath << std::endl;
             return false;
         }
+    }
 
-        // 创建输出目录
-        fs::create_directories(outputDir);
+    outFile.close();
+    return static_cast<bool>(outFile);
+}
 
-        // 解包每个文件
-        for (const auto& fileMeta : metadata) {
-            std::string outputPath = (fs::path(outputDir) / fileMeta.filename).string();
-            fs::path outputFsPath(outputPath);
-            std::error_code ec;
-            
-            // 创建文件的父目录
-            fs::path parentDir = outputFsPath.parent_path();
-            if (!parentDir.empty()) {
-                fs::create_directories(parentDir, ec);
-                if (ec) {
-                    std::cerr << "Error: Cannot create directory: " << parentDir 
-                              << " (" << ec.message() << ")" << std::endl;
-                    inFile.close();
-                    return false;
-                }
+bool FilePackager::extractDecompressed(std::istream* inFile, const char* content, const FileMetadata& fileMeta,
+                                       const std::string& outputPath, std::vector<char>& buffer) {
+    if (!content && !inFile) {
+        std::cerr << "Error: Failed to read file data for " << outputPath << std::endl;
+        return false;
+    }
+    std::unique_ptr<PackageRangeBuf> range(content ? new PackageRangeBuf(content, fileMeta.fileSize)
+                                                   : new PackageRangeBuf(*inFile, fileMeta.offset,
+                                                                         fileMeta.fileSize, buffer));
+    std::istream rangeStream(range.get());
+    std::ofstream outFile(outputPath, std::ios::binary);
+    if (!outFile) {
+        std::cerr << "Error: Cannot create output file: " << outputPath << std::endl;
+        return false;
+    }
+    if (!Codec::decompressStream(rangeStream, outFile)) {
+        std::cerr << "Error: Failed to decompress " << fileMeta.filename << std::endl;
+        return false;
+    }
+    outFile.close();
+    return static_cast<bool>(outFile);
+}
+
+bool FilePackager::extractEntry(std::istream* inFile, int packageFd, const char* content,
+                                const FileMetadata& fileMeta, const std::string& outputDir,
+                                std::vector<char>& buffer, bool decompress,
+                                std::vector<FileMetadata>* directories) {
+    std::string outputPath = (fs::path(outputDir) / fileMeta.filename).string();
+    // 解压的条目写到去掉压缩扩展名的路径；是否压缩以条目的标志为准，原始文件本身可能就叫notes.lz
+    decompress = decompress && fileMeta.fileType == 0 && fileMeta.isCompressed;
+    if (decompress) {
+        outputPath = Codec::stripCompressedExtension(outputPath);
+    }
+    fs::path outputFsPath(outputPath);
+    std::error_code ec;
+    
+    // 创建文件的父目录
+    fs::path parentDir = outputFsPath.parent_path();
+    if (!parentDir.empty()) {
+        fs::create_directories(parentDir, ec);
+        if (ec) {
+            std::cerr << "Error: Cannot create directory: " << parentDir 
+                      << " (" << ec.message() << ")" << std::endl;
+            return false;
+        }
+    }
+    
+    // 根据文件类型处理
+    if (fileMeta.fileType == 0) {
+        // 普通文件
+        bool extractedOk = decompress ? extractDecompressed(inFile, content, fileMeta, outputPath, buffer)
+                                      : extractContent(inFile, packageFd, content, fileMeta, outputPath, buffer);
+        if (!extractedOk) {
+            return false;
+        }
+    } else if (fileMeta.fileType == 1) {
+        // 目录
+        fs::create_directories(outputFsPath, ec);
+        if (ec) {
+            std::cerr << "Error: Cannot create directory: " << outputPath 
+                      << " (" << ec.message() << ")" << std::endl;
+            return false;
+        }
+        // 目录的权限和时间戳在其中的条目全部解出后再恢复
+        if (directories) {
+            directories->push_back(fileMeta);
+            return true;
+        }
+    } else if (fileMeta.fileType == 2) {
+        // 符号链接
+        // 在创建符号链接前确保目标文件/目录不存在
+        if (fs::exists(outputFsPath, ec)) {
+            fs::remove(outputFsPath, ec);
+        }
+        fs::create_symlink(fileMeta.symlinkTarget, outputFsPath, ec);
+        if (ec) {
+            std::cerr << "Error: Cannot create symlink: " << outputPath 
+                      << " -> " << fileMeta.symlinkTarget 
+                      << " (" << ec.message() << ")" << std::endl;
+            return false;
+        }
+    } else if (fileMeta.fileType == 3) {
+        // FIFO文件（命名管道）
+        #ifdef _WIN32
+            // Windows不支持直接创建类似Unix的命名管道文件
+            std::cerr << "Warning: FIFO files are not supported on Windows, skipping " 
+                      << outputPath << std::endl;
+        #else
+            // 删除已存在的文件
+            if (fs::exists(outputFsPath, ec)) {
+                fs::remove(outputFsPath, ec);
             }
-            
-            // 根据文件类型处理
-            if (fileMeta.fileType == 0) {
-                // 普通文件
-                std::ofstream outFile(outputPath, std::ios::binary);
-                if (!outFile) {
-                    std::cerr << "Error: Cannot create output file: " << outputPath << std::endl;
-                    inFile.close();
-                    return false;
-                }
+            // 创建FIFO文件
+            if (mkfifo(outputPath.c_str(), 0666) != 0) {
+                std::cerr << "Error: Failed to create FIFO " << outputPath 
+                          << " (" << strerror(errno) << ")" << std::endl;
+                // 继续执行，不中断整个解包过程
+            }
+        #endif
+    } else {
+        std::cerr << "Warning: Unknown file type " << fileMeta.fileType 
+                  << " for file " << outputPath << ", skipping..." << std::endl;
+        return true;
+    }
+    
+    restoreAttributes(fileMeta, outputPath);
+    return true;
+}
 
-                // 跳转到文件数据位置
-                inFile.seekg(fileMeta.offset, std::ios::beg);
-
-                // 读取并写入文件内容
-                char buffer[8192];
-                uint64_t bytesRead = 0;
-                while (bytesRead < fileMeta.fileSize) {
-                    uint64_t bytesToRead = std::min<uint64_t>(sizeof(buffer), 
-                                                              fileMeta.fileSize - bytesRead);
-                    inFile.read(buffer, bytesToRead);
-                    outFile.write(buffer, inFile.gcount());
-                    bytesRead += inFile.gcount();
-                    
-                    // 检查读取错误
-                    if (!inFile) {
-                        std::cerr << "Error: Failed to read file data for " << outputPath << std::endl;
-                        outFile.close();
-                        inFile.close();
-                        return false;
-                    }
-                }
+void FilePackager::restoreDirectories(std::vector<FileMetadata>& directories, const std::string& outputDir) {
+    // 子目录先于父目录处理，写入子目录不会再改变父目录的时间戳
+    std::sort(directories.begin(), directories.end(), [](const FileMetadata& a, const FileMetadata& b) {
+        return a.filename > b.filename;
+    });
+    for (const auto& fileMeta : directories) {
+        restoreAttributes(fileMeta, (fs::path(outputDir) / fileMeta.filename).string());
+    }
+    directories.clear();
+}
 
-                outFile.close();
-            } else if (fileMeta.fileType == 1) {
-                // 目录
-                fs::create_directories(outputFsPath, ec);
-                if (ec) {
-                    std::cerr << "Error: Cannot create directory: " << outputPath 
-                              << " (" << ec.message() << ")" << std::endl;
-                    inFile.close();
-                    return false;
-                }
-            } else if (fileMeta.fileType == 2) {
-                // 符号链接
-                // 在创建符号链接前确保目标文件/目录不存在
-                if (fs::exists(outputFsPath, ec)) {
-                    fs::remove(outputFsPath, ec);
-                }
-                fs::create_symlink(fileMeta.symlinkTarget, outputFsPath, ec);
-                if (ec) {
-                    std::cerr << "Error: Cannot create symlink: " << outputPath 
-                              << " -> " << fileMeta.symlinkTarget 
-                              << " (" << ec.message() << ")" << std::endl;
-                    inFile.close();
-                    return false;
-                }
-            } else if (fileMeta.fileType == 3) {
-                // FIFO文件（命名管道）
-                #ifdef _WIN32
-                    // Windows不支持直接创建类似Unix的命名管道文件
-                    std::cerr << "Warning: FIFO files are not supported on Windows, skipping " 
-                              << outputPath << std::endl;
-                #else
-                    // 删除已存在的文件
-                    if (fs::exists(outputFsPath, ec)) {
-                        fs::remove(outputFsPath, ec);
-                    }
-                    // 创建FIFO文件
-                    if (mkfifo(outputPath.c_str(), 0666) != 0) {
-                        std::cerr << "Error: Failed to create FIFO " << outputPath 
-                                  << " (" << strerror(errno) << ")" << std::endl;
-                        // 继续执行，不中断整个解包过程
-                    }
-                #endif
-            } else {
-                std::cerr << "Warning: Unknown file type " << fileMeta.fileType 
-                          << " for file " << outputPath << ", skipping..." << std::endl;
-                continue;
-            }
+void FilePackager::restoreAttributes(const FileMetadata& fileMeta, const std::string& outputPath) {
+    fs::path outputFsPath(outputPath);
+    std::error_code ec;
+    
+    // 恢复文件权限（不适用于符号链接，因为符号链接没有独立的权限）
+    if (fileMeta.fileType != 2) {  // 不是符号链接
+        fs::permissions(outputFsPath, fs::perms(fileMeta.permissions), 
+                        fs::perm_options::replace, ec);
+        if (ec) {
+            std::cerr << "Warning: Cannot set permissions for " << outputPath 
+                      << " (" << ec.message() << ")" << std::endl;
+        }
+    }
+    
+    // 恢复文件时间戳
+    // 注意：使用平台特定的API来设置文件时间，避免时钟系统差异导致的问题
+    // 普通文件、目录和符号链接都需要恢复时间戳
+    if (fileMeta.fileType == 0 || fileMeta.fileType == 1 || fileMeta.fileType == 2) {  // 普通文件、目录和符号链接
+        try {
+            // 确保时间戳有效（避免1901年问题）
+            // 转换Unix时间戳为time_t，Unix时间戳已经是UTC时间，不需要再转换
+            time_t creationTime = static_cast<time_t>(fileMeta.creationTime);
+            time_t lastAccessTime = static_cast<time_t>(fileMeta.lastAccessTime);
+            time_t lastModifiedTime = static_cast<time_t>(fileMeta.lastModifiedTime);
             
-            // 恢复文件权限（不适用于符号链接，因为符号链接没有独立的权限）
-            if (fileMeta.fileType != 2) {  // 不是符号链接
-                fs::permissions(outputFsPath, fs::perms(fileMeta.permissions), 
-                                fs::perm_options::replace, ec);
-                if (ec) {
-                    std::cerr << "Warning: Cannot set permissions for " << outputPath 
-                              << " (" << ec.message() << ")" << std::endl;
-                }
-            }
+            // 如果时间戳为0（1970-01-01），使用当前时间作为默认值
+            if (fileMeta.creationTime == 0) creationTime = time(nullptr);
+            if (fileMeta.lastAccessTime == 0) lastAccessTime = time(nullptr);
+            if (fileMeta.lastModifiedTime == 0) lastModifiedTime = time(nullptr);
             
-            // 恢复文件时间戳
-            // 注意：使用平台特定的API来设置文件时间，避免时钟系统差异导致的问题
-            // 普通文件、目录和符号链接都需要恢复时间戳
-            if (fileMeta.fileType == 0 || fileMeta.fileType == 1 || fileMeta.fileType == 2) {  // 普通文件、目录和符号链接
-                try {
-                    // 确保时间戳有效（避免1901年问题）
-                    // 转换Unix时间戳为time_t，Unix时间戳已经是UTC时间，不需要再转换
-                    time_t creationTime = static_cast<time_t>(fileMeta.creationTime);
-                    time_t lastAccessTime = static_cast<time_t>(fileMeta.lastAccessTime);
-                    time_t lastModifiedTime = static_cast<time_t>(fileMeta.lastModifiedTime);
+            #ifdef _WIN32
+                // Windows平台实现：使用Windows API直接设置文件时间
+                HANDLE hFile = CreateFileA(outputPath.c_str(), FILE_WRITE_ATTRIBUTES, 0, NULL, 
+                                         OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+                if (hFile != INVALID_HANDLE_VALUE) {
+                    FILETIME ftCreation, ftAccess, ftWrite;
+                    SYSTEMTIME st;
+                    
+                    // 将时间戳直接转换为FILETIME，不经过localtime_s，避免时区问题
+                    // Unix时间戳是从1970-01-01 00:00:00 UTC开始的秒数
+                    // FILETIME是从1601-01-01 00:00:00 UTC开始的100纳秒间隔数
+                    const uint64_t FILETIME_EPOCH_DIFF = 11644473600ULL; // 1970-01-01到1601-01-01的秒数
                     
-                    // 如果时间戳为0（1970-01-01），使用当前时间作为默认值
-                    if (fileMeta.creationTime == 0) creationTime = time(nullptr);
-                    if (fileMeta.lastAccessTime == 0) lastAccessTime = time(nullptr);
-                    if (fileMeta.lastModifiedTime == 0) lastModifiedTime = time(nullptr);
+                    // 转换创建时间
+                    uint64_t creationFileTime = (static_cast<uint64_t>(creationTime) + FILETIME_EPOCH_DIFF) * 10000000ULL;
+                    ftCreation.dwLowDateTime = static_cast<DWORD>(creationFileTime);
+                    ftCreation.dwHighDateTime = static_cast<DWORD>(creationFileTime >> 32);
                     
-                    #ifdef _WIN32
-                        // Windows平台实现：使用Windows API直接设置文件时间
-                        HANDLE hFile = CreateFileA(outputPath.c_str(), FILE_WRITE_ATTRIBUTES, 0, NULL, 
-                                                 OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
-                        if (hFile != INVALID_HANDLE_VALUE) {
-                            FILETIME ftCreation, ftAccess, ftWrite;
-                            SYSTEMTIME st;
-                            
-                            // 将时间戳直接转换为FILETIME，不经过localtime_s，避免时区问题
-                            // Unix时间戳是从1970-01-01 00:00:00 UTC开始的秒数
-                            // FILETIME是从1601-01-01 00:00:00 UTC开始的100纳秒间隔数
-                            const uint64_t FILETIME_EPOCH_DIFF = 11644473600ULL; // 1970-01-01到1601-01-01的秒数
-                            
-                            // 转换创建时间
-                            uint64_t creationFileTime = (static_cast<uint64_t>(creationTime) + FILETIME_EPOCH_DIFF) * 10000000ULL;
-                            ftCreation.dwLowDateTime = static_cast<DWORD>(creationFileTime);
-                            ftCreation.dwHighDateTime = static_cast<DWORD>(creationFileTime >> 32);
-                            
-                            // 转换访问时间
-                            uint64_t accessFileTime = (static_cast<uint64_t>(lastAccessTime) + FILETIME_EPOCH_DIFF) * 10000000ULL;
-                            ftAccess.dwLowDateTime = static_cast<DWORD>(accessFileTime);
-                            ftAccess.dwHighDateTime = static_cast<DWORD>(accessFileTime >> 32);
-                            
-                            // 转换修改时间
-                            uint64_t writeFileTime = (static_cast<uint64_t>(lastModifiedTime) + FILETIME_EPOCH_DIFF) * 10000000ULL;
-                            ftWrite.dwLowDateTime = static_cast<DWORD>(writeFileTime);
-                            ftWrite.dwHighDateTime = static_cast<DWORD>(writeFileTime >> 32);
-                            
-                            // 分别设置创建时间、访问时间和修改时间
-                            SetFileTime(hFile, &ftCreation, &ftAccess, &ftWrite);
-                            
-                            CloseHandle(hFile);
-                        }
-                    #else
-                        // Linux/Unix平台实现：使用utimensat函数直接设置文件时间
-                        struct timespec times[2];
-                        
-                        // 设置访问时间和修改时间
-                        times[0].tv_sec = lastAccessTime;  // 访问时间(atime)
-                        times[0].tv_nsec = 0;
-                        times[1].tv_sec = lastModifiedTime;  // 修改时间(mtime)
-                        times[1].tv_nsec = 0;
-                        
-                        // 使用utimensat函数设置文件时间，0表示使用当前工作目录
-                        // 对于符号链接，需要使用AT_SYMLINK_NOFOLLOW标志，不跟随符号链接
-                        int flags = 0;
-                        if (fileMeta.fileType == 2) {
-                            flags = AT_SYMLINK_NOFOLLOW;
-                        }
-                        
-                        if (utimensat(0, outputPath.c_str(), times, flags) != 0) {
-                            std::cerr << "Warning: Cannot set file times for " << outputPath 
-                                      << " (" << strerror(errno) << ")" << std::endl;
-                        }
-                        
-                        // 注意：Linux不支持直接设置文件创建时间，需要使用其他方法
-                        // 这里不处理创建时间，因为Linux上没有标准API支持
-                    #endif
+                    // 转换访问时间
+                    uint64_t accessFileTime = (static_cast<uint64_t>(lastAccessTime) + FILETIME_EPOCH_DIFF) * 10000000ULL;
+                    ftAccess.dwLowDateTime = static_cast<DWORD>(accessFileTime);
+                    ftAccess.dwHighDateTime = static_cast<DWORD>(accessFileTime >> 32);
                     
-                } catch (const std::exception& e) {
-                    std::cerr << "Warning: Failed to set timestamp for " << outputPath 
-                              << " (" << e.what() << ")" << std::endl;
+                    // 转换修改时间
+                    uint64_t writeFileTime = (static_cast<uint64_t>(lastModifiedTime) + FILETIME_EPOCH_DIFF) * 10000000ULL;
+                    ftWrite.dwLowDateTime = static_cast<DWORD>(writeFileTime);
+                    ftWrite.dwHighDateTime = static_cast<DWORD>(writeFileTime >> 32);
+                    
+                    // 分别设置创建时间、访问时间和修改时间
+                    SetFileTime(hFile, &ftCreation, &ftAccess, &ftWrite);
+                    
+                    CloseHandle(hFile);
                 }
+            #else
+                // Linux/Unix平台实现：使用utimensat函数直接设置文件时间
+                struct timespec times[2];
+                
+                // 设置访问时间和修改时间
+                times[0].tv_sec = lastAccessTime;  // 访问时间(atime)
+                times[0].tv_nsec = 0;
+                times[1].tv_sec = lastModifiedTime;  // 修改时间(mtime)
+                times[1].tv_nsec = 0;
+                
+                // 使用utimensat函数设置文件时间，0表示使用当前工作目录
+                // 对于符号链接，需要使用AT_SYMLINK_NOFOLLOW标志，不跟随符号链接
+                int flags = 0;
+                if (fileMeta.fileType == 2) {
+                    flags = AT_SYMLINK_NOFOLLOW;
+                }
+                
+                if (utimensat(0, outputPath.c_str(), times, flags) != 0) {
+                    std::cerr << "Warning: Cannot set file times for " << outputPath 
+                              << " (" << strerror(errno) << ")" << std::endl;
+                }
+                
+                // 注意：Linux不支持直接设置文件创建时间，需要使用其他方法
+                // 这里不处理创建时间，因为Linux上没有标准API支持
+            #endif
+            
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: Failed to set timestamp for " << outputPath 
+                      << " (" << e.what() << ")" << std::endl;
+        }
+    }
+}
+
+bool FilePackager::unpackFiles(std::istream& inFile, const std::string& outputDir, int packageFd) {
+    try {
+        // 读取元数据
+        std::vector<FileMetadata> metadata;
+        if (!readIndex(inFile, metadata)) {
+            return false;
+        }
+
+        // 创建输出目录
+        fs::create_directories(outputDir);
+        std::vector<char> buffer;
+        std::vector<FileMetadata> directories;
+
+        // 解包每个文件，目录的权限和时间戳最后恢复
+        for (const auto& fileMeta : metadata) {
+            if (!extractEntry(&inFile, packageFd, nullptr, fileMeta, outputDir, buffer, false, &directories)) {
+                return false;
             }
         }
+        restoreDirectories(directories, outputDir);
 
-        inFile.close();
         std::cout << "Unpacking completed successfully!" << std::endl;
         return true;
 
@@ -458,7 +650,7 @@ bool FilePackager::unpackFiles(const std::string& inputFile, const std::string&
     }
 }
 
-bool FilePackager::writeMetadata(const std::vector<FileMetadata>& metadata, std::ofstream& outFile) {
+bool FilePackager::writeMetadata(const std::vector<FileMetadata>& metadata, std::ostream& outFile) {
     try {
         // 写入元数据数量
         uint32_t metadataCount = metadata.size();
@@ -502,11 +694,73 @@ bool FilePackager::writeMetadata(const std::vector<FileMetadata>& metadata, std:
     }
 }
 
-bool FilePackager::readMetadata(std::ifstream& inFile, std::vector<FileMetadata>& metadata) {
+bool FilePackager::readIndex(std::istream& inFile, std::vector<FileMetadata>& metadata) {
+    char head[sizeof(PACKAGE_V2_MAGIC)];
+    inFile.read(head, sizeof(head));
+    if (!inFile) {
+        std::cerr << "Error: Invalid package header" << std::endl;
+        return false;
+    }
+    if (std::memcmp(head, PACKAGE_V2_MAGIC, sizeof(head)) == 0) {
+        return readEntryTable(inFile, metadata);
+    }
+
+    // v1：文件头是元数据偏移
+    uint64_t metadataOffset = 0;
+    std::memcpy(&metadataOffset, head, sizeof(metadataOffset));
+    inFile.seekg(metadataOffset, std::ios::beg);
+    return readMetadata(inFile, metadata);
+}
+
+bool FilePackager::readEntryTable(std::istream& inFile, std::vector<FileMetadata>& metadata) {
+    // 包尾记录条目表和字符串池的位置
+    inFile.seekg(0, std::ios::end);
+    std::streamoff packageSize = inFile.tellg();
+    PackageTrailer trailer;
+    if (packageSize < static_cast<std::streamoff>(sizeof(PACKAGE_V2_MAGIC) + sizeof(trailer))) {
+        std::cerr << "Error: Package is truncated" << std::endl;
+        return false;
+    }
+    inFile.seekg(packageSize - static_cast<std::streamoff>(sizeof(trailer)), std::ios::beg);
+    inFile.read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+    if (!inFile || !trailer.isValid(static_cast<uint64_t>(packageSize))) {
+        std::cerr << "Error: Invalid package trailer" << std::endl;
+        return false;
+    }
+
+    // 条目表和字符串池各一次读取
+    std::vector<PackageEntry> entries(trailer.entryCount);
+    std::string pool(trailer.poolSize, '\0');
+    inFile.seekg(trailer.tableOffset, std::ios::beg);
+    inFile.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(PackageEntry));
+    inFile.seekg(trailer.poolOffset, std::ios::beg);
+    inFile.read(&pool[0], pool.size());
+    if (!inFile) {
+        std::cerr << "Error reading metadata: unexpected end of data" << std::endl;
+        return false;
+    }
+
+    metadata.clear();
+    metadata.reserve(entries.size());
+    for (const auto& entry : entries) {
+        if (!entry.isValid(trailer)) {
+            std::cerr << "Error: Invalid package entry" << std::endl;
+            return false;
+        }
+        metadata.push_back(entry.toMetadata(pool.data()));
+    }
+    return true;
+}
+
+bool FilePackager::readMetadata(std::istream& inFile, std::vector<FileMetadata>& metadata) {
     try {
         // 读取元数据数量
         uint32_t metadataCount = 0;
         inFile.read(reinterpret_cast<char*>(&metadataCount), sizeof(metadataCount));
+        if (!inFile) {
+            std::cerr << "Error reading metadata: unexpected end of data" << std::endl;
+            return false;
+        }
 
         // 读取每个文件的元数据
         for (uint32_t i = 0; i < metadataCount; i++) {
@@ -543,6 +797,12 @@ bool FilePackager::readMetadata(std::ifstream& inFile, std::vector<FileMetadata>
                 inFile.read(&fileMeta.symlinkTarget[0], symlinkTargetLength);
             }
 
+            // 读取失败（数据截断或解密流认证失败）
+            if (!inFile) {
+                std::cerr << "Error reading metadata: unexpected end of data" << std::endl;
+                return false;
+            }
+
             metadata.push_back(fileMeta);
         }
 
@@ -552,4 +812,469 @@ bool FilePackager::readMetadata(std::ifstream& inFile, std::vector<FileMetadata>
         std::cerr << "Error reading metadata: " << e.what() << std::endl;
         return false;
     }
-}
\ No newline at end of file
+}
+
+PackageWriter::PackageWriter(std::ostream& out)
+    : out(out), buffer(64 * 1024), started(false), finished(false) {
+}
+
+bool PackageWriter::start() {
+    if (started) {
+        return static_cast<bool>(out);
+    }
+    started = true;
+    // 条目偏移按输出流位置计算，包必须从流的起始处开始写
+    if (out.tellp() != std::streampos(0)) {
+        std::cerr << "Error: Package must start at the beginning of the output stream" << std::endl;
+        out.setstate(std::ios::failbit);
+        return false;
+    }
+    out.write(PACKAGE_V2_MAGIC, sizeof(PACKAGE_V2_MAGIC));
+    return static_cast<bool>(out);
+}
+
+FileMetadata PackageWriter::makeMetadata(const File& file, const std::string& entryName) const {
+    FileMetadata fileMeta(file, file.getFilePath().parent_path());
+    fileMeta.filename = entryName;
+    fileMeta.offset = static_cast<uint64_t>(out.tellp());
+    fileMeta.fileSize = 0;
+    // 按原样写入的内容不是压缩数据，即使文件名带.huff等扩展名；addCompressedFile写入后再置位
+    fileMeta.isCompressed = false;
+    return fileMeta;
+}
+
+bool PackageWriter::addFile(const File& file, const std::string& entryName) {
+    if (finished || !start()) {
+        return false;
+    }
+    FileMetadata fileMeta = makeMetadata(file, entryName);
+    
+    // 只有普通文件需要写入内容
+    if (file.isRegularFile()) {
+        std::ifstream inFile(file.getFilePath(), std::ios::binary);
+        if (!inFile) {
+            std::cerr << "Error: Cannot open file: " << file.getFilePath() << std::endl;
+            return false;
+        }
+        while (inFile) {
+            inFile.read(buffer.data(), buffer.size());
+            std::streamsize bytesRead = inFile.gcount();
+            if (bytesRead > 0 && !out.write(buffer.data(), bytesRead)) {
+                std::cerr << "Error: Failed to write package data for " << file.getFilePath() << std::endl;
+                return false;
+            }
+            fileMeta.fileSize += static_cast<uint64_t>(bytesRead);
+        }
+        if (inFile.bad()) {
+            std::cerr << "Error: Failed to read file: " << file.getFilePath() << std::endl;
+            return false;
+        }
+    }
+    
+    metadata.push_back(fileMeta);
+    return true;
+}
+
+bool PackageWriter::addCompressedFile(const File& file, const std::string& entryName, CodecId codec,
+                                      uint64_t& compressedSize) {
+    if (!file.isRegularFile()) {
+        compressedSize = 0;
+        return addFile(file, entryName);
+    }
+    if (finished || !start()) {
+        return false;
+    }
+    FileMetadata fileMeta = makeMetadata(file, entryName + Codec::extensionOf(codec));
+    
+    std::ifstream inFile(file.getFilePath(), std::ios::binary);
+    if (!inFile) {
+        std::cerr << "Error: Cannot open file: " << file.getFilePath() << std::endl;
+        return false;
+    }
+    if (!Codec::compressStream(codec, inFile, out)) {
+        std::cerr << "Error: Failed to compress " << file.getFilePath() << " into package" << std::endl;
+        return false;
+    }
+    
+    compressedSize = static_cast<uint64_t>(out.tellp()) - fileMeta.offset;
+    fileMeta.fileSize = compressedSize;
+    fileMeta.isCompressed = true;
+    metadata.push_back(fileMeta);
+    return true;
+}
+
+bool PackageWriter::finish() {
+    if (finished || !start()) {
+        return false;
+    }
+    finished = true;
+    
+    // 条目表按名称排序，读取时可以二分查找
+    std::vector<const FileMetadata*> sorted;
+    sorted.reserve(metadata.size());
+    for (const auto& fileMeta : metadata) {
+        sorted.push_back(&fileMeta);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const FileMetadata* a, const FileMetadata* b) {
+        return a->filename < b->filename;
+    });
+    
+    std::vector<PackageEntry> entries;
+    entries.reserve(sorted.size());
+    std::string pool;
+    for (const FileMetadata* fileMeta : sorted) {
+        if (pool.size() + fileMeta->filename.size() + fileMeta->symlinkTarget.size() > UINT32_MAX) {
+            std::cerr << "Error: Package string pool exceeds 4 GiB" << std::endl;
+            return false;
+        }
+        entries.push_back(PackageEntry::fromMetadata(*fileMeta, pool));
+    }
+    
+    // 条目表8字节对齐，映射后可以直接按结构体访问
+    PackageTrailer trailer;
+    uint64_t position = static_cast<uint64_t>(out.tellp());
+    static const char padding[PACKAGE_ALIGNMENT] = {};
+    out.write(padding, static_cast<std::streamsize>((PACKAGE_ALIGNMENT - position % PACKAGE_ALIGNMENT) % PACKAGE_ALIGNMENT));
+    trailer.tableOffset = static_cast<uint64_t>(out.tellp());
+    trailer.entryCount = entries.size();
+    trailer.poolOffset = trailer.tableOffset + entries.size() * sizeof(PackageEntry);
+    trailer.poolSize = pool.size();
+    std::memcpy(trailer.magic, PACKAGE_V2_MAGIC, sizeof(trailer.magic));
+    
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackageEntry));
+    out.write(pool.data(), pool.size());
+    out.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+void FilePackager::closeIndex() {
+#ifdef __linux__
+    if (indexFd >= 0) {
+        ::close(indexFd);
+    }
+#endif
+    indexFd = -1;
+    indexStream = nullptr;
+    indexFile.reset();
+    mapped.reset();
+    index.clear();
+    indexByName.clear();
+}
+
+bool FilePackager::loadIndex(const std::string& inputFile) {
+    closeIndex();
+    // v2包直接映射条目表；v1包和映射失败时回退到读入索引
+    std::unique_ptr<MappedPackage> package(new MappedPackage());
+    if (package->open(inputFile)) {
+        mapped = std::move(package);
+    } else {
+        std::unique_ptr<std::ifstream> inFile(new std::ifstream(inputFile, std::ios::binary));
+        if (!*inFile) {
+            std::cerr << "Error: Cannot open input file: " << inputFile << std::endl;
+            return false;
+        }
+        if (!loadIndex(*inFile)) {
+            return false;
+        }
+        indexFile = std::move(inFile);
+    }
+#ifdef __linux__
+    indexFd = ::open(inputFile.c_str(), O_RDONLY);
+#endif
+    return true;
+}
+
+bool FilePackager::loadIndex(std::istream& inFile) {
+    closeIndex();
+    try {
+        if (!readIndex(inFile, index)) {
+            index.clear();
+            return false;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error reading package index: " << e.what() << std::endl;
+        index.clear();
+        return false;
+    }
+
+    for (size_t i = 0; i < index.size(); ++i) {
+        indexByName[index[i].filename] = i;
+    }
+    indexStream = &inFile;
+    return true;
+}
+
+size_t FilePackager::getEntryCount() const {
+    return mapped ? mapped->getEntryCount() : index.size();
+}
+
+bool FilePackager::findEntry(const std::string& filename, FileMetadata& entry) const {
+    if (mapped) {
+        const PackageEntry* found = mapped->find(filename);
+        return found && mapped->toMetadata(*found, entry);
+    }
+    auto it = indexByName.find(filename);
+    if (it == indexByName.end()) {
+        return false;
+    }
+    entry = index[it->second];
+    return true;
+}
+
+File FilePackager::entryToFile(const FileMetadata& metadata) {
+    static const fs::file_type types[] = {
+        fs::file_type::regular, fs::file_type::directory, fs::file_type::symlink, fs::file_type::fifo,
+        fs::file_type::character, fs::file_type::block, fs::file_type::socket,
+    };
+    fs::file_type type = metadata.fileType < sizeof(types) / sizeof(types[0]) ? types[metadata.fileType]
+                                                                              : fs::file_type::unknown;
+    auto fromUnixTime = [](uint64_t seconds) {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+    };
+    std::string name = metadata.isCompressed ? Codec::stripCompressedExtension(metadata.filename)
+                                             : metadata.filename;
+    return File::fromMetadata(name, type, metadata.fileSize,
+                              metadata.permissions, fromUnixTime(metadata.creationTime),
+                              fromUnixTime(metadata.lastModifiedTime), fromUnixTime(metadata.lastAccessTime),
+                              metadata.symlinkTarget);
+}
+
+bool FilePackager::extractOne(const std::string& filename, const std::string& outputDir) {
+    FileMetadata entry;
+    const char* content = nullptr;
+    bool found = false;
+    if (mapped) {
+        const PackageEntry* packageEntry = mapped->find(filename);
+        found = packageEntry && mapped->toMetadata(*packageEntry, entry);
+        content = found ? mapped->content(*packageEntry) : nullptr;
+    } else {
+        found = indexStream && findEntry(filename, entry);
+    }
+    if (!found) {
+        std::cerr << "Error: Entry not found in package: " << filename << std::endl;
+        return false;
+    }
+    try {
+        return extractEntry(indexStream, indexFd, content, entry, outputDir, extractBuffer);
+    } catch (const std::exception& e) {
+        std::cerr << "Error during unpacking: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FilePackager::extractMatching(const std::vector<std::shared_ptr<Filter>>& filters, const std::string& outputDir,
+                                   std::vector<std::string>& extracted, bool decompress) {
+    extracted.clear();
+    if (!mapped && !indexStream) {
+        return false;
+    }
+    try {
+        fs::create_directories(outputDir);
+        // 映射的包逐个读取条目表中的项，复用同一个元数据对象
+        FileMetadata mappedEntry;
+        std::vector<FileMetadata> directories;
+        size_t count = getEntryCount();
+        for (size_t i = 0; i < count; ++i) {
+            const char* content = nullptr;
+            if (mapped) {
+                const PackageEntry& packageEntry = mapped->entry(i);
+                if (!mapped->toMetadata(packageEntry, mappedEntry)) {
+                    std::cerr << "Error: Corrupted package entry " << i << std::endl;
+                    return false;
+                }
+                content = mapped->content(packageEntry);
+            }
+            const FileMetadata& entry = mapped ? mappedEntry : index[i];
+            File described = entryToFile(entry);
+            bool passAllFilters = true;
+            for (const auto& filter : filters) {
+                if (!filter->match(described)) {
+                    passAllFilters = false;
+                    break;
+                }
+            }
+            if (!passAllFilters) {
+                continue;
+            }
+            if (!extractEntry(indexStream, indexFd, content, entry, outputDir, extractBuffer, decompress,
+                              &directories)) {
+                return false;
+            }
+            extracted.push_back(entry.filename);
+        }
+        restoreDirectories(directories, outputDir);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error during unpacking: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool PackageTrailer::isValid(uint64_t packageSize) const {
+    if (std::memcmp(magic, PACKAGE_V2_MAGIC, sizeof(magic)) != 0 || tableOffset % PACKAGE_ALIGNMENT != 0) {
+        return false;
+    }
+    uint64_t end = packageSize - sizeof(PackageTrailer);
+    return tableOffset >= sizeof(PACKAGE_V2_MAGIC) && tableOffset <= end &&
+           entryCount <= (end - tableOffset) / sizeof(PackageEntry) &&
+           poolOffset == tableOffset + entryCount * sizeof(PackageEntry) &&
+           poolSize <= end - poolOffset;
+}
+
+bool PackageEntry::isValid(const PackageTrailer& trailer) const {
+    return static_cast<uint64_t>(nameOffset) + nameLength <= trailer.poolSize &&
+           static_cast<uint64_t>(targetOffset) + targetLength <= trailer.poolSize &&
+           offset <= trailer.tableOffset && size <= trailer.tableOffset - offset;
+}
+
+FileMetadata PackageEntry::toMetadata(const char* pool) const {
+    FileMetadata fileMeta;
+    toMetadata(pool, fileMeta);
+    return fileMeta;
+}
+
+void PackageEntry::toMetadata(const char* pool, FileMetadata& fileMeta) const {
+    fileMeta.filename.assign(pool + nameOffset, nameLength);
+    fileMeta.fileSize = size;
+    fileMeta.offset = offset;
+    fileMeta.isCompressed = isCompressed != 0;
+    fileMeta.permissions = permissions;
+    fileMeta.creationTime = creationTime;
+    fileMeta.lastModifiedTime = lastModifiedTime;
+    fileMeta.lastAccessTime = lastAccessTime;
+    fileMeta.fileType = fileType;
+    fileMeta.symlinkTarget.assign(pool + targetOffset, targetLength);
+}
+
+PackageEntry PackageEntry::fromMetadata(const FileMetadata& metadata, std::string& pool) {
+    PackageEntry entry = {};
+    entry.offset = metadata.offset;
+    entry.size = metadata.fileSize;
+    entry.creationTime = metadata.creationTime;
+    entry.lastModifiedTime = metadata.lastModifiedTime;
+    entry.lastAccessTime = metadata.lastAccessTime;
+    entry.nameOffset = static_cast<uint32_t>(pool.size());
+    entry.nameLength = static_cast<uint32_t>(metadata.filename.size());
+    pool += metadata.filename;
+    entry.targetOffset = static_cast<uint32_t>(pool.size());
+    entry.targetLength = static_cast<uint32_t>(metadata.symlinkTarget.size());
+    pool += metadata.symlinkTarget;
+    entry.permissions = metadata.permissions;
+    entry.fileType = metadata.fileType;
+    entry.isCompressed = metadata.isCompressed ? 1 : 0;
+    return entry;
+}
+
+MappedPackage::MappedPackage()
+    : data(nullptr), dataSize(0), entries(nullptr), entryCount(0), pool(nullptr), trailer() {
+}
+
+MappedPackage::~MappedPackage() {
+    close();
+}
+
+bool MappedPackage::open(const std::string& packagePath) {
+    close();
+    
+#ifdef _WIN32
+    std::ifstream inFile(packagePath, std::ios::binary);
+    if (!inFile) {
+        std::cerr << "Error: Cannot open input file: " << packagePath << std::endl;
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    dataSize = buffer.size();
+#else
+    int fd = ::open(packagePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open input file: " << packagePath << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Error: Cannot map package: " << packagePath << " (" << strerror(errno) << ")" << std::endl;
+        return false;
+    }
+    data = static_cast<const char*>(mapped);
+    dataSize = static_cast<uint64_t>(st.st_size);
+#endif
+    
+    // 只校验文件头和包尾，条目在访问时才读取和校验
+    if (dataSize < sizeof(PACKAGE_V2_MAGIC) + sizeof(trailer) ||
+        std::memcmp(data, PACKAGE_V2_MAGIC, sizeof(PACKAGE_V2_MAGIC)) != 0) {
+        close();
+        return false;
+    }
+    std::memcpy(&trailer, data + dataSize - sizeof(trailer), sizeof(trailer));
+    if (!trailer.isValid(dataSize)) {
+        std::cerr << "Error: Invalid package trailer: " << packagePath << std::endl;
+        close();
+        return false;
+    }
+    
+    entries = reinterpret_cast<const PackageEntry*>(data + trailer.tableOffset);
+    entryCount = static_cast<size_t>(trailer.entryCount);
+    pool = data + trailer.poolOffset;
+    return true;
+}
+
+void MappedPackage::close() {
+#ifdef _WIN32
+    buffer.clear();
+#else
+    if (data) {
+        munmap(const_cast<char*>(data), static_cast<size_t>(dataSize));
+    }
+#endif
+    data = nullptr;
+    dataSize = 0;
+    entries = nullptr;
+    entryCount = 0;
+    pool = nullptr;
+    trailer = PackageTrailer();
+}
+
+std::string_view MappedPackage::name(const PackageEntry& entry) const {
+    if (!entry.isValid(trailer)) {
+        return std::string_view();
+    }
+    return std::string_view(pool + entry.nameOffset, entry.nameLength);
+}
+
+std::string_view MappedPackage::symlinkTarget(const PackageEntry& entry) const {
+    if (!entry.isValid(trailer)) {
+        return std::string_view();
+    }
+    return std::string_view(pool + entry.targetOffset, entry.targetLength);
+}
+
+FileMetadata MappedPackage::toMetadata(const PackageEntry& entry) const {
+    return entry.isValid(trailer) ? entry.toMetadata(pool) : FileMetadata();
+}
+
+bool MappedPackage::toMetadata(const PackageEntry& entry, FileMetadata& fileMeta) const {
+    if (!entry.isValid(trailer)) {
+        return false;
+    }
+    entry.toMetadata(pool, fileMeta);
+    return true;
+}
+
+const char* MappedPackage::content(const PackageEntry& entry) const {
+    return entry.isValid(trailer) ? data + entry.offset : nullptr;
+}
+
+const PackageEntry* MappedPackage::find(std::string_view filename) const {
+    const PackageEntry* end = entries + entryCount;
+    const PackageEntry* it = std::lower_bound(entries, end, filename,
+        [this](const PackageEntry& entry, std::string_view key) { return name(entry) < key; });
+    return (it != end && name(*it) == filename) ? it : nullptr;
+}
@@ -1,11 +1,16 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include <memory>
+#include <unordered_map>
 #include <fstream>
 #include <cstdint>
 
 // 引入File类
 #include "../core/models/File.hpp"
+#include "../core/Filter.hpp"
+#include "Codec.hpp"
 
 // 文件元数据结构
 struct FileMetadata {
@@ -29,6 +34,60 @@ struct FileMetadata {
     FileMetadata(const File& file, const std::filesystem::path& basePath);
 };
 
+// 包文件格式
+// v1：[u64 元数据偏移][各文件内容...][变长元数据记录]
+// v2：[PACKAGE_V2_MAGIC][各文件内容...][条目表][字符串池][PackageTrailer]
+//     条目表是按名称排序的定长PackageEntry数组（8字节对齐），条目名和符号链接目标放在字符串池中；
+//     表位于包尾，流式写入（包括加密流）时不需要回写文件头。
+//     MappedPackage直接映射整个包，打开时不解析、不分配，查找条目是对条目表的二分查找
+// 整数按本机字节序（小端）存储，与v1相同
+constexpr char PACKAGE_V2_MAGIC[8] = {'B', 'K', 'P', 'K', 'G', '\0', 'v', '2'};
+constexpr uint64_t PACKAGE_ALIGNMENT = 8;
+
+// v2包尾
+struct PackageTrailer {
+    uint64_t tableOffset;  // 条目表偏移
+    uint64_t entryCount;   // 条目数
+    uint64_t poolOffset;   // 字符串池偏移（紧跟条目表）
+    uint64_t poolSize;     // 字符串池大小
+    char magic[8];         // 与文件头相同
+
+    // 检查魔数以及表和池是否落在包内
+    bool isValid(uint64_t packageSize) const;
+};
+
+// v2条目表中的一项，64字节定长
+struct PackageEntry {
+    uint64_t offset;            // 内容在包中的偏移
+    uint64_t size;              // 内容大小（压缩条目为压缩后的大小）
+    uint64_t creationTime;      // Unix时间戳（秒）
+    uint64_t lastModifiedTime;
+    uint64_t lastAccessTime;
+    uint32_t nameOffset;        // 条目名在字符串池中的偏移和长度
+    uint32_t nameLength;
+    uint32_t targetOffset;      // 符号链接目标在字符串池中的偏移和长度
+    uint32_t targetLength;
+    uint32_t permissions;
+    uint16_t fileType;          // 同FileMetadata::fileType
+    uint8_t isCompressed;
+    uint8_t reserved;
+
+    // 检查字符串是否落在池内
+    bool isValid(const PackageTrailer& trailer) const;
+
+    FileMetadata toMetadata(const char* pool) const;
+
+    // 同上，复用fileMeta中字符串的容量，逐个遍历条目时不必每次分配
+    void toMetadata(const char* pool, FileMetadata& fileMeta) const;
+
+    // 由元数据创建条目，名称和链接目标追加到pool
+    static PackageEntry fromMetadata(const FileMetadata& metadata, std::string& pool);
+};
+static_assert(sizeof(PackageEntry) == 64, "PackageEntry must stay 64 bytes");
+static_assert(sizeof(PackageTrailer) == 40, "PackageTrailer must stay 40 bytes");
+
+class MappedPackage;
+
 class FilePackager {
 public:
     FilePackager();
@@ -44,17 +103,172 @@ public:
 
     // 解包单个文件到目录
     bool unpackFiles(const std::string& inputFile, const std::string& outputDir);
+
+    // 从可定位的输入流解包到目录（例如分段加密文件的解密流，只读取需要的部分）
+    bool unpackFiles(std::istream& inFile, const std::string& outputDir);
     
     // 解包单个文件并返回File对象列表
     std::vector<File> unpackFilesToFiles(const std::string& inputFile, const std::string& outputDir);
 
+    // 只读取包的索引（条目名 -> 偏移、大小和元数据），不读取文件内容；
+    // 之后extractOne/extractMatching只读取选中条目的数据。
+    // 按路径加载v2包时直接映射包中的条目表，不复制元数据，查找是对条目表的二分查找；
+    // v1包和按流加载（例如加密包的解密流）时才把索引读入内存，解出期间流必须保持有效
+    bool loadIndex(const std::string& inputFile);
+    bool loadIndex(std::istream& inFile);
+
+    // 已加载的条目数
+    size_t getEntryCount() const;
+
+    // 按条目名查找，存在时把条目元数据复制到entry
+    bool findEntry(const std::string& filename, FileMetadata& entry) const;
+
+    // 条目对应的File描述（压缩条目去掉压缩扩展名，不访问磁盘），供过滤器匹配；
+    // 压缩条目的大小是压缩后的大小
+    static File entryToFile(const FileMetadata& metadata);
+
+    // 解出一个条目到outputDir（保持条目的相对路径）
+    bool extractOne(const std::string& filename, const std::string& outputDir);
+
+    // 解出匹配所有过滤器的条目，extracted返回解出的条目名；
+    // decompress为true时压缩条目（isCompressed）直接从包中解压到去掉扩展名的路径，不生成压缩文件
+    bool extractMatching(const std::vector<std::shared_ptr<Filter>>& filters, const std::string& outputDir,
+                         std::vector<std::string>& extracted, bool decompress = false);
+
 private:
+    friend class PackageWriter;
+
     // 写入元数据到文件
-    bool writeMetadata(const std::vector<FileMetadata>& metadata, std::ofstream& outFile);
+    static bool writeMetadata(const std::vector<FileMetadata>& metadata, std::ostream& outFile);
+
+    // 读取包的全部条目元数据，自动识别v1/v2格式
+    static bool readIndex(std::istream& inFile, std::vector<FileMetadata>& metadata);
+
+    // 读取v2条目表（文件头已确认是v2）
+    static bool readEntryTable(std::istream& inFile, std::vector<FileMetadata>& metadata);
+
+    // 解包实现；packageFd为包文件的描述符（-1表示只能通过流读取）
+    bool unpackFiles(std::istream& inFile, const std::string& outputDir, int packageFd);
+
+    // 解出一个条目（文件内容、目录、符号链接等），并恢复权限和时间戳；
+    // content不为空时条目内容已在内存中（映射的包），inFile可以为空；
+    // decompress为true时压缩条目解压后写出；
+    // directories不为空时目录只创建并追加到其中，由restoreDirectories在所有条目解出后恢复属性
+    static bool extractEntry(std::istream* inFile, int packageFd, const char* content, const FileMetadata& fileMeta,
+                             const std::string& outputDir, std::vector<char>& buffer, bool decompress = false,
+                             std::vector<FileMetadata>* directories = nullptr);
+
+    // 按子目录先于父目录的顺序恢复推迟的目录权限和时间戳（条目表按名称排序，目录先于其中的文件）
+    static void restoreDirectories(std::vector<FileMetadata>& directories, const std::string& outputDir);
+
+    // 恢复已解出条目的权限和时间戳
+    static void restoreAttributes(const FileMetadata& fileMeta, const std::string& outputPath);
+
+    // 把一个普通文件的内容从包中复制到outputPath：
+    // 有包文件描述符时优先用copy_file_range，否则（或不支持时）从映射内存写出，
+    // 或用复用的缓冲区从流中复制
+    static bool extractContent(std::istream* inFile, int packageFd, const char* content, const FileMetadata& fileMeta,
+                               const std::string& outputPath, std::vector<char>& buffer);
+
+    // 把一个压缩条目从包中的内容范围解压到outputPath
+    static bool extractDecompressed(std::istream* inFile, const char* content, const FileMetadata& fileMeta,
+                                    const std::string& outputPath, std::vector<char>& buffer);
 
-    // 从文件读取元数据
-    bool readMetadata(std::ifstream& inFile, std::vector<FileMetadata>& metadata);
+    // 从文件读取v1元数据
+    static bool readMetadata(std::istream& inFile, std::vector<FileMetadata>& metadata);
     
     // 将FileMetadata转换为File对象
     File metadataToFile(const FileMetadata& metadata, const std::string& outputDir) const;
-};
\ No newline at end of file
+
+    // 关闭已加载的索引及其包文件
+    void closeIndex();
+
+    std::unique_ptr<MappedPackage> mapped;     // 按路径加载的v2包
+    std::vector<FileMetadata> index;           // 按流加载或v1包的索引
+    std::unordered_map<std::string, size_t> indexByName;
+    std::unique_ptr<std::ifstream> indexFile;  // 按路径加载时持有的包文件
+    std::istream* indexStream;                 // 索引对应的包数据
+    int indexFd;                               // 包文件描述符，-1表示只能通过流读取
+    std::vector<char> extractBuffer;
+};
+
+// 流式打包写入器
+// 源文件直接（按需压缩后）写入包中，不需要先在备份目录生成逐个文件的副本再拼接；
+// 输出流需要从起始位置写入并支持tellp，可以是EncryptingStreamBuf这样不能回写的加密流：
+//   PackageWriter writer(out);
+//   writer.addFile(file, "dir/a.txt"); ...; writer.finish();
+class PackageWriter {
+public:
+    explicit PackageWriter(std::ostream& out);
+
+    // 写入一个条目；目录、符号链接等只记录元数据，普通文件的内容用固定大小的缓冲区复制
+    bool addFile(const File& file, const std::string& entryName);
+
+    // 以codec压缩普通文件内容后写入，条目名追加压缩扩展名；compressedSize返回写入的字节数
+    bool addCompressedFile(const File& file, const std::string& entryName, CodecId codec, uint64_t& compressedSize);
+
+    // 写入元数据和包尾，之后不能再添加条目
+    bool finish();
+
+    size_t getEntryCount() const { return metadata.size(); }
+
+private:
+    // 写入文件头（第一次添加条目或结束时）
+    bool start();
+
+    // 以entryName和当前位置创建条目元数据
+    FileMetadata makeMetadata(const File& file, const std::string& entryName) const;
+
+    std::ostream& out;
+    std::vector<FileMetadata> metadata;
+    std::vector<char> buffer;
+    bool started;
+    bool finished;
+};
+
+// v2包的只读映射视图
+// 打开时只映射文件并校验包尾，不解析条目、不分配内存，条目数再多打开也是O(1)；
+// 条目名、链接目标和文件内容都直接指向映射内存，在close()或析构之前有效：
+//   MappedPackage package;
+//   if (package.open(path)) { const PackageEntry* e = package.find("dir/a.txt"); ... }
+// v1包和加密包不能映射，需要通过FilePackager读取
+class MappedPackage {
+public:
+    MappedPackage();
+    ~MappedPackage();
+
+    MappedPackage(const MappedPackage&) = delete;
+    MappedPackage& operator=(const MappedPackage&) = delete;
+
+    // 映射v2包，格式不符时返回false
+    bool open(const std::string& packagePath);
+    void close();
+
+    size_t getEntryCount() const { return entryCount; }
+
+    // 第index个条目（按名称排序）
+    const PackageEntry& entry(size_t index) const { return entries[index]; }
+
+    std::string_view name(const PackageEntry& entry) const;
+    std::string_view symlinkTarget(const PackageEntry& entry) const;
+
+    // 条目内容（size字节）；名称、链接目标和内容在访问时校验范围，损坏的条目返回空
+    const char* content(const PackageEntry& entry) const;
+
+    // 按名称二分查找，不存在时返回nullptr
+    const PackageEntry* find(std::string_view filename) const;
+
+    FileMetadata toMetadata(const PackageEntry& entry) const;
+    bool toMetadata(const PackageEntry& entry, FileMetadata& fileMeta) const;
+
+private:
+    const char* data;
+    uint64_t dataSize;
+    const PackageEntry* entries;
+    size_t entryCount;
+    const char* pool;
+    PackageTrailer trailer;
+#ifdef _WIN32
+    std::vector<char> buffer;  // 没有mmap时读入内存
+#endif
+};
@@ -1,6 +1,7 @@
 #include "FileSystem.hpp"
 #include "../core/models/File.hpp"
-#include "HuffmanCompressor.hpp"
+#include "Codec.hpp"
+#include "DirectoryWalker.hpp"
 #include <iostream>  // 仅用于调试（可选），正式版可移除
 #include <stdexcept>
 #include <string.h>
@@ -8,7 +9,7 @@
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
-#include <set>
+#include <unordered_set>
 
 // 跨平台头文件包含
 #ifdef _WIN32
@@ -198,117 +199,131 @@ bool FileSystem::copyFile(const std::string& source, const std::string& destinat
     return true;
 }
 
-std::vector<File> FileSystem::getAllFiles(const std::string& directory) {
-    std::vector<File> files;
+FileCatalog FileSystem::scanDirectory(const std::string& directory, size_t threadCount) {
     std::error_code ec;
 
     // 使用symlink_status检查目录是否存在和是否为目录，不解析符号链接
     fs::file_status status = fs::symlink_status(directory, ec);
     if (ec || status.type() != fs::file_type::directory) {
-        return files; // 返回空列表
+        return FileCatalog(directory); // 返回空目录
     }
 
+    // 多线程收集所有文件和目录，包括符号链接（指向目录的符号链接会继续深入）
+    // 空目录也在其中，不需要再单独收集
+    DirectoryWalker walker(threadCount);
+    FileCatalog catalog = walker.walkCatalog(directory);
+
     try {
-        // 收集所有文件和目录
-        for (const auto& entry : fs::recursive_directory_iterator(
-                 directory, 
-                 fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, 
-                 ec)) {
-            if (ec) break;
-            // 收集所有类型的文件，包括符号链接
-            files.emplace_back(entry.path());
-        }
-        
         // 收集符号链接指向的文件和目录
-        // 创建一个临时集合来存储已处理的文件路径，避免重复
-        std::set<fs::path> processedPaths;
-        for (const auto& file : files) {
-            processedPaths.insert(file.getFilePath());
-        }
-        
-        // 遍历所有文件，检查符号链接指向的文件是否已被收集
-        for (const auto& file : files) {
-            if (file.isSymbolicLink()) {
-                // 读取符号链接目标
-                fs::path symlinkTarget = fs::read_symlink(file.getFilePath(), ec);
-                if (!ec) {
-                    // 计算符号链接目标的完整路径
-                    fs::path fullTargetPath;
-                    if (symlinkTarget.is_absolute()) {
-                        fullTargetPath = symlinkTarget;
-                    } else {
-                        fullTargetPath = file.getFilePath().parent_path() / symlinkTarget;
-                    }
-                    
-                    // 检查目标是否存在，并且是源目录中的文件
-                    if (fs::exists(fullTargetPath) && 
-                        fullTargetPath.string().find(directory) == 0 && 
-                        processedPaths.find(fullTargetPath) == processedPaths.end()) {
-                        // 将目标文件添加到结果中
-                        files.emplace_back(fullTargetPath);
-                        processedPaths.insert(fullTargetPath);
-                        
-                        // 如果目标是目录，递归收集其内容
-                        if (fs::is_directory(fullTargetPath, ec) && !ec) {
-                            for (const auto& entry : fs::recursive_directory_iterator(
-                                     fullTargetPath, 
-                                     fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, 
-                                     ec)) {
-                                if (ec) break;
-                                if (processedPaths.find(entry.path()) == processedPaths.end()) {
-                                    files.emplace_back(entry.path());
-                                    processedPaths.insert(entry.path());
-                                }
-                            }
-                        }
-                    }
+        // 已收集路径的集合只在遇到指向源目录内的符号链接时才建立，避免重复
+        std::unordered_set<std::string> processedPaths;
+        bool processedBuilt = false;
+        auto markProcessed = [&](const fs::path& path) {
+            if (!processedBuilt) {
+                processedPaths.reserve(catalog.size());
+                for (size_t i = 0; i < catalog.size(); ++i) {
+                    processedPaths.insert(catalog[i].getFilePath().string());
                 }
+                processedBuilt = true;
             }
-        }
+            return processedPaths.insert(path.string()).second;
+        };
+        // 源目录内路径相对于源目录的部分
+        auto storedPathOf = [&](const fs::path& path) {
+            std::string full = path.string();
+            size_t start = std::min(directory.size(), full.size());
+            while (start < full.size() && (full[start] == '/' || full[start] == fs::path::preferred_separator)) {
+                ++start;
+            }
+            return full.substr(start);
+        };
         
-        // 收集空目录
-        std::function<void(const fs::path&)> collectEmptyDirs = [&](const fs::path& dirPath) {
-            for (const auto& entry : fs::directory_iterator(dirPath, ec)) {
-                if (ec) break;
-                if (fs::is_directory(entry.symlink_status())) {
-                    bool exists = false;
-                    for (const auto& file : files) {
-                        if (file.getFilePath() == entry.path()) {
-                            exists = true;
-                            break;
+        // 遍历所有条目，检查符号链接指向的文件是否已被收集（新加入的条目也会被检查）
+        for (size_t i = 0; i < catalog.size(); ++i) {
+            if (!catalog[i].isSymbolicLink()) {
+                continue;
+            }
+            // 符号链接目标在扫描时已经读取
+            fs::path symlinkTarget = catalog[i].getSymlinkTarget();
+            if (symlinkTarget.empty()) {
+                continue;
+            }
+            // 计算符号链接目标的完整路径
+            fs::path fullTargetPath;
+            if (symlinkTarget.is_absolute()) {
+                fullTargetPath = symlinkTarget;
+            } else {
+                fullTargetPath = catalog[i].getFilePath().parent_path() / symlinkTarget;
+            }
+            
+            // 检查目标是否存在，并且是源目录中尚未收集的文件
+            if (fs::exists(fullTargetPath, ec) &&
+                fullTargetPath.string().find(directory) == 0 &&
+                markProcessed(fullTargetPath)) {
+                catalog.add(File(fullTargetPath), storedPathOf(fullTargetPath), false);
+                
+                // 如果目标是目录，递归收集其内容
+                if (fs::is_directory(fullTargetPath, ec) && !ec) {
+                    for (const auto& entry : fs::recursive_directory_iterator(
+                             fullTargetPath, 
+                             fs::directory_options::skip_permission_denied | fs::directory_options::follow_directory_symlink, 
+                             ec)) {
+                        if (ec) break;
+                        if (markProcessed(entry.path())) {
+                            catalog.add(File(entry.path()), storedPathOf(entry.path()), false);
                         }
                     }
-                    if (!exists) {
-                        files.emplace_back(entry.path());
-                        processedPaths.insert(entry.path());
-                    }
-                    collectEmptyDirs(entry.path());
                 }
             }
-        };
-        collectEmptyDirs(directory);
+            ec.clear();
+        }
         
         // 确保符号链接被正确处理，不被其他文件类型覆盖
-        // 按文件类型排序：符号链接 -> 真实文件 -> 目录 -> 其他类型
+        // 按文件类型排序：符号链接 -> 真实文件 -> 目录 -> 其他类型，同类按路径排序
         // 符号链接优先处理，避免真实文件覆盖符号链接
-        std::sort(files.begin(), files.end(), [](const File& a, const File& b) {
-            // 符号链接优先级最高
-            if (a.isSymbolicLink() && !b.isSymbolicLink()) return true;
-            if (!a.isSymbolicLink() && b.isSymbolicLink()) return false;
-            
-            // 然后是真实文件
-            if (a.isRegularFile() && !b.isRegularFile()) return true;
-            if (!a.isRegularFile() && b.isRegularFile()) return false;
-            
-            // 然后是目录
-            if (a.isDirectory() && !b.isDirectory()) return true;
-            if (!a.isDirectory() && b.isDirectory()) return false;
-            
-            // 最后按路径排序
-            return a.getFilePath().string() < b.getFilePath().string();
+        auto rank = [&catalog](size_t index) {
+            switch (catalog[index].getFileType()) {
+                case fs::file_type::symlink: return 0;
+                case fs::file_type::regular: return 1;
+                case fs::file_type::directory: return 2;
+                default: return 3;
+            }
+        };
+        std::vector<int> ranks(catalog.size());
+        std::vector<size_t> order(catalog.size());
+        for (size_t i = 0; i < catalog.size(); ++i) {
+            ranks[i] = rank(i);
+            order[i] = i;
+        }
+        // 所有条目的完整路径有相同的源目录前缀，比较相对部分即可
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            if (ranks[a] != ranks[b]) {
+                return ranks[a] < ranks[b];
+            }
+            return catalog[a].getStoredPath() < catalog[b].getStoredPath();
         });
+        catalog.reorder(order);
     } catch (const fs::filesystem_error&) {
-        // 忽略异常，返回已收集的文件（或空）
+        // 忽略异常，返回已收集的文件
+    }
+    return catalog;
+}
+
+bool FileSystem::streamDirectory(const std::string& directory,
+                                 const std::function<bool(const FileEntry& entry)>& consume,
+                                 size_t threadCount,
+                                 const std::function<bool(const fs::path& directory)>& descend) {
+    DirectoryWalker walker(threadCount);
+    walker.setDescendFilter(descend);
+    return walker.stream(directory, consume);
+}
+
+std::vector<File> FileSystem::getAllFiles(const std::string& directory, size_t threadCount) {
+    FileCatalog catalog = scanDirectory(directory, threadCount);
+    std::vector<File> files;
+    files.reserve(catalog.size());
+    for (size_t i = 0; i < catalog.size(); ++i) {
+        files.push_back(catalog[i].toFile());
     }
     return files;
 }
@@ -332,15 +347,18 @@ std::string FileSystem::getRelativePath(const std::string& path, const std::stri
     }
 }
 
-bool FileSystem::compressFile(const std::string& source, const std::string& destination) {
-    HuffmanCompressor compressor;
-    
+CompressResult FileSystem::compressFile(const std::string& source, const std::string& destination, CodecId codec) {
     // 获取原始文件大小
     uint64_t originalSize = getFileSize(source);
     
-    // 先尝试压缩
-    if (!compressor.compressFile(source, destination)) {
-        return false;
+    // 先按采样估计，明显压缩不了的文件不做编码，由调用方直接复制
+    if (!isWorthCompressing(source, codec)) {
+        return CompressResult::Skipped;
+    }
+    
+    // 尝试压缩
+    if (!Codec::compressFile(codec, source, destination)) {
+        return CompressResult::Failed;
     }
     
     // 检查压缩效率
@@ -357,7 +375,7 @@ bool FileSystem::compressFile(const std::string& source, const std::string& dest
         std::error_code ec;
         fs::remove(destination, ec);
         
-        return false;
+        return CompressResult::NotSmaller;
     }
     
     // 复制原始文件的元数据到压缩文件
@@ -376,20 +394,27 @@ bool FileSystem::compressFile(const std::string& source, const std::string& dest
         // 静默处理元数据复制异常
     }
     
-    // 压缩成功且文件变小，返回true
-    return true;
+    // 压缩成功且文件变小
+    return CompressResult::Compressed;
+}
+
+bool FileSystem::isWorthCompressing(const std::string& source, CodecId codec) {
+    std::unique_ptr<Codec> compressor = Codec::create(codec);
+    if (!compressor) {
+        return false;
+    }
+    return compressor->isWorthCompressing(source);
 }
 
 bool FileSystem::decompressFile(const std::string& source, const std::string& destination) {
-    HuffmanCompressor compressor;
-    
+
     // 保存原始压缩文件的元数据
     std::error_code ec;
     auto originalFileTime = fs::last_write_time(source, ec);
     auto originalPermissions = fs::status(source, ec).permissions();
     
     // 先解压缩文件
-    if (!compressor.decompressFile(source, destination)) {
+    if (!Codec::decompressFile(source, destination)) {
         return false;
     }
     
@@ -418,21 +443,28 @@ bool FileSystem::decompressFile(const std::string& source, const std::string& de
     return true;
 }
 
-bool FileSystem::copyAndCompressFile(const std::string& source, const std::string& destination) {
+bool FileSystem::copyAndCompressFile(const std::string& source, const std::string& destination, CodecId codec,
+                                     CompressResult* result) {
     // 先尝试压缩文件
-    if (compressFile(source, destination)) {
+    CompressResult compressed = compressFile(source, destination, codec);
+    if (result) {
+        *result = compressed;
+    }
+    if (compressed == CompressResult::Compressed) {
         return true;
     }
     
-    // 如果压缩失败，直接复制原始文件，不添加.huff扩展名
+    // 如果压缩失败，直接复制原始文件，不添加压缩扩展名
     // 但首先确保目标文件不存在，避免生成无效文件
     std::error_code ec;
     fs::remove(destination, ec);
     
-    // 去掉.huff扩展名，获取原始文件名
+    // 去掉调用方追加的压缩扩展名，获取原始文件名（原始文件名本身可能也带压缩扩展名）
     std::string originalDest = destination;
-    if (originalDest.size() > 5 && originalDest.substr(originalDest.size() - 5) == ".huff") {
-        originalDest = originalDest.substr(0, originalDest.size() - 5);
+    std::string extension = Codec::extensionOf(codec);
+    if (originalDest.size() > extension.size() &&
+        originalDest.compare(originalDest.size() - extension.size(), extension.size(), extension) == 0) {
+        originalDest.resize(originalDest.size() - extension.size());
     }
     
     // 直接复制原始文件到原始文件名
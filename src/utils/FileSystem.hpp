@@ -4,15 +4,16 @@
 #include <filesystem>
 #include <fstream>
 #include <system_error>
+#include <cstdint>
+#include <functional>
 
 // 引入File类定义
 #include "../core/models/File.hpp"
+#include "../core/models/FileCatalog.hpp"
+#include "Codec.hpp"
 
 namespace fs = std::filesystem;
 
-// 引入HuffmanCompressor类
-class HuffmanCompressor;
-
 class FileSystem {
 public:
     // 检查文件或目录是否存在
@@ -24,14 +25,29 @@ public:
     // 复制单个文件
     static bool copyFile(const std::string& source, const std::string& destination);
 
-    // 压缩并复制文件
-    static bool copyAndCompressFile(const std::string& source, const std::string& destination);
+    // 压缩并复制文件；不值得压缩时去掉destination的压缩扩展名后直接复制
+    // result不为空时返回压缩结果，由调用方计入自己的统计
+    static bool copyAndCompressFile(const std::string& source, const std::string& destination,
+                                    CodecId codec = CodecId::Huffman, CompressResult* result = nullptr);
 
     // 解压并复制文件
     static bool decompressAndCopyFile(const std::string& source, const std::string& destination);
 
-    // 获取目录中的所有文件（递归）
-    static std::vector<File> getAllFiles(const std::string& directory);
+    // 扫描目录中的所有文件（递归），结果按 符号链接 -> 普通文件 -> 目录 -> 其他 的顺序排列
+    // threadCount为遍历线程数，0表示使用硬件并发数
+    static FileCatalog scanDirectory(const std::string& directory, size_t threadCount = 0);
+
+    // 流式扫描目录：边遍历边把条目交给consume，不等待扫描结束，也不保存完整的文件列表
+    // 条目顺序不确定，也不做scanDirectory中对符号链接目标的补充收集（遍历已经跟随指向目录的链接）
+    // consume返回false时停止扫描并返回false
+    // descend不为空时用于子树剪枝：对子目录返回false时该目录及其下所有条目都不遍历（见DirectoryWalker::setDescendFilter）
+    static bool streamDirectory(const std::string& directory,
+                                const std::function<bool(const FileEntry& entry)>& consume,
+                                size_t threadCount = 0,
+                                const std::function<bool(const fs::path& directory)>& descend = nullptr);
+
+    // 获取目录中的所有文件（递归），顺序同scanDirectory
+    static std::vector<File> getAllFiles(const std::string& directory, size_t threadCount = 0);
 
     // 获取文件大小
     static uint64_t getFileSize(const std::string& filePath);
@@ -39,12 +55,16 @@ public:
     // 获取相对路径
     static std::string getRelativePath(const std::string& path, const std::string& base);
 
-    // 压缩单个文件
-    static bool compressFile(const std::string& source, const std::string& destination);
+    // 压缩单个文件，只有返回Compressed时destination才保留压缩结果
+    static CompressResult compressFile(const std::string& source, const std::string& destination,
+                                       CodecId codec = CodecId::Huffman);
 
-    // 解压单个文件
+    // 解压单个文件（按文件头选择算法）
     static bool decompressFile(const std::string& source, const std::string& destination);
 
+    // 按采样估计文件是否值得压缩
+    static bool isWorthCompressing(const std::string& source, CodecId codec = CodecId::Huffman);
+
     // 删除单个文件
     static bool removeFile(const std::string& path);
     
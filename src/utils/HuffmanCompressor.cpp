@@ -1,4 +1,6 @@
 #include "HuffmanCompressor.hpp"
+#include "ThreadPool.hpp"
+#include "ByteHistogram.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -7,399 +9,1055 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
 namespace fs = std::filesystem;
 
-// 初始化HuffmanNode的静态计数器
-unsigned int HuffmanNode::nextId = 0;
+namespace {
+    // 解压时每次写出的数据块大小
+    constexpr size_t DECODE_CHUNK_SIZE = 1 << 20;
 
-HuffmanCompressor::HuffmanCompressor() : root(nullptr) {}
+    // v2格式的魔数和版本号
+    constexpr char HUFF_MAGIC[4] = {'B', 'H', 'U', 'F'};
+    constexpr int HUFF_VERSION = 2;
 
-HuffmanCompressor::~HuffmanCompressor() {
-    delete root;
-}
+    // 块头：原始大小(u32) + 块类型(u8) + 块体大小(u32)
+    constexpr size_t BLOCK_HEADER_SIZE = 9;
+
+    // 码长表中码长的上限（4位）和稠密码长表的大小
+    constexpr unsigned MAX_HEADER_CODE_LENGTH = 15;
+    constexpr size_t DENSE_LENGTHS_SIZE = 128;
 
-std::unordered_map<char, unsigned int> HuffmanCompressor::calculateFrequency(const std::string& data) {
-    std::unordered_map<char, unsigned int> freqMap;
-    for (char ch : data) {
-        freqMap[ch]++;
+    // 小端序读写
+    inline void putLittleEndian16(std::vector<unsigned char>& out, uint16_t value) {
+        out.push_back(static_cast<unsigned char>(value));
+        out.push_back(static_cast<unsigned char>(value >> 8));
     }
-    return freqMap;
-}
 
-// 构建Huffman树 - 简化版本，只处理unsigned char
-HuffmanNode* HuffmanCompressor::buildHuffmanTree(const std::unordered_map<unsigned char, unsigned int>& freqMap) {
-    // 创建优先队列（最小堆）
-    std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, Compare> minHeap;
+    inline void putLittleEndian32(std::vector<unsigned char>& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
 
-    // 将所有字符及其频率加入优先队列
-    for (const auto& pair : freqMap) {
-        minHeap.push(new HuffmanNode(pair.first, pair.second));
+    inline void putLittleEndian64(std::vector<unsigned char>& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
     }
 
-    // 处理空频率表的情况
-    if (minHeap.empty()) {
-        return nullptr;
+    inline uint32_t getLittleEndian32(const unsigned char* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
     }
 
-    // 构建Huffman树
-    while (minHeap.size() > 1) {
-        // 取出频率最小的两个节点
-        HuffmanNode* left = minHeap.top();
-        minHeap.pop();
+    inline uint64_t getLittleEndian64(const unsigned char* p) {
+        return static_cast<uint64_t>(getLittleEndian32(p)) | (static_cast<uint64_t>(getLittleEndian32(p + 4)) << 32);
+    }
 
-        HuffmanNode* right = minHeap.top();
-        minHeap.pop();
+    // 按大端序写入8个字节
+    inline void storeBigEndian64(unsigned char* p, uint64_t value) {
+        for (int i = 7; i >= 0; --i) {
+            p[i] = static_cast<unsigned char>(value);
+            value >>= 8;
+        }
+    }
 
-        // 创建一个内部节点，使用专门的内部节点构造函数
-        HuffmanNode* newNode = new HuffmanNode(left->freq + right->freq, left, right);
+    // 按大端序读取8个字节
+    inline uint64_t loadBigEndian64(const unsigned char* p) {
+        return (static_cast<uint64_t>(p[0]) << 56) | (static_cast<uint64_t>(p[1]) << 48) |
+               (static_cast<uint64_t>(p[2]) << 40) | (static_cast<uint64_t>(p[3]) << 32) |
+               (static_cast<uint64_t>(p[4]) << 24) | (static_cast<uint64_t>(p[5]) << 16) |
+               (static_cast<uint64_t>(p[6]) << 8)  |  static_cast<uint64_t>(p[7]);
+    }
+}
 
-        // 将新节点加入优先队列
-        minHeap.push(newNode);
+void HuffmanTree::build(const uint64_t frequencies[256]) {
+    leafCount = 0;
+    root = -1;
+
+    // 1. 叶节点：按(频率, 符号值)排序
+    int16_t leaves[256];
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        if (frequencies[symbol] > 0) {
+            Node& leaf = nodes[leafCount];
+            leaf.freq = frequencies[symbol];
+            leaf.child[0] = leaf.child[1] = -1;
+            leaf.symbol = static_cast<unsigned char>(symbol);
+            leaf.isLeaf = true;
+            leaves[leafCount] = static_cast<int16_t>(leafCount);
+            ++leafCount;
+        }
     }
+    if (leafCount == 0) {
+        return;
+    }
+    std::stable_sort(leaves, leaves + leafCount, [this](int16_t l, int16_t r) {
+        return nodes[l].freq < nodes[r].freq;
+    });
 
-    // 剩下的节点就是根节点
-    return minHeap.top();
+    // 2. 双队列合并：内部节点按创建顺序产生，频率单调不减，
+    //    因此每次只需比较两个队首，频率相同时取叶节点
+    int nextLeaf = 0;
+    int nextInternal = leafCount;
+    int nodeCount = leafCount;
+    auto takeSmallest = [&]() -> int16_t {
+        if (nextLeaf < leafCount &&
+            (nextInternal == nodeCount || nodes[leaves[nextLeaf]].freq <= nodes[nextInternal].freq)) {
+            return leaves[nextLeaf++];
+        }
+        return static_cast<int16_t>(nextInternal++);
+    };
+    while ((leafCount - nextLeaf) + (nodeCount - nextInternal) > 1) {
+        int16_t left = takeSmallest();
+        int16_t right = takeSmallest();
+        Node& parent = nodes[nodeCount];
+        parent.freq = nodes[left].freq + nodes[right].freq;
+        parent.child[0] = left;
+        parent.child[1] = right;
+        parent.symbol = 0;
+        parent.isLeaf = false;
+        ++nodeCount;
+    }
+    root = nodeCount - 1;
 }
 
-// 生成Huffman编码
-void HuffmanCompressor::generateCodes(HuffmanNode* root, const std::string& code, std::unordered_map<unsigned char, std::string>& huffmanCodes) {
-    if (root == nullptr) {
+void HuffmanTree::codeLengths(uint8_t lengths[256]) const {
+    std::fill(lengths, lengths + 256, 0);
+    if (root < 0) {
         return;
     }
+    // 子节点的下标总是小于父节点，从根向前遍历即可逐层传递深度
+    uint8_t depth[MAX_NODES];
+    depth[root] = 0;
+    for (int index = root; index >= leafCount; --index) {
+        const Node& node = nodes[index];
+        depth[node.child[0]] = static_cast<uint8_t>(depth[index] + 1);
+        depth[node.child[1]] = static_cast<uint8_t>(depth[index] + 1);
+    }
+    for (int index = 0; index < leafCount; ++index) {
+        lengths[nodes[index].symbol] = depth[index];
+    }
+}
 
-    // 如果是叶子节点，保存其编码
-    if (root->isLeaf) {
-        huffmanCodes[root->data] = code;
+bool assignCanonicalCodes(const uint8_t lengths[256], uint64_t codes[256]) {
+    // 统计各码长的符号数，并检查Kraft等式（完整前缀码）
+    uint32_t lengthCount[HuffmanDecoder::MAX_CODE_LENGTH + 1] = {};
+    int symbolCount = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        codes[symbol] = 0;
+        if (lengths[symbol] > HuffmanDecoder::MAX_CODE_LENGTH) {
+            return false;
+        }
+        if (lengths[symbol] > 0) {
+            lengthCount[lengths[symbol]]++;
+            ++symbolCount;
+        }
+    }
+    if (symbolCount < 2) {
+        // 单个符号不需要码字
+        return symbolCount == 1;
+    }
+
+    // 每个码长的第一个码字
+    uint64_t nextCode[HuffmanDecoder::MAX_CODE_LENGTH + 2] = {};
+    uint64_t code = 0;
+    for (unsigned length = 1; length <= HuffmanDecoder::MAX_CODE_LENGTH; ++length) {
+        code = (code + lengthCount[length - 1]) << 1;
+        nextCode[length] = code;
+    }
+    // 最长码长的最后一个码字必须是全1，否则不是完整前缀码
+    unsigned maxLength = 0;
+    for (unsigned length = 1; length <= HuffmanDecoder::MAX_CODE_LENGTH; ++length) {
+        if (lengthCount[length] > 0) {
+            maxLength = length;
+        }
+    }
+    for (unsigned length = 1; length <= maxLength; ++length) {
+        if (nextCode[length] + lengthCount[length] > (uint64_t(1) << length)) {
+            return false;
+        }
+    }
+    if (nextCode[maxLength] + lengthCount[maxLength] != (uint64_t(1) << maxLength)) {
+        return false;
+    }
+
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        if (lengths[symbol] > 0) {
+            codes[symbol] = nextCode[lengths[symbol]]++;
+        }
+    }
+    return true;
+}
+
+void limitCodeLengths(uint8_t lengths[256], const uint64_t frequencies[256], unsigned maxLength) {
+    // 1. 统计各码长的符号数，超长的码字先全部归到maxLength
+    uint32_t lengthCount[256] = {};
+    bool overflow = false;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        if (lengths[symbol] > maxLength) {
+            overflow = true;
+            lengthCount[maxLength]++;
+        } else if (lengths[symbol] > 0) {
+            lengthCount[lengths[symbol]]++;
+        }
+    }
+    if (!overflow) {
         return;
     }
 
-    // 递归遍历左右子树
-    generateCodes(root->left, code + "0", huffmanCodes);
-    generateCodes(root->right, code + "1", huffmanCodes);
+    // 2. 调整各码长的符号数直到满足Kraft等式：
+    //    每次从最长一层拿走一个码字，并把较短一层的一个叶节点下移一层，分裂成两个
+    uint64_t total = 0;
+    for (unsigned length = 1; length <= maxLength; ++length) {
+        total += static_cast<uint64_t>(lengthCount[length]) << (maxLength - length);
+    }
+    while (total != (uint64_t(1) << maxLength)) {
+        lengthCount[maxLength]--;
+        for (unsigned length = maxLength - 1; length > 0; --length) {
+            if (lengthCount[length] > 0) {
+                lengthCount[length]--;
+                lengthCount[length + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    // 3. 按频率从高到低（频率相同时按符号值）依次分配从短到长的码长
+    int symbols[256];
+    int symbolCount = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        if (lengths[symbol] > 0) {
+            symbols[symbolCount++] = symbol;
+        }
+    }
+    std::stable_sort(symbols, symbols + symbolCount, [frequencies](int l, int r) {
+        return frequencies[l] > frequencies[r];
+    });
+    int index = 0;
+    for (unsigned length = 1; length <= maxLength; ++length) {
+        for (uint32_t i = 0; i < lengthCount[length]; ++i) {
+            lengths[symbols[index++]] = static_cast<uint8_t>(length);
+        }
+    }
 }
 
-// 将位串转换为字节序列
-std::vector<unsigned char> HuffmanCompressor::bitStringToBytes(const std::string& bitString) {
-    std::vector<unsigned char> bytes;
-    unsigned char currentByte = 0;
-    int bitCount = 0;
+bool HuffmanDecoder::build(const HuffmanTree& tree) {
+    nodes.clear();
+    table.clear();
+    singleSymbol = false;
+    if (tree.empty()) {
+        return false;
+    }
 
-    for (char bit : bitString) {
-        // 从高位到低位构建字节
-        currentByte = (currentByte << 1) | (bit - '0');
-        bitCount++;
+    // 只有一种字符时编码长度为0，不需要查表
+    if (tree.nodes[tree.root].isLeaf) {
+        singleSymbol = true;
+        onlySymbol = tree.nodes[tree.root].symbol;
+        return true;
+    }
 
-        if (bitCount == 8) {
-            bytes.push_back(currentByte);
-            currentByte = 0;
-            bitCount = 0;
+    // 内部节点倒序排列，使根节点位于下标0；叶节点记为~symbol
+    int internalCount = tree.root - tree.leafCount + 1;
+    nodes.resize(internalCount);
+    for (int index = tree.root; index >= tree.leafCount; --index) {
+        FlatNode& flat = nodes[tree.root - index];
+        for (int side = 0; side < 2; ++side) {
+            const HuffmanTree::Node& child = tree.nodes[tree.nodes[index].child[side]];
+            flat.child[side] = child.isLeaf ? ~static_cast<int32_t>(child.symbol)
+                                            : tree.root - tree.nodes[index].child[side];
         }
     }
+    buildTable();
+    return true;
+}
 
-    // 处理剩余的位
-    if (bitCount > 0) {
-        currentByte <<= (8 - bitCount);
-        bytes.push_back(currentByte);
+bool HuffmanDecoder::buildFromLengths(const uint8_t lengths[256]) {
+    nodes.clear();
+    table.clear();
+    singleSymbol = false;
+
+    int symbolCount = 0;
+    int lastSymbol = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        if (lengths[symbol] > MAX_CODE_LENGTH) {
+            return false;
+        }
+        if (lengths[symbol] > 0) {
+            ++symbolCount;
+            lastSymbol = symbol;
+        }
+    }
+    if (symbolCount == 0) {
+        return false;
+    }
+    if (symbolCount == 1) {
+        singleSymbol = true;
+        onlySymbol = static_cast<unsigned char>(lastSymbol);
+        return true;
     }
 
-    return bytes;
+    uint64_t codes[256];
+    if (!assignCanonicalCodes(lengths, codes)) {
+        return false;
+    }
+
+    // 按码字逐位插入，0表示尚未分配的子节点（根节点不会作为子节点出现）
+    nodes.reserve(256);
+    nodes.push_back(FlatNode{{0, 0}});
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        unsigned length = lengths[symbol];
+        if (length == 0) {
+            continue;
+        }
+        int32_t node = 0;
+        for (unsigned i = 0; i < length; ++i) {
+            unsigned bit = static_cast<unsigned>((codes[symbol] >> (length - 1 - i)) & 1);
+            int32_t& child = nodes[node].child[bit];
+            if (i + 1 == length) {
+                if (child != 0) {
+                    return false;
+                }
+                child = ~static_cast<int32_t>(symbol);
+            } else {
+                if (child < 0) {
+                    return false;
+                }
+                if (child == 0) {
+                    child = static_cast<int32_t>(nodes.size());
+                    nodes.push_back(FlatNode{{0, 0}});
+                }
+                node = nodes[node].child[bit];
+            }
+        }
+    }
+    buildTable();
+    return true;
 }
 
-// 将字节序列转换为位串
-std::string HuffmanCompressor::bytesToBitString(const std::vector<unsigned char>& bytes, int padding) {
-    std::string bitString;
-    
-    for (unsigned char byte : bytes) {
-        // 从高位到低位提取位
-        for (int j = 7; j >= 0; j--) {
-            bitString += ((byte >> j) & 1) ? '1' : '0';
+void HuffmanDecoder::buildTable() {
+    // 对每个TABLE_BITS位的窗口沿树走一遍，记录能完整解出的前一到两个符号
+    const uint32_t tableSize = 1u << TABLE_BITS;
+    table.assign(tableSize, Entry{});
+    for (uint32_t window = 0; window < tableSize; ++window) {
+        Entry entry{};
+        unsigned used = 0;
+        int32_t node = 0;
+        while (used < TABLE_BITS) {
+            unsigned bit = (window >> (TABLE_BITS - 1 - used)) & 1;
+            int32_t next = nodes[node].child[bit];
+            ++used;
+            if (next < 0) {
+                entry.symbols[entry.count++] = static_cast<unsigned char>(~next);
+                break;
+            }
+            node = next;
+        }
+
+        if (entry.count == 0) {
+            // 码长超过查表位数，记录走到的节点，解码时从这里逐位继续
+            entry.bits = TABLE_BITS;
+            entry.node = static_cast<uint16_t>(node);
+            table[window] = entry;
+            continue;
         }
+
+        entry.firstBits = static_cast<uint8_t>(used);
+        entry.bits = static_cast<uint8_t>(used);
+
+        // 尝试在剩余位中再解出一个符号
+        node = 0;
+        unsigned usedSecond = used;
+        while (usedSecond < TABLE_BITS) {
+            unsigned bit = (window >> (TABLE_BITS - 1 - usedSecond)) & 1;
+            int32_t next = nodes[node].child[bit];
+            ++usedSecond;
+            if (next < 0) {
+                entry.symbols[entry.count++] = static_cast<unsigned char>(~next);
+                entry.bits = static_cast<uint8_t>(usedSecond);
+                break;
+            }
+            node = next;
+        }
+        table[window] = entry;
     }
-    
-    // 移除填充位
-    if (padding > 0 && bitString.size() >= padding) {
-        bitString = bitString.substr(0, bitString.size() - padding);
+}
+
+void HuffmanDecoder::reset(const unsigned char* data, size_t size, uint64_t bitLimit) {
+    begin = data;
+    cursor = data;
+    end = data + size;
+    limit = bitLimit;
+    bitBuffer = 0;
+    bitCount = 0;
+    paddingBytes = 0;
+}
+
+uint64_t HuffmanDecoder::consumedBits() const {
+    return (static_cast<uint64_t>(cursor - begin) + paddingBytes) * 8 - bitCount;
+}
+
+// 补充位缓冲区，保证至少有57位可用
+void HuffmanDecoder::refill() {
+    if (end - cursor >= 8) {
+        // 一次装入8个字节，只推进完整装入的字节数；
+        // 多装入的低位在下次补充时会被相同的值覆盖
+        bitBuffer |= loadBigEndian64(cursor) >> bitCount;
+        cursor += (63 - bitCount) >> 3;
+        bitCount |= 56;
+        return;
+    }
+    while (bitCount <= 56) {
+        uint64_t byte = 0;
+        if (cursor < end) {
+            byte = *cursor++;
+        } else {
+            // 越过码流末尾时补零，最后通过consumedBits检查是否越界
+            ++paddingBytes;
+        }
+        bitBuffer |= byte << (56 - bitCount);
+        bitCount += 8;
     }
-    
-    return bitString;
 }
 
-void HuffmanCompressor::writeIntToFile(std::ofstream& outFile, unsigned int value) {
-    outFile.write(reinterpret_cast<const char*>(&value), sizeof(value));
+bool HuffmanDecoder::decode(unsigned char* out, size_t count) {
+    if (singleSymbol) {
+        std::memset(out, onlySymbol, count);
+        return true;
+    }
+    if (table.empty()) {
+        return false;
+    }
+
+    size_t produced = 0;
+    while (produced < count) {
+        if (bitCount < 4 * TABLE_BITS) {
+            refill();
+        }
+
+        const Entry& entry = table[bitBuffer >> (64 - TABLE_BITS)];
+        if (entry.count == 2 && produced + 1 < count) {
+            out[produced++] = entry.symbols[0];
+            out[produced++] = entry.symbols[1];
+            bitBuffer <<= entry.bits;
+            bitCount -= entry.bits;
+        } else if (entry.count != 0) {
+            out[produced++] = entry.symbols[0];
+            bitBuffer <<= entry.firstBits;
+            bitCount -= entry.firstBits;
+        } else {
+            // 长码：跳过已查表的位，从记录的节点逐位遍历
+            bitBuffer <<= TABLE_BITS;
+            bitCount -= TABLE_BITS;
+            int32_t node = entry.node;
+            while (true) {
+                if (bitCount == 0) {
+                    refill();
+                }
+                unsigned bit = static_cast<unsigned>(bitBuffer >> 63);
+                bitBuffer <<= 1;
+                --bitCount;
+                int32_t next = nodes[node].child[bit];
+                if (next < 0) {
+                    out[produced++] = static_cast<unsigned char>(~next);
+                    break;
+                }
+                node = next;
+            }
+        }
+    }
+
+    return consumedBits() <= limit;
+}
+
+bool HuffmanEncoder::buildFromLengths(const uint8_t newLengths[256]) {
+    accumulator = 0;
+    accumulatedBits = 0;
+    if (!assignCanonicalCodes(newLengths, codes)) {
+        return false;
+    }
+    std::copy(newLengths, newLengths + 256, lengths);
+    return true;
+}
+
+uint64_t HuffmanEncoder::encodedBits(const uint64_t frequencies[256]) const {
+    uint64_t bits = 0;
+    for (int symbol = 0; symbol < 256; ++symbol) {
+        bits += frequencies[symbol] * lengths[symbol];
+    }
+    return bits;
+}
+
+void HuffmanEncoder::encode(const unsigned char* data, size_t size, std::vector<unsigned char>& out) {
+    // 预留最坏情况的空间，循环内只做指针写入
+    unsigned maxLength = *std::max_element(std::begin(lengths), std::end(lengths));
+    size_t start = out.size();
+    out.resize(start + (static_cast<uint64_t>(size) * maxLength + 63) / 64 * 8 + 8);
+    unsigned char* writePtr = out.data() + start;
+
+    uint64_t acc = accumulator;
+    unsigned accBits = accumulatedBits;
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char symbol = data[i];
+        uint64_t code = codes[symbol];
+        unsigned length = lengths[symbol];
+        if (accBits + length < 64) {
+            acc = (acc << length) | code;
+            accBits += length;
+        } else {
+            // 先填满当前字并写出，剩余的低位留在累加器中
+            unsigned room = 64 - accBits;
+            unsigned rest = length - room;
+            acc = (acc << room) | (code >> rest);
+            storeBigEndian64(writePtr, acc);
+            writePtr += 8;
+            acc = rest > 0 ? (code & ((uint64_t(1) << rest) - 1)) : 0;
+            accBits = rest;
+        }
+    }
+    accumulator = acc;
+    accumulatedBits = accBits;
+    out.resize(writePtr - out.data());
 }
 
-unsigned int HuffmanCompressor::readIntFromFile(std::ifstream& inFile) {
-    unsigned int value;
-    inFile.read(reinterpret_cast<char*>(&value), sizeof(value));
+int HuffmanEncoder::finish(std::vector<unsigned char>& out) {
+    int padding = (8 - static_cast<int>(accumulatedBits % 8)) % 8;
+    if (accumulatedBits > 0) {
+        uint64_t aligned = accumulator << (64 - accumulatedBits);
+        unsigned bytes = (accumulatedBits + 7) / 8;
+        for (unsigned i = 0; i < bytes; ++i) {
+            out.push_back(static_cast<unsigned char>(aligned >> (56 - 8 * i)));
+        }
+    }
+    accumulator = 0;
+    accumulatedBits = 0;
+    return padding;
+}
+
+HuffmanCompressor::HuffmanCompressor() : blockSize(DEFAULT_BLOCK_SIZE), threadCount(1) {
+    setThreadCount(0);
+}
+
+HuffmanCompressor::~HuffmanCompressor() {}
+
+void HuffmanCompressor::setBlockSize(size_t size) {
+    // 块大小必须能用32位表示，并限制上限以约束内存占用
+    blockSize = std::max<size_t>(1, std::min(size, MAX_BLOCK_SIZE));
+}
+
+void HuffmanCompressor::setThreadCount(size_t count) {
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = count;
+}
+
+void HuffmanCompressor::forEachSlot(size_t count, const std::function<void(size_t)>& fn) {
+    if (threadCount <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    ThreadPool::shared().parallelFor(count, fn, threadCount);
+}
+
+unsigned int HuffmanCompressor::readIntFromStream(std::istream& in) {
+    unsigned int value = 0;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
     return value;
 }
 
-// 旧的char版本方法，保留以兼容现有代码
-HuffmanNode* HuffmanCompressor::buildHuffmanTreeChar(const std::unordered_map<char, unsigned int>& freqMap) {
-    // 转换为unsigned char频率表
-    std::unordered_map<unsigned char, unsigned int> freqMapUnsigned;
-    for (const auto& pair : freqMap) {
-        freqMapUnsigned[static_cast<unsigned char>(pair.first)] = pair.second;
+void HuffmanCompressor::encodeBlock(const unsigned char* data, size_t size, std::vector<unsigned char>& out) {
+    // 1. 统计频率
+    uint64_t frequencies[256] = {};
+    ByteHistogram::count(data, size, frequencies);
+
+    // 2. 由Huffman树得到码长，限制在4位可表示的范围内，再分配范式码字
+    HuffmanTree tree;
+    tree.build(frequencies);
+    uint8_t lengths[256];
+    tree.codeLengths(lengths);
+    size_t symbolCount = static_cast<size_t>(tree.leafCount);
+
+    HuffmanEncoder encoder;
+    uint64_t totalBits = 0;
+    if (symbolCount > 1) {
+        limitCodeLengths(lengths, frequencies, MAX_HEADER_CODE_LENGTH);
+        encoder.buildFromLengths(lengths);
+        totalBits = encoder.encodedBits(frequencies);
+    }
+
+    // 3. 码长表取稠密/稀疏两种形式中较小的一种；编码后不会变小时原样存储
+    size_t sparseBytes = 1 + symbolCount + (symbolCount + 1) / 2;
+    bool sparse = symbolCount < 256 && sparseBytes <= DENSE_LENGTHS_SIZE;
+    size_t tableBytes = sparse ? sparseBytes : DENSE_LENGTHS_SIZE;
+    uint64_t bodySize = tableBytes + (totalBits + 7) / 8;
+    putLittleEndian32(out, static_cast<uint32_t>(size));
+    if (symbolCount == 0 || bodySize >= size) {
+        out.push_back(BLOCK_STORED);
+        putLittleEndian32(out, static_cast<uint32_t>(size));
+        out.insert(out.end(), data, data + size);
+        return;
+    }
+    out.push_back(sparse ? BLOCK_LENGTHS_SPARSE : BLOCK_LENGTHS_DENSE);
+    putLittleEndian32(out, static_cast<uint32_t>(bodySize));
+
+    // 4. 码长表，每个码长占4位（偶数下标在高4位）
+    if (sparse) {
+        // 符号个数 + 按升序排列的符号 + 对应的码长
+        out.push_back(static_cast<unsigned char>(symbolCount));
+        std::vector<unsigned char> packed((symbolCount + 1) / 2, 0);
+        size_t index = 0;
+        for (int symbol = 0; symbol < 256; ++symbol) {
+            if (frequencies[symbol] > 0) {
+                out.push_back(static_cast<unsigned char>(symbol));
+                packed[index / 2] |= static_cast<unsigned char>(lengths[symbol] << ((index % 2) ? 0 : 4));
+                ++index;
+            }
+        }
+        out.insert(out.end(), packed.begin(), packed.end());
+    } else {
+        for (int symbol = 0; symbol < 256; symbol += 2) {
+            out.push_back(static_cast<unsigned char>((lengths[symbol] << 4) | lengths[symbol + 1]));
+        }
+    }
+
+    // 5. 码流（只有一种符号时码长为0，没有码流）
+    if (symbolCount > 1) {
+        encoder.encode(data, size, out);
+        encoder.finish(out);
+    }
+}
+
+// 按码长表解码码流；payload必须恰好包含解出size个符号所需的字节
+static bool decodeWithLengths(const uint8_t lengths[256], const unsigned char* payload, size_t payloadSize,
+                              uint64_t bitLimit, unsigned char* out, size_t size) {
+    HuffmanDecoder decoder;
+    if (!decoder.buildFromLengths(lengths)) {
+        return false;
+    }
+    decoder.reset(payload, payloadSize, bitLimit);
+    if (!decoder.decode(out, size)) {
+        return false;
+    }
+    return (decoder.consumedBits() + 7) / 8 == payloadSize;
+}
+
+bool HuffmanCompressor::decodeBlock(uint8_t type, const unsigned char* body, size_t bodySize,
+                                    unsigned char* out, size_t size) {
+    switch (type) {
+        case BLOCK_STORED:
+            if (bodySize != size) {
+                return false;
+            }
+            std::memcpy(out, body, size);
+            return true;
+        case BLOCK_LENGTHS_DENSE:
+        case BLOCK_LENGTHS_SPARSE:
+            return decodeLengthsBlock(type, body, bodySize, out, size);
+        default:
+            return false;
+    }
+}
+
+bool HuffmanCompressor::decodeLengthsBlock(uint8_t type, const unsigned char* body, size_t bodySize,
+                                           unsigned char* out, size_t size) {
+    // 1. 读取码长表
+    uint8_t lengths[256] = {};
+    size_t tableBytes;
+    if (type == BLOCK_LENGTHS_DENSE) {
+        tableBytes = DENSE_LENGTHS_SIZE;
+        if (bodySize < tableBytes) {
+            return false;
+        }
+        for (int symbol = 0; symbol < 256; symbol += 2) {
+            lengths[symbol] = body[symbol / 2] >> 4;
+            lengths[symbol + 1] = body[symbol / 2] & 0x0F;
+        }
+    } else {
+        if (bodySize < 1) {
+            return false;
+        }
+        size_t symbolCount = body[0];
+        tableBytes = 1 + symbolCount + (symbolCount + 1) / 2;
+        if (symbolCount == 0 || bodySize < tableBytes) {
+            return false;
+        }
+        const unsigned char* symbols = body + 1;
+        const unsigned char* packed = symbols + symbolCount;
+
+        // 只有一种符号：码长为0，没有码流
+        if (symbolCount == 1) {
+            if ((packed[0] >> 4) != 0 || bodySize != tableBytes) {
+                return false;
+            }
+            std::memset(out, symbols[0], size);
+            return true;
+        }
+        for (size_t i = 0; i < symbolCount; ++i) {
+            if (i > 0 && symbols[i] <= symbols[i - 1]) {
+                return false;
+            }
+            lengths[symbols[i]] = (i % 2) ? (packed[i / 2] & 0x0F) : (packed[i / 2] >> 4);
+        }
     }
-    return buildHuffmanTree(freqMapUnsigned);
+
+    // 2. 由码长重建范式码并解码
+    const unsigned char* payload = body + tableBytes;
+    size_t payloadSize = bodySize - tableBytes;
+    return decodeWithLengths(lengths, payload, payloadSize, static_cast<uint64_t>(payloadSize) * 8, out, size);
 }
 
-// 旧的unsigned char版本方法，保留以兼容现有代码
-HuffmanNode* HuffmanCompressor::buildHuffmanTreeUnsignedChar(const std::unordered_map<unsigned char, unsigned int>& freqMap) {
-    return buildHuffmanTree(freqMap);
+bool HuffmanCompressor::compressStream(std::istream& in, std::ostream& out) {
+    lastStats = HuffmanStats();
+    auto startTime = std::chrono::steady_clock::now();
+
+    // 文件头
+    out.write(HUFF_MAGIC, sizeof(HUFF_MAGIC));
+    out.put(static_cast<char>(HUFF_VERSION));
+    uint64_t outputBytes = sizeof(HUFF_MAGIC) + 1;
+
+    // 固定数量的槽位循环使用，内存占用与文件大小无关
+    std::vector<BlockSlot> ring(ringSize());
+    uint64_t totalSize = 0;
+    bool endOfInput = false;
+    while (!endOfInput) {
+        // 1. 依次填满各槽位
+        size_t filled = 0;
+        while (filled < ring.size()) {
+            // 槽位还没有容纳整块的空间时先读一小段，小文件不必分配（更不必清零）整个数据块；
+            // 读满了再扩大到整块继续读。缓冲区扩大时不清零，随后被读入的数据覆盖
+            BlockSlot& slot = ring[filled];
+            size_t request = slot.raw.capacity() >= blockSize ? blockSize : std::min(blockSize, FIRST_READ_SIZE);
+            slot.raw.resize(request);
+            in.read(reinterpret_cast<char*>(slot.raw.data()), request);
+            size_t count = static_cast<size_t>(in.gcount());
+            if (count == request && request < blockSize) {
+                slot.raw.resize(blockSize);
+                in.read(reinterpret_cast<char*>(slot.raw.data() + count), blockSize - count);
+                count += static_cast<size_t>(in.gcount());
+            }
+            if (in.bad()) {
+                return false;
+            }
+            slot.raw.resize(count);
+            if (count > 0) {
+                ++filled;
+            }
+            if (count < blockSize) {
+                endOfInput = true;
+                break;
+            }
+        }
+
+        // 2. 并行编码
+        forEachSlot(filled, [this, &ring](size_t i) {
+            ring[i].encoded.clear();
+            encodeBlock(ring[i].raw.data(), ring[i].raw.size(), ring[i].encoded);
+        });
+
+        // 3. 按顺序写出
+        for (size_t i = 0; i < filled; ++i) {
+            out.write(reinterpret_cast<const char*>(ring[i].encoded.data()), ring[i].encoded.size());
+            outputBytes += ring[i].encoded.size();
+            totalSize += ring[i].raw.size();
+        }
+        if (!out) {
+            return false;
+        }
+    }
+
+    // 结束块：原始大小为0，随后是原始数据总大小
+    std::vector<unsigned char> trailer;
+    putLittleEndian32(trailer, 0);
+    putLittleEndian64(trailer, totalSize);
+    out.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+    outputBytes += trailer.size();
+    if (!out) {
+        return false;
+    }
+
+    lastStats.inputBytes = totalSize;
+    lastStats.outputBytes = outputBytes;
+    lastStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+bool HuffmanCompressor::decompressBlocks(std::istream& in, std::ostream& out) {
+    std::vector<BlockSlot> ring(ringSize());
+    uint64_t totalSize = 0;
+    uint64_t inputBytes = sizeof(HUFF_MAGIC) + 1;
+    while (true) {
+        // 1. 读入若干个块
+        size_t filled = 0;
+        bool finished = false;
+        uint64_t declaredSize = 0;
+        while (filled < ring.size()) {
+            unsigned char header[BLOCK_HEADER_SIZE];
+            if (!in.read(reinterpret_cast<char*>(header), 4)) {
+                return false;
+            }
+            uint32_t rawSize = getLittleEndian32(header);
+            if (rawSize == 0) {
+                unsigned char sizeBytes[8];
+                if (!in.read(reinterpret_cast<char*>(sizeBytes), sizeof(sizeBytes))) {
+                    return false;
+                }
+                declaredSize = getLittleEndian64(sizeBytes);
+                inputBytes += 4 + sizeof(sizeBytes);
+                finished = true;
+                break;
+            }
+            if (!in.read(reinterpret_cast<char*>(header + 4), BLOCK_HEADER_SIZE - 4)) {
+                return false;
+            }
+            uint8_t type = header[4];
+            uint32_t bodySize = getLittleEndian32(header + 5);
+            // 块体不会比原始数据大，据此拒绝损坏的块头，避免分配过大的内存；未知的块类型同样视为损坏
+            if (rawSize > MAX_BLOCK_SIZE || bodySize > rawSize ||
+                (type != BLOCK_STORED && type != BLOCK_LENGTHS_DENSE && type != BLOCK_LENGTHS_SPARSE)) {
+                return false;
+            }
+            BlockSlot& slot = ring[filled];
+            slot.type = type;
+            slot.encoded.resize(bodySize);
+            if (!in.read(reinterpret_cast<char*>(slot.encoded.data()), bodySize)) {
+                return false;
+            }
+            slot.raw.resize(rawSize);
+            inputBytes += BLOCK_HEADER_SIZE + bodySize;
+            ++filled;
+        }
+
+        // 2. 并行解码
+        std::vector<char> decoded(filled, 0);
+        forEachSlot(filled, [this, &ring, &decoded](size_t i) {
+            BlockSlot& slot = ring[i];
+            decoded[i] = decodeBlock(slot.type, slot.encoded.data(), slot.encoded.size(), slot.raw.data(), slot.raw.size());
+        });
+        if (std::find(decoded.begin(), decoded.end(), 0) != decoded.end()) {
+            return false;
+        }
+
+        // 3. 按顺序写出
+        for (size_t i = 0; i < filled; ++i) {
+            out.write(reinterpret_cast<const char*>(ring[i].raw.data()), ring[i].raw.size());
+            totalSize += ring[i].raw.size();
+        }
+        if (!out) {
+            return false;
+        }
+
+        if (finished) {
+            lastStats.inputBytes = inputBytes;
+            lastStats.outputBytes = totalSize;
+            return declaredSize == totalSize;
+        }
+    }
 }
 
-// 旧的char版本方法，保留以兼容现有代码
-void HuffmanCompressor::generateCodesChar(HuffmanNode* root, const std::string& code, std::unordered_map<char, std::string>& huffmanCodes) {
-    // 生成unsigned char编码表
-    std::unordered_map<unsigned char, std::string> huffmanCodesUnsigned;
-    generateCodes(root, code, huffmanCodesUnsigned);
+bool HuffmanCompressor::decompressLegacy(std::istream& in, std::ostream& out, int firstByte) {
+    // 1. 填充位数
+    int padding = firstByte;
+    
+    // 2. 读取字符种类数
+    unsigned int charCount = readIntFromStream(in);
+    if (!in || padding > 7 || charCount > 256) {
+        // 不是有效的Huffman压缩文件
+        return false;
+    }
     
-    // 转换为char编码表
-    for (const auto& pair : huffmanCodesUnsigned) {
-        huffmanCodes[static_cast<char>(pair.first)] = pair.second;
+    // 3. 读取频率表
+    uint64_t frequencies[256] = {};
+    for (unsigned int i = 0; i < charCount; i++) {
+        char ch;
+        in.get(ch);
+        unsigned int freq = readIntFromStream(in);
+        frequencies[static_cast<unsigned char>(ch)] = freq;
     }
+    
+    // 4. 读取原始数据大小
+    unsigned int originalSize = readIntFromStream(in);
+    if (!in) {
+        return false;
+    }
+    
+    // 处理空文件
+    if (originalSize == 0) {
+        return true;
+    }
+    
+    // 5. 重建Huffman树（v1使用树形码字，必须按原来的树解码）
+    HuffmanTree tree;
+    tree.build(frequencies);
+    HuffmanDecoder decoder;
+    if (!decoder.build(tree)) {
+        return false;
+    }
+    
+    // 6. 读取压缩后的数据（只保留压缩后的字节，不展开为位串）
+    //    v1没有分块，整个码流都在内存中，占用与压缩数据大小成正比；只有v2格式是有界的
+    std::vector<unsigned char> compressedData;
+    std::vector<unsigned char> buffer(DECODE_CHUNK_SIZE);
+    while (in) {
+        in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        compressedData.insert(compressedData.end(), buffer.begin(), buffer.begin() + in.gcount());
+    }
+    
+    uint64_t totalBits = static_cast<uint64_t>(compressedData.size()) * 8;
+    if (static_cast<uint64_t>(padding) > totalBits) {
+        return false;
+    }
+    totalBits -= padding;
+    decoder.reset(compressedData.data(), compressedData.size(), totalBits);
+    
+    // 7. 分块解码并写出
+    std::vector<unsigned char> chunk(std::min<size_t>(originalSize, DECODE_CHUNK_SIZE));
+    uint64_t remaining = originalSize;
+    while (remaining > 0) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(remaining, chunk.size()));
+        if (!decoder.decode(chunk.data(), count)) {
+            // 码流在还原出全部数据之前耗尽，文件已损坏
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(chunk.data()), count);
+        remaining -= count;
+    }
+    
+    lastStats.inputBytes = compressedData.size();
+    lastStats.outputBytes = originalSize;
+    return static_cast<bool>(out);
 }
 
-// 旧的unsigned char版本方法，保留以兼容现有代码
-void HuffmanCompressor::generateCodesUnsignedChar(HuffmanNode* root, const std::string& code, std::unordered_map<unsigned char, std::string>& huffmanCodes) {
-    generateCodes(root, code, huffmanCodes);
+bool HuffmanCompressor::decompressStream(std::istream& in, std::ostream& out) {
+    lastStats = HuffmanStats();
+    auto startTime = std::chrono::steady_clock::now();
+    
+    int firstByte = in.get();
+    if (firstByte == std::char_traits<char>::eof()) {
+        return false;
+    }
+    
+    bool success;
+    if (firstByte == static_cast<unsigned char>(HUFF_MAGIC[0])) {
+        // v2格式：校验文件头
+        char header[sizeof(HUFF_MAGIC)];
+        header[0] = static_cast<char>(firstByte);
+        in.read(header + 1, sizeof(HUFF_MAGIC) - 1);
+        int version = in.get();
+        if (!in || std::memcmp(header, HUFF_MAGIC, sizeof(HUFF_MAGIC)) != 0 || version != HUFF_VERSION) {
+            return false;
+        }
+        success = decompressBlocks(in, out);
+    } else {
+        // v1格式的第一个字节是填充位数（0~7），不会与魔数冲突
+        success = decompressLegacy(in, out, firstByte);
+    }
+    
+    lastStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return success;
+}
+
+bool HuffmanCompressor::isWorthCompressing(const std::string& inputFilePath) const {
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(inputFilePath, ec);
+    if (ec) {
+        // 无法判断时交给压缩本身决定
+        return true;
+    }
+    if (size == 0) {
+        return false;
+    }
+    std::ifstream inFile(inputFilePath, std::ios::binary);
+    if (!inFile.is_open()) {
+        return true;
+    }
+
+    // 1. 小文件整体采样，大文件均匀选取MAX_SAMPLES个窗口
+    uint64_t windowCount = std::min<uint64_t>(MAX_SAMPLES, (size + SAMPLE_WINDOW - 1) / SAMPLE_WINDOW);
+    bool sampleAll = size <= static_cast<uint64_t>(SAMPLE_WINDOW) * MAX_SAMPLES;
+    std::vector<unsigned char> window(SAMPLE_WINDOW);
+    double estimatedBits = 0.0;
+    uint64_t sampledBytes = 0;
+    for (uint64_t i = 0; i < windowCount; ++i) {
+        uint64_t offset = sampleAll ? i * SAMPLE_WINDOW
+                                    : (windowCount > 1 ? i * ((size - SAMPLE_WINDOW) / (windowCount - 1)) : 0);
+        inFile.seekg(static_cast<std::streamoff>(offset));
+        inFile.read(reinterpret_cast<char*>(window.data()), window.size());
+        size_t count = static_cast<size_t>(inFile.gcount());
+        inFile.clear();
+        if (count == 0) {
+            break;
+        }
+
+        // 2. 每个窗口单独统计，与按块建码表的方式一致；熵是Huffman编码长度的下界
+        uint64_t counts[256] = {};
+        ByteHistogram::count(window.data(), count, counts);
+        estimatedBits += ByteHistogram::entropy(counts) * count;
+        sampledBytes += count;
+    }
+    if (sampledBytes == 0) {
+        return true;
+    }
+
+    // 3. 按采样比例推算全文件，加上文件头、块头、码长表和结束块的开销
+    uint64_t blocks = (size + blockSize - 1) / blockSize;
+    double estimatedSize = estimatedBits / 8.0 / static_cast<double>(sampledBytes) * static_cast<double>(size) +
+                           sizeof(HUFF_MAGIC) + 1 + 12 + static_cast<double>(blocks) * (BLOCK_HEADER_SIZE + DENSE_LENGTHS_SIZE);
+    return estimatedSize < static_cast<double>(size) * (1.0 - MIN_SAVING_RATIO);
 }
 
 bool HuffmanCompressor::compressFile(const std::string& inputFilePath, const std::string& outputFilePath) {
-    // 初始化root为nullptr
-    root = nullptr;
-    
     try {
-        // 1. 读取输入文件内容
         std::ifstream inFile(inputFilePath, std::ios::binary);
         if (!inFile.is_open()) {
             return false;
         }
         
-        // 获取文件大小
-        inFile.seekg(0, std::ios::end);
-        std::streampos fileSize = inFile.tellg();
-        inFile.seekg(0, std::ios::beg);
-        
-        // 读取文件内容
-        std::vector<unsigned char> inputData(fileSize);
-        inFile.read(reinterpret_cast<char*>(inputData.data()), fileSize);
-        inFile.close();
-        
-        // 2. 写入压缩文件
         std::ofstream outFile(outputFilePath, std::ios::binary);
         if (!outFile.is_open()) {
             return false;
         }
         
-        // 处理空文件
-        if (inputData.empty()) {
-            // 空文件的情况：写入0作为填充位
-            outFile.put(0);
-            // 写入0作为字符种类数（使用unsigned int，与正常情况一致）
-            unsigned int charCount = 0;
-            outFile.write(reinterpret_cast<const char*>(&charCount), sizeof(charCount));
-            // 写入原始大小0
-            writeIntToFile(outFile, 0);
-            // 没有压缩数据
-            outFile.close();
-            return true;
-        }
-        
-        // 计算字符频率
-        std::unordered_map<unsigned char, unsigned int> freqMap;
-        for (unsigned char ch : inputData) {
-            freqMap[ch]++;
-        }
-        
-        // 3. 构建Huffman树
-        root = buildHuffmanTree(freqMap);
-        if (root == nullptr) {
+        if (!compressStream(inFile, outFile)) {
             outFile.close();
             return false;
         }
         
-        // 4. 生成Huffman编码
-        std::unordered_map<unsigned char, std::string> huffmanCodes;
-        generateCodes(root, "", huffmanCodes);
-        
-        // 5. 构建压缩后的位串
-        std::string encodedData;
-        for (unsigned char ch : inputData) {
-            encodedData += huffmanCodes[ch];
-        }
-        
-        // 6. 计算需要添加的填充位数
-        int padding = (8 - (encodedData.size() % 8)) % 8;
-        
-        // 7. 将位串转换为字节序列
-        std::vector<unsigned char> bytes = bitStringToBytes(encodedData);
-        
-        // 8. 写入压缩文件
-        
-        // 写入填充位数
-        outFile.put(static_cast<char>(padding));
-        
-        // 写入字符种类数（使用unsigned int以支持更多种类的字符）
-        unsigned int charCount = static_cast<unsigned int>(freqMap.size());
-        outFile.write(reinterpret_cast<const char*>(&charCount), sizeof(charCount));
-        
-        // 写入每个字符及其频率
-        for (const auto& pair : freqMap) {
-            outFile.put(pair.first);
-            unsigned int freq = pair.second;
-            outFile.write(reinterpret_cast<const char*>(&freq), sizeof(freq));
-        }
-        
-        // 写入原始数据大小
-        writeIntToFile(outFile, static_cast<unsigned int>(inputData.size()));
-        
-        // 写入压缩后的数据
-        outFile.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
-        
         outFile.close();
-        
-        // 清理资源
-        delete root;
-        root = nullptr;
-        
-        return true;
+        return static_cast<bool>(outFile);
         
     } catch (const std::exception& e) {
-        delete root;
-        root = nullptr;
         return false;
     }
 }
 
 bool HuffmanCompressor::decompressFile(const std::string& inputFilePath, const std::string& outputFilePath) {
-    // 初始化root为nullptr
-    root = nullptr;
-    
     try {
-        // 1. 读取压缩文件
         std::ifstream inFile(inputFilePath, std::ios::binary);
         if (!inFile.is_open()) {
             return false;
         }
         
-        // 2. 读取填充位数
-        char paddingChar;
-        inFile.get(paddingChar);
-        int padding = static_cast<unsigned char>(paddingChar);
-        
-        // 3. 读取字符种类数
-        unsigned int charCount;
-        inFile.read(reinterpret_cast<char*>(&charCount), sizeof(charCount));
-        
-        // 4. 读取频率表
-        std::unordered_map<unsigned char, unsigned int> freqMap;
-        for (unsigned int i = 0; i < charCount; i++) {
-            char ch;
-            inFile.get(ch);
-            unsigned int freq;
-            inFile.read(reinterpret_cast<char*>(&freq), sizeof(freq));
-            freqMap[static_cast<unsigned char>(ch)] = freq;
-        }
-        
-        // 5. 读取原始数据大小
-        unsigned int originalSize = readIntFromFile(inFile);
-        
-        // 处理空文件
-        if (originalSize == 0) {
-            // 空文件的情况：直接创建空文件
-            std::ofstream outFile(outputFilePath, std::ios::binary);
-            if (!outFile.is_open()) {
-                inFile.close();
-                return false;
-            }
-            outFile.close();
-            inFile.close();
-            return true;
-        }
-        
-        // 6. 重建Huffman树
-        root = buildHuffmanTree(freqMap);
-        if (root == nullptr) {
-            inFile.close();
+        std::ofstream outFile(outputFilePath, std::ios::binary);
+        if (!outFile.is_open()) {
             return false;
         }
         
-        // 7. 读取压缩后的数据
-        // 先保存当前文件指针位置
-        std::streampos currentPos = inFile.tellg();
-        
-        // 将文件指针移动到文件末尾获取文件大小
-        inFile.seekg(0, std::ios::end);
-        std::streampos fileSize = inFile.tellg();
-        
-        // 计算剩余数据大小
-        std::streampos remainingSize = fileSize - currentPos;
-        
-        // 将文件指针恢复到原来的位置
-        inFile.seekg(currentPos, std::ios::beg);
-        
-        // 读取剩余数据
-        std::vector<unsigned char> compressedData(remainingSize);
-        inFile.read(reinterpret_cast<char*>(compressedData.data()), remainingSize);
-        inFile.close();
-        
-        // 8. 将压缩数据转换为位串
-        std::string encodedData = bytesToBitString(compressedData, padding);
-        
-        // 9. 解码数据
-        std::vector<unsigned char> decodedData;
-        decodedData.reserve(originalSize);
-        
-        // 处理特殊情况：只有一个字符的情况
-        if (root->isLeaf) {
-            // 只有一个字符，直接填充originalSize个该字符
-            decodedData.insert(decodedData.end(), originalSize, root->data);
-        } else {
-            // 正常解码
-            HuffmanNode* current = root;
-            for (size_t i = 0; i < encodedData.size() && decodedData.size() < originalSize; ++i) {
-                char bit = encodedData[i];
-                if (bit == '0') {
-                    current = current->left;
-                } else {
-                    current = current->right;
-                }
-                
-                // 确保current不为nullptr
-                if (current == nullptr) {
-                    break; // 遇到无效的编码，提前结束
-                }
-                
-                // 如果到达叶子节点
-                if (current->isLeaf) {
-                    decodedData.push_back(current->data);
-                    current = root;
-                }
-            }
-        }
-        
-        // 10. 写入解压文件
-        std::ofstream outFile(outputFilePath, std::ios::binary);
-        if (!outFile.is_open()) {
-            delete root;
-            root = nullptr;
+        if (!decompressStream(inFile, outFile)) {
+            outFile.close();
             return false;
         }
         
-        outFile.write(reinterpret_cast<const char*>(decodedData.data()), decodedData.size());
         outFile.close();
-        
-        // 清理资源
-        delete root;
-        root = nullptr;
-        
-        return true;
+        return static_cast<bool>(outFile);
         
     } catch (const std::exception& e) {
-        delete root;
-        root = nullptr;
         return false;
     }
-}
\ No newline at end of file
+}
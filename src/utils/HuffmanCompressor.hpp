@@ -2,103 +2,264 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <queue>
 #include <iostream>
 #include <fstream>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
-// Huffman节点结构体
-struct HuffmanNode {
-    unsigned char data;     // 存储的字符，使用unsigned char支持所有字节值
-    unsigned int freq;      // 字符出现频率
-    HuffmanNode* left;      // 左子节点
-    HuffmanNode* right;     // 右子节点
-    bool isLeaf;            // 标记是否为叶节点
-    unsigned int id;        // 唯一ID，确保比较器的一致性
-    static unsigned int nextId; // 静态计数器，用于生成唯一ID
-
-    // 叶节点构造函数
-    HuffmanNode(unsigned char data, unsigned int freq) 
-        : data(data), freq(freq), left(nullptr), right(nullptr), isLeaf(true), id(nextId++) {}
-    
-    // 内部节点构造函数
-    HuffmanNode(unsigned int freq, HuffmanNode* left, HuffmanNode* right) 
-        : data(0), freq(freq), left(left), right(right), isLeaf(false), id(nextId++) {}
-    
-    ~HuffmanNode() {
-        delete left;
-        delete right;
+
+// 数组形式的Huffman树
+// 最多256个叶节点和255个内部节点，全部存放在固定大小的数组中，不需要逐个分配和递归释放节点；
+// 前leafCount个节点是按符号值排列的叶节点，其后依次是合并出的内部节点，根节点在最后
+struct HuffmanTree {
+    static constexpr int MAX_NODES = 511;
+
+    struct Node {
+        uint64_t freq;        // 频率
+        int16_t child[2];     // 左、右子节点下标，叶节点为-1
+        unsigned char symbol; // 叶节点的符号
+        bool isLeaf;
+    };
+
+    Node nodes[MAX_NODES];
+    int leafCount = 0;
+    int root = -1;  // 频率全为0时为-1
+
+    // 由频率表建树，频率为0的符号不参与
+    // 频率相同时叶节点优先于内部节点，叶节点之间按符号值、内部节点之间按创建顺序排序，
+    // 保证同一频率表总是得到同一棵树（与v1格式写入时的树一致）
+    void build(const uint64_t frequencies[256]);
+
+    bool empty() const { return root < 0; }
+
+    // 计算每个符号的码长（只有一个符号时码长为0）
+    void codeLengths(uint8_t lengths[256]) const;
+};
+
+// 一次压缩/解压操作的统计信息
+struct HuffmanStats {
+    uint64_t inputBytes = 0;   // 读入的字节数
+    uint64_t outputBytes = 0;  // 写出的字节数
+    double seconds = 0.0;      // 编解码耗时（秒）
+
+    // 以未压缩数据量计算的吞吐率（MB/s）
+    double throughputMBps(uint64_t rawBytes) const {
+        return seconds > 0.0 ? static_cast<double>(rawBytes) / (1024.0 * 1024.0) / seconds : 0.0;
     }
 };
 
+// 查表式Huffman解码器
+// 用64位位缓冲区按高位优先读取码流，每次查表解出一个或两个符号；
+// 码长超过TABLE_BITS的少数符号从表项记录的树节点继续逐位遍历
+class HuffmanDecoder {
+public:
+    static constexpr unsigned TABLE_BITS = 11;
+    static constexpr unsigned MAX_CODE_LENGTH = 56; // 位缓冲区一次补充后可保证的最少位数
+
+    // 由Huffman树构建解码表（v1格式的树形码字）
+    bool build(const HuffmanTree& tree);
+
+    // 由码长构建范式码解码表；码长不构成完整前缀码时返回false
+    bool buildFromLengths(const uint8_t lengths[256]);
+
+    // 设置待解码的码流，bitLimit为码流中的有效位数（不含末尾填充）
+    void reset(const unsigned char* data, size_t size, uint64_t bitLimit);
+
+    // 解出count个符号写入out，可多次调用以分段输出；码流不足时返回false
+    bool decode(unsigned char* out, size_t count);
+
+    // 已消耗的位数
+    uint64_t consumedBits() const;
+
+private:
+    // 表项：symbols为解出的符号，count为符号个数（0表示需要逐位遍历），
+    // firstBits为第一个符号的码长，bits为本表项消耗的总位数，node为逐位遍历的起始节点
+    struct Entry {
+        unsigned char symbols[2];
+        uint8_t count;
+        uint8_t firstBits;
+        uint8_t bits;
+        uint8_t reserved;
+        uint16_t node;
+    };
+
+    // 扁平化的树：child >= 0 为内部节点下标，child < 0 为叶节点（~child 即符号）
+    struct FlatNode {
+        int32_t child[2];
+    };
+
+    void buildTable();
+    void refill();
+
+    std::vector<FlatNode> nodes;
+    std::vector<Entry> table;
+    bool singleSymbol = false;
+    unsigned char onlySymbol = 0;
+
+    const unsigned char* begin = nullptr;
+    const unsigned char* cursor = nullptr;
+    const unsigned char* end = nullptr;
+    uint64_t limit = 0;
+    uint64_t bitBuffer = 0;   // 高位对齐的位缓冲区
+    unsigned bitCount = 0;    // 位缓冲区中的有效位数
+    uint64_t paddingBytes = 0; // 越过码流末尾补入的零字节数
+};
+
+// 位打包Huffman编码器
+// 码字存放在256项的数组中，用64位累加器拼接码字，满64位时整字按大端序写出，
+// 输出与逐位拼接的结果完全一致（高位优先，末尾补零）
+class HuffmanEncoder {
+public:
+    // 由码长生成范式码表
+    bool buildFromLengths(const uint8_t lengths[256]);
+
+    // 按给定频率计算编码后的总位数
+    uint64_t encodedBits(const uint64_t frequencies[256]) const;
+
+    // 编码size个字节并追加到out，可多次调用
+    void encode(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+
+    // 写出累加器中剩余的位（末尾补零），返回补零的位数
+    int finish(std::vector<unsigned char>& out);
 
+    // 符号的码长
+    unsigned codeLength(unsigned char symbol) const { return lengths[symbol]; }
 
-// 比较器，用于优先队列，确保Huffman树构建唯一
-struct Compare {
-    bool operator()(HuffmanNode* l, HuffmanNode* r) {
-        // 当频率相同时，按字符值排序，确保生成的Huffman树结构唯一
-        if (l->freq == r->freq) {
-            // 叶节点优先于内部节点
-            if (l->isLeaf && !r->isLeaf) {
-                return false; // 叶节点l优先级高，排在前面
-            }
-            if (!l->isLeaf && r->isLeaf) {
-                return true;  // 内部节点l优先级低，排在后面
-            }
-            // 对于叶节点，按字符值排序
-            if (l->isLeaf && r->isLeaf) {
-                return l->data > r->data;
-            }
-            // 对于内部节点，按唯一ID排序，确保Huffman树构建的一致性
-            return l->id > r->id;
-        }
-        return l->freq > r->freq;
+private:
+    uint64_t codes[256] = {};
+    uint8_t lengths[256] = {};
+    uint64_t accumulator = 0;
+    unsigned accumulatedBits = 0;
+};
+
+// 按码长分配范式Huffman码字：码长短的在前，码长相同时按符号值排序
+// 码长不构成完整前缀码时返回false
+bool assignCanonicalCodes(const uint8_t lengths[256], uint64_t codes[256]);
+
+// 把码长限制在maxLength以内并保持完整前缀码，频率高的符号分到较短的码长
+// 码长本来就不超过maxLength时保持不变
+void limitCodeLengths(uint8_t lengths[256], const uint64_t frequencies[256], unsigned maxLength);
+
+// resize时不做值初始化的分配器：只分配、不清零
+// 用于随后马上被读入或解码结果整个覆盖的缓冲区，省去每次扩大时的memset
+template <typename T>
+struct DefaultInitAllocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = DefaultInitAllocator<U>;
+    };
+
+    DefaultInitAllocator() = default;
+    template <typename U>
+    DefaultInitAllocator(const DefaultInitAllocator<U>&) noexcept {}
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
     }
 };
 
+// Huffman压缩器
+// 新文件使用v2分块格式：
+//   文件头  "BHUF" + 版本号(1字节)
+//   数据块  原始大小(u32) + 块类型(u8) + 块体大小(u32) + 块体
+//   结束块  原始大小为0，随后是原始数据总大小(u64)
+// 每个数据块独立统计频率、独立编码，整数一律按小端序存储；
+// 块内只保存范式码的码长（每个4位，稠密或稀疏形式），相同输入总是得到相同输出；
+// 解压时同时兼容旧的v1格式（单个频率表 + 32位原始大小）；v1没有分块，整个码流读入内存后解码，
+// 内存占用与压缩数据大小成正比（最多约4 GiB），只有v2格式的内存占用是有界的
+// 数据块之间互不依赖，由工作线程并行编解码后按顺序写出，输出与线程数无关
 class HuffmanCompressor {
 public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;  // 默认数据块大小1 MiB
+    static constexpr size_t MAX_BLOCK_SIZE = 64 << 20;     // 数据块大小上限
+    static constexpr size_t RING_SLOTS = 4;                // 环形缓冲区的最少槽位数
+    static constexpr size_t FIRST_READ_SIZE = 64 << 10;    // 压缩时第一次读取的大小，读满后才分配整个数据块
+    static constexpr size_t SAMPLE_WINDOW = 64 << 10;      // 熵估计的采样窗口大小
+    static constexpr size_t MAX_SAMPLES = 16;              // 熵估计最多读取的窗口数
+    static constexpr double MIN_SAVING_RATIO = 0.02;       // 值得压缩的最小节省比例
+
     HuffmanCompressor();
     ~HuffmanCompressor();
 
+    // 最近一次压缩/解压的统计信息
+    const HuffmanStats& getLastStats() const { return lastStats; }
+
+    // 设置压缩时的数据块大小
+    void setBlockSize(size_t size);
+    size_t getBlockSize() const { return blockSize; }
+
+    // 设置编解码的工作线程数，0表示使用全部硬件线程
+    // 工作线程借用进程共享的线程池（ThreadPool::shared），这里只限制同时参与的线程数
+    void setThreadCount(size_t count);
+    size_t getThreadCount() const { return threadCount; }
+
+    // 按采样数据的熵估计压缩后的大小，估计节省不到MIN_SAVING_RATIO时返回false
+    // 只读取少量采样窗口，用于在编码前跳过已压缩过的文件（JPEG、MP4、zip等）
+    bool isWorthCompressing(const std::string& inputFilePath) const;
+
     // 压缩文件
     bool compressFile(const std::string& inputFilePath, const std::string& outputFilePath);
 
     // 解压文件
     bool decompressFile(const std::string& inputFilePath, const std::string& outputFilePath);
 
+    // 流式压缩，内存占用只与数据块大小和槽位数有关
+    bool compressStream(std::istream& in, std::ostream& out);
+
+    // 流式解压，自动识别v1/v2格式
+    bool decompressStream(std::istream& in, std::ostream& out);
+
 private:
-    // 统计字符频率（char版本，兼容旧代码）
-    std::unordered_map<char, unsigned int> calculateFrequency(const std::string& data);
-
-    // 构建Huffman树
-    HuffmanNode* buildHuffmanTree(const std::unordered_map<unsigned char, unsigned int>& freqMap);
-    
-    // 构建Huffman树（char版本，兼容旧代码）
-    HuffmanNode* buildHuffmanTreeChar(const std::unordered_map<char, unsigned int>& freqMap);
-    
-    // 构建Huffman树（unsigned char版本，用于二进制文件处理）
-    HuffmanNode* buildHuffmanTreeUnsignedChar(const std::unordered_map<unsigned char, unsigned int>& freqMap);
-
-    // 生成Huffman编码
-    void generateCodes(HuffmanNode* root, const std::string& code, std::unordered_map<unsigned char, std::string>& huffmanCodes);
-    
-    // 生成Huffman编码（char版本，兼容旧代码）
-    void generateCodesChar(HuffmanNode* root, const std::string& code, std::unordered_map<char, std::string>& huffmanCodes);
-    
-    // 生成Huffman编码（unsigned char版本，用于二进制文件处理）
-    void generateCodesUnsignedChar(HuffmanNode* root, const std::string& code, std::unordered_map<unsigned char, std::string>& huffmanCodes);
-
-    // 将位串转换为字节序列
-    std::vector<unsigned char> bitStringToBytes(const std::string& bitString);
-
-    // 将字节序列转换为位串
-    std::string bytesToBitString(const std::vector<unsigned char>& bytes, int padding);
-
-    // 辅助函数：将整数转换为字节数组
-    void writeIntToFile(std::ofstream& outFile, unsigned int value);
-
-    // 辅助函数：从文件中读取整数
-    unsigned int readIntFromFile(std::ifstream& inFile);
-
-    HuffmanNode* root;  // Huffman树的根节点
-};
\ No newline at end of file
+    // 块类型
+    enum BlockType : uint8_t {
+        BLOCK_STORED = 0,          // 原样存储（编码后不会变小）
+        BLOCK_LENGTHS_DENSE = 2,   // 256个4位码长（128字节） + 范式码码流
+        BLOCK_LENGTHS_SPARSE = 3,  // 符号个数 + 升序符号 + 4位码长 + 范式码码流
+    };
+
+    // 环形缓冲区中的一个槽位
+    struct BlockSlot {
+        std::vector<unsigned char, DefaultInitAllocator<unsigned char>> raw;  // 原始数据，扩大时不清零
+        std::vector<unsigned char> encoded;  // 压缩时为完整的块（含块头），解压时为块体
+        uint8_t type = BLOCK_STORED;
+    };
+
+    // 编码一个数据块，块头和块体追加到out
+    void encodeBlock(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+
+    // 解码一个块体，输出size个字节到out
+    bool decodeBlock(uint8_t type, const unsigned char* body, size_t bodySize, unsigned char* out, size_t size);
+
+    // 解码带码长表的块体（稠密或稀疏形式）
+    bool decodeLengthsBlock(uint8_t type, const unsigned char* body, size_t bodySize, unsigned char* out, size_t size);
+
+    // 解压v1格式，firstByte为已读出的填充位数
+    // v1的码流没有分块、码字可能跨越任意位置，整个码流读入内存后再分段解码输出
+    bool decompressLegacy(std::istream& in, std::ostream& out, int firstByte);
+
+    // 解压v2格式的数据块部分
+    bool decompressBlocks(std::istream& in, std::ostream& out);
+
+    // 对ring中前count个槽位执行fn，多于一个槽位时交给进程共享的线程池，最多threadCount个线程同时处理
+    void forEachSlot(size_t count, const std::function<void(size_t)>& fn);
+
+    // 环形缓冲区的槽位数：每个工作线程两个，使各线程的负载较为均匀
+    size_t ringSize() const { return std::max(RING_SLOTS, 2 * threadCount); }
+
+    // 辅助函数：从v1文件中读取整数
+    unsigned int readIntFromStream(std::istream& in);
+
+    size_t blockSize;       // 压缩时的数据块大小
+    size_t threadCount;     // 工作线程数
+    HuffmanStats lastStats; // 最近一次操作的统计信息
+};
@@ -0,0 +1,438 @@
+#include "LzCompressor.hpp"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // 文件头魔数和版本号
+    constexpr char LZ_MAGIC[3] = {'B', 'L', 'Z'};
+    constexpr int LZ_VERSION = 1;
+
+    // 块头：原始大小(u32) + 块类型(u8) + 块体大小(u32)
+    constexpr size_t BLOCK_HEADER_SIZE = 9;
+
+    // 哈希表：以4字节前缀的哈希值索引最近一次出现的位置
+    constexpr unsigned HASH_BITS = 14;
+
+    // 连续未命中时逐渐加大步长，跳过不可压缩的区域
+    constexpr unsigned SKIP_SHIFT = 6;
+
+    inline uint32_t load32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t load64(const unsigned char* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    // 最低位的1之前有多少个0（value不为0）
+    inline unsigned countTrailingZeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(value));
+#else
+        unsigned count = 0;
+        while ((value & 1) == 0) {
+            value >>= 1;
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    inline uint32_t hash4(uint32_t value) {
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // 从a、b开始比较，返回相同字节数（不超过limit）；按小端序取第一个不同的字节
+    inline size_t matchLength(const unsigned char* a, const unsigned char* b, size_t limit) {
+        size_t length = 0;
+        while (length + 8 <= limit) {
+            uint64_t diff = load64(a + length) ^ load64(b + length);
+            if (diff != 0) {
+                return length + (countTrailingZeros(diff) >> 3);
+            }
+            length += 8;
+        }
+        while (length < limit && a[length] == b[length]) {
+            ++length;
+        }
+        return length;
+    }
+
+    // 长度超过15的部分用若干个255和一个余数表示
+    inline void putLength(std::vector<unsigned char>& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<unsigned char>(length));
+    }
+
+    inline bool getLength(const unsigned char*& cursor, const unsigned char* end, size_t& length) {
+        unsigned char byte;
+        do {
+            if (cursor == end) {
+                return false;
+            }
+            byte = *cursor++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // 输出一个序列：字面量 + 可选的匹配（matchLength为0表示最后一个序列）
+    void putSequence(std::vector<unsigned char>& out, const unsigned char* literals, size_t literalLength,
+                     size_t offset, size_t matchLength) {
+        size_t matchCode = matchLength > 0 ? matchLength - LzCompressor::MIN_MATCH : 0;
+        unsigned char token = static_cast<unsigned char>((std::min<size_t>(literalLength, 15) << 4) |
+                                                         std::min<size_t>(matchCode, 15));
+        out.push_back(token);
+        if (literalLength >= 15) {
+            putLength(out, literalLength - 15);
+        }
+        out.insert(out.end(), literals, literals + literalLength);
+        if (matchLength == 0) {
+            return;
+        }
+        out.push_back(static_cast<unsigned char>(offset));
+        out.push_back(static_cast<unsigned char>(offset >> 8));
+        if (matchCode >= 15) {
+            putLength(out, matchCode - 15);
+        }
+    }
+
+    // 小端序读写
+    inline void putLittleEndian32(std::vector<unsigned char>& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+
+    inline void putLittleEndian64(std::vector<unsigned char>& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+
+    inline uint32_t getLittleEndian32(const unsigned char* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint64_t getLittleEndian64(const unsigned char* p) {
+        return static_cast<uint64_t>(getLittleEndian32(p)) | (static_cast<uint64_t>(getLittleEndian32(p + 4)) << 32);
+    }
+}
+
+LzCompressor::LzCompressor() : blockSize(DEFAULT_BLOCK_SIZE) {}
+
+void LzCompressor::setBlockSize(size_t size) {
+    // 块大小必须能用32位表示，并限制上限以约束内存占用
+    blockSize = std::max<size_t>(1, std::min(size, MAX_BLOCK_SIZE));
+}
+
+void LzCompressor::compressBlock(const unsigned char* data, size_t size, std::vector<unsigned char>& out) {
+    std::vector<int32_t> table(size_t(1) << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t position = 0;
+
+    while (position + MIN_MATCH <= size) {
+        // 1. 查找候选位置并更新哈希表
+        uint32_t sequence = load32(data + position);
+        uint32_t hash = hash4(sequence);
+        int32_t candidate = table[hash];
+        table[hash] = static_cast<int32_t>(position);
+
+        if (candidate < 0 || position - candidate > MAX_OFFSET || load32(data + candidate) != sequence) {
+            position += 1 + ((position - anchor) >> SKIP_SHIFT);
+            continue;
+        }
+
+        // 2. 向后扩展匹配，再尽量向前扩展（吃掉前面相同的字面量）
+        size_t length = MIN_MATCH + matchLength(data + candidate + MIN_MATCH, data + position + MIN_MATCH,
+                                                size - position - MIN_MATCH);
+        size_t start = position;
+        size_t from = static_cast<size_t>(candidate);
+        while (start > anchor && from > 0 && data[start - 1] == data[from - 1]) {
+            --start;
+            --from;
+            ++length;
+        }
+
+        // 3. 输出序列
+        putSequence(out, data + anchor, start - anchor, start - from, length);
+        position = start + length;
+        anchor = position;
+
+        // 匹配末尾的位置也放入哈希表，便于紧接着的下一次匹配
+        if (position >= 2 && position + 2 <= size) {
+            table[hash4(load32(data + position - 2))] = static_cast<int32_t>(position - 2);
+        }
+    }
+
+    // 4. 剩余字面量
+    putSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+bool LzCompressor::decompressBlock(const unsigned char* body, size_t bodySize, unsigned char* out, size_t size) {
+    const unsigned char* cursor = body;
+    const unsigned char* end = body + bodySize;
+    size_t produced = 0;
+
+    while (cursor < end) {
+        unsigned char token = *cursor++;
+
+        // 1. 字面量
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !getLength(cursor, end, literalLength)) {
+            return false;
+        }
+        if (literalLength > static_cast<size_t>(end - cursor) || literalLength > size - produced) {
+            return false;
+        }
+        std::memcpy(out + produced, cursor, literalLength);
+        cursor += literalLength;
+        produced += literalLength;
+
+        // 最后一个序列只有字面量
+        if (cursor == end) {
+            break;
+        }
+
+        // 2. 匹配
+        if (end - cursor < 2) {
+            return false;
+        }
+        size_t offset = cursor[0] | (static_cast<size_t>(cursor[1]) << 8);
+        cursor += 2;
+        size_t length = token & 0x0F;
+        if (length == 15 && !getLength(cursor, end, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if (offset == 0 || offset > produced || length > size - produced) {
+            return false;
+        }
+
+        // 重叠的匹配（offset小于长度）必须逐字节复制
+        unsigned char* target = out + produced;
+        const unsigned char* source = target - offset;
+        if (offset >= length) {
+            std::memcpy(target, source, length);
+        } else {
+            for (size_t i = 0; i < length; ++i) {
+                target[i] = source[i];
+            }
+        }
+        produced += length;
+    }
+    return produced == size;
+}
+
+bool LzCompressor::isWorthCompressing(const std::string& inputFilePath) const {
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(inputFilePath, ec);
+    if (ec) {
+        // 无法判断时交给压缩本身决定
+        return true;
+    }
+    if (size == 0) {
+        return false;
+    }
+    std::ifstream inFile(inputFilePath, std::ios::binary);
+    if (!inFile.is_open()) {
+        return true;
+    }
+
+    // 均匀选取若干窗口实际压缩，按压缩率推算
+    uint64_t windowCount = std::min<uint64_t>(MAX_SAMPLES, (size + SAMPLE_WINDOW - 1) / SAMPLE_WINDOW);
+    std::vector<unsigned char> window(SAMPLE_WINDOW);
+    std::vector<unsigned char> compressed;
+    uint64_t sampledBytes = 0;
+    uint64_t compressedBytes = 0;
+    for (uint64_t i = 0; i < windowCount; ++i) {
+        uint64_t offset = windowCount > 1 && size > SAMPLE_WINDOW
+                              ? i * ((size - SAMPLE_WINDOW) / (windowCount - 1)) : 0;
+        inFile.seekg(static_cast<std::streamoff>(offset));
+        inFile.read(reinterpret_cast<char*>(window.data()), window.size());
+        size_t count = static_cast<size_t>(inFile.gcount());
+        inFile.clear();
+        if (count == 0) {
+            break;
+        }
+        compressed.clear();
+        compressBlock(window.data(), count, compressed);
+        sampledBytes += count;
+        compressedBytes += std::min<uint64_t>(compressed.size(), count);
+    }
+    if (sampledBytes == 0) {
+        return true;
+    }
+
+    // 加上文件头、块头和结束块的开销
+    uint64_t blocks = (size + blockSize - 1) / blockSize;
+    double estimatedSize = static_cast<double>(compressedBytes) / static_cast<double>(sampledBytes) * static_cast<double>(size) +
+                           sizeof(LZ_MAGIC) + 1 + 12 + static_cast<double>(blocks) * BLOCK_HEADER_SIZE;
+    return estimatedSize < static_cast<double>(size) * (1.0 - MIN_SAVING_RATIO);
+}
+
+bool LzCompressor::compressStream(std::istream& in, std::ostream& out) {
+    // 文件头
+    out.write(LZ_MAGIC, sizeof(LZ_MAGIC));
+    out.put(static_cast<char>(LZ_VERSION));
+
+    std::vector<unsigned char> raw(blockSize);
+    std::vector<unsigned char> encoded;
+    std::vector<unsigned char> header;
+    uint64_t totalSize = 0;
+    while (true) {
+        in.read(reinterpret_cast<char*>(raw.data()), raw.size());
+        size_t count = static_cast<size_t>(in.gcount());
+        if (in.bad()) {
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        // 压缩后不会变小时原样存储
+        encoded.clear();
+        compressBlock(raw.data(), count, encoded);
+        bool stored = encoded.size() >= count;
+        header.clear();
+        putLittleEndian32(header, static_cast<uint32_t>(count));
+        header.push_back(stored ? BLOCK_STORED : BLOCK_LZ);
+        putLittleEndian32(header, static_cast<uint32_t>(stored ? count : encoded.size()));
+        out.write(reinterpret_cast<const char*>(header.data()), header.size());
+        if (stored) {
+            out.write(reinterpret_cast<const char*>(raw.data()), count);
+        } else {
+            out.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        }
+        if (!out) {
+            return false;
+        }
+        totalSize += count;
+        if (count < raw.size()) {
+            break;
+        }
+    }
+
+    // 结束块：原始大小为0，随后是原始数据总大小
+    header.clear();
+    putLittleEndian32(header, 0);
+    putLittleEndian64(header, totalSize);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    return static_cast<bool>(out);
+}
+
+bool LzCompressor::decompressStream(std::istream& in, std::ostream& out) {
+    // 校验文件头
+    char magic[sizeof(LZ_MAGIC)];
+    in.read(magic, sizeof(magic));
+    int version = in.get();
+    if (!in || std::memcmp(magic, LZ_MAGIC, sizeof(LZ_MAGIC)) != 0 || version != LZ_VERSION) {
+        return false;
+    }
+
+    std::vector<unsigned char> raw;
+    std::vector<unsigned char> body;
+    uint64_t totalSize = 0;
+    while (true) {
+        unsigned char header[BLOCK_HEADER_SIZE];
+        if (!in.read(reinterpret_cast<char*>(header), 4)) {
+            return false;
+        }
+        uint32_t rawSize = getLittleEndian32(header);
+        if (rawSize == 0) {
+            unsigned char sizeBytes[8];
+            if (!in.read(reinterpret_cast<char*>(sizeBytes), sizeof(sizeBytes))) {
+                return false;
+            }
+            return getLittleEndian64(sizeBytes) == totalSize;
+        }
+        if (!in.read(reinterpret_cast<char*>(header + 4), BLOCK_HEADER_SIZE - 4)) {
+            return false;
+        }
+        uint8_t type = header[4];
+        uint32_t bodySize = getLittleEndian32(header + 5);
+        // 块体不会比原始数据大，据此拒绝损坏的块头，避免分配过大的内存
+        if (rawSize > MAX_BLOCK_SIZE || bodySize > rawSize) {
+            return false;
+        }
+        body.resize(bodySize);
+        if (!in.read(reinterpret_cast<char*>(body.data()), bodySize)) {
+            return false;
+        }
+
+        raw.resize(rawSize);
+        if (type == BLOCK_STORED) {
+            if (bodySize != rawSize) {
+                return false;
+            }
+            raw.swap(body);
+        } else if (type != BLOCK_LZ || !decompressBlock(body.data(), bodySize, raw.data(), rawSize)) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(raw.data()), rawSize);
+        if (!out) {
+            return false;
+        }
+        totalSize += rawSize;
+    }
+}
+
+bool LzCompressor::compressFile(const std::string& inputFilePath, const std::string& outputFilePath) {
+    try {
+        std::ifstream inFile(inputFilePath, std::ios::binary);
+        if (!inFile.is_open()) {
+            return false;
+        }
+
+        std::ofstream outFile(outputFilePath, std::ios::binary);
+        if (!outFile.is_open()) {
+            return false;
+        }
+
+        if (!compressStream(inFile, outFile)) {
+            outFile.close();
+            return false;
+        }
+
+        outFile.close();
+        return static_cast<bool>(outFile);
+
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
+bool LzCompressor::decompressFile(const std::string& inputFilePath, const std::string& outputFilePath) {
+    try {
+        std::ifstream inFile(inputFilePath, std::ios::binary);
+        if (!inFile.is_open()) {
+            return false;
+        }
+
+        std::ofstream outFile(outputFilePath, std::ios::binary);
+        if (!outFile.is_open()) {
+            return false;
+        }
+
+        if (!decompressStream(inFile, outFile)) {
+            outFile.close();
+            return false;
+        }
+
+        outFile.close();
+        return static_cast<bool>(outFile);
+
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+// LZ77族快速压缩器（序列格式参照LZ4，速度优先）
+// 对源代码、日志等重复内容多的文件，压缩率明显好于0阶Huffman编码
+// 文件格式：
+//   文件头  "BLZ" + 版本号(1字节)
+//   数据块  原始大小(u32) + 块类型(u8) + 块体大小(u32) + 块体
+//   结束块  原始大小为0，随后是原始数据总大小(u64)
+// 数据块之间互不引用，块内的序列为：
+//   标记(高4位字面量长度，低4位匹配长度-4) + [扩展字面量长度] + 字面量
+//   + 偏移(u16) + [扩展匹配长度]，最后一个序列只有字面量
+class LzCompressor {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;  // 默认数据块大小1 MiB
+    static constexpr size_t MAX_BLOCK_SIZE = 64 << 20;     // 数据块大小上限
+    static constexpr size_t MIN_MATCH = 4;                 // 最短匹配长度
+    static constexpr size_t MAX_OFFSET = 65535;            // 最大回溯距离
+    static constexpr size_t SAMPLE_WINDOW = 64 << 10;      // 预估压缩率的采样窗口大小
+    static constexpr size_t MAX_SAMPLES = 4;               // 预估压缩率最多压缩的窗口数
+    static constexpr double MIN_SAVING_RATIO = 0.02;       // 值得压缩的最小节省比例
+
+    LzCompressor();
+
+    // 设置压缩时的数据块大小
+    void setBlockSize(size_t size);
+    size_t getBlockSize() const { return blockSize; }
+
+    // 压缩几个采样窗口，估计节省不到MIN_SAVING_RATIO时返回false
+    bool isWorthCompressing(const std::string& inputFilePath) const;
+
+    // 压缩文件
+    bool compressFile(const std::string& inputFilePath, const std::string& outputFilePath);
+
+    // 解压文件
+    bool decompressFile(const std::string& inputFilePath, const std::string& outputFilePath);
+
+    // 流式压缩，内存占用只与数据块大小有关
+    bool compressStream(std::istream& in, std::ostream& out);
+
+    // 流式解压
+    bool decompressStream(std::istream& in, std::ostream& out);
+
+    // 压缩一段数据，序列追加到out（不含块头）
+    static void compressBlock(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+
+    // 解压一段序列，必须恰好输出size个字节
+    static bool decompressBlock(const unsigned char* body, size_t bodySize, unsigned char* out, size_t size);
+
+private:
+    // 块类型
+    enum BlockType : uint8_t {
+        BLOCK_STORED = 0,  // 原样存储（压缩后不会变小）
+        BLOCK_LZ = 1,      // LZ序列
+    };
+
+    size_t blockSize;  // 压缩时的数据块大小
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <exception>
+
+// 固定大小的工作线程池
+// 任务按提交顺序取出执行，任务中抛出的异常通过future传回调用方
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount) : stopping(false) {
+        threadCount = std::max<size_t>(1, threadCount);
+        workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // 提交一个任务
+    std::future<void> submit(std::function<void()> task) {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        std::future<void> result = packaged->get_future();
+        enqueue([packaged] { (*packaged)(); });
+        return result;
+    }
+
+    // 对[0, count)中的每个下标执行fn，全部完成后返回
+    // 下标由各线程动态领取，处理耗时不均的任务时负载更均衡；调用线程也参与处理，
+    // 最多maxThreads个线程（含调用线程）同时执行，0表示不限制
+    // 完成与否按已处理的下标计算，不等待排队中的任务，因此可以在池中的任务里再次调用而不会死锁
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn, size_t maxThreads = 0) {
+        if (count == 0) {
+            return;
+        }
+        size_t helpers = std::min(count, maxThreads ? maxThreads : workers.size() + 1) - 1;
+        helpers = std::min(helpers, workers.size());
+        if (helpers == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        // 排队中的任务可能在本函数返回后才开始执行，所需的状态（包括fn的副本）由任务共同持有
+        struct SharedState {
+            std::function<void(size_t)> fn;
+            size_t count;
+            std::atomic<size_t> next{0};
+            std::mutex mutex;
+            std::condition_variable finished;
+            size_t done = 0;
+            std::exception_ptr error;
+        };
+        auto state = std::make_shared<SharedState>();
+        state->fn = fn;
+        state->count = count;
+        auto run = [](SharedState& shared) {
+            for (size_t i = shared.next++; i < shared.count; i = shared.next++) {
+                std::exception_ptr error;
+                try {
+                    shared.fn(i);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(shared.mutex);
+                if (error && !shared.error) {
+                    shared.error = error;
+                }
+                if (++shared.done == shared.count) {
+                    shared.finished.notify_all();
+                }
+            }
+        };
+        for (size_t t = 0; t < helpers; ++t) {
+            enqueue([state, run] { run(*state); });
+        }
+        run(*state);
+
+        // 先等待全部下标处理完，再抛出第一个异常
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&state] { return state->done == state->count; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    // 进程共享的线程池，第一次使用时创建，线程数为硬件并发数
+    // 压缩、加密等按文件创建的对象都借用这个池，不必为每个文件启动和回收一组线程
+    static ThreadPool& shared() {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+private:
+    void enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.push(std::move(task));
+        }
+        queueCondition.notify_one();
+    }
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+};
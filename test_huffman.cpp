@@ -30,6 +30,8 @@ int main() {
         // 解压缩文件
         if (compressor.decompressFile(compressedFile, decompressedFile)) {
             std::cout << "Decompression successful!" << std::endl;
+            const HuffmanStats& stats = compressor.getLastStats();
+            std::cout << "Decode throughput: " << stats.throughputMBps(stats.outputBytes) << " MB/s" << std::endl;
             
             // 读取解压缩后的内容
             std::ifstream inFile(decompressedFile);